@@ -0,0 +1,473 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+#define DEQUE_INITIAL_CAPACITY 64
+#define CHUNKS_PER_WORKER 8
+
+typedef struct pool_task
+{
+    void (*run)(struct pool_task *task);
+    task_fn fn;
+    void *arg;
+    size_t begin;
+    size_t end;
+    task_group *group;
+} pool_task;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pool_task *tasks;
+    size_t capacity;
+    size_t top;    // thieves take from here (oldest, largest ranges)
+    size_t bottom; // the owner pushes and pops here
+} task_deque;
+
+struct thread_pool
+{
+    size_t workers;
+    pthread_t *threads;
+    task_deque *deques; // one per worker plus the injection deque at [workers]
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    atomic_size_t queued;
+    atomic_size_t sleepers;
+    atomic_int stop;
+};
+
+typedef struct
+{
+    range_fn fn;
+    void *ctx;
+    size_t grain;
+    cancel_token *cancel;
+    task_group group;
+} range_job;
+
+typedef struct
+{
+    reduce_map_fn map;
+    void *ctx;
+    unsigned char *accs;
+    size_t acc_size;
+    size_t begin;
+    size_t end;
+    size_t chunk;
+} reduce_job;
+
+static _Thread_local thread_pool *current_pool;
+static _Thread_local size_t current_index;
+
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+static thread_pool *shared_pool;
+
+static void deque_init(task_deque *deque)
+{
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->tasks = malloc(sizeof(pool_task) * DEQUE_INITIAL_CAPACITY);
+    deque->capacity = DEQUE_INITIAL_CAPACITY;
+    deque->top = 0;
+    deque->bottom = 0;
+}
+
+static void deque_free(task_deque *deque)
+{
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->tasks);
+}
+
+static void deque_push(task_deque *deque, const pool_task *task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity)
+    {
+        pool_task *grown = malloc(sizeof(pool_task) * deque->capacity * 2);
+        for (size_t i = deque->top; i < deque->bottom; i++)
+        {
+            grown[i & (deque->capacity * 2 - 1)] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = grown;
+        deque->capacity *= 2;
+    }
+    deque->tasks[deque->bottom++ & (deque->capacity - 1)] = *task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static int deque_pop(task_deque *deque, pool_task *task)
+{
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top)
+    {
+        *task = deque->tasks[--deque->bottom & (deque->capacity - 1)];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal(task_deque *deque, pool_task *task)
+{
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top)
+    {
+        *task = deque->tasks[deque->top++ & (deque->capacity - 1)];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static size_t own_deque(const thread_pool *pool)
+{
+    return current_pool == pool ? current_index : pool->workers;
+}
+
+static void pool_push(thread_pool *pool, const pool_task *task)
+{
+    // queued goes up first so that a thief's decrement never takes it
+    // below zero; a worker that sees it early just looks again.
+    atomic_fetch_add(&task->group->pending, 1);
+    atomic_fetch_add(&pool->queued, 1);
+    deque_push(&pool->deques[own_deque(pool)], task);
+    if (atomic_load(&pool->sleepers) > 0)
+    {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+static int pool_find_task(thread_pool *pool, pool_task *task)
+{
+    size_t self = own_deque(pool);
+    size_t count = pool->workers + 1;
+    if (atomic_load(&pool->queued) == 0)
+    {
+        return 0;
+    }
+    if (deque_pop(&pool->deques[self], task))
+    {
+        atomic_fetch_sub(&pool->queued, 1);
+        return 1;
+    }
+    for (size_t i = 1; i < count; i++)
+    {
+        if (deque_steal(&pool->deques[(self + i) % count], task))
+        {
+            atomic_fetch_sub(&pool->queued, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The last task of a group wakes the sleepers, among them any thread
+// blocked in task_group_wait on it.
+static void pool_run_task(thread_pool *pool, pool_task *task)
+{
+    task_group *group = task->group;
+    task->run(task);
+    if (atomic_fetch_sub(&group->pending, 1) == 1 && atomic_load(&pool->sleepers) > 0)
+    {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_broadcast(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    thread_pool *pool = arg;
+    pool_task task;
+
+    for (;;)
+    {
+        if (pool_find_task(pool, &task))
+        {
+            pool_run_task(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->idle_lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop))
+        {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        atomic_fetch_sub(&pool->sleepers, 1);
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (atomic_load(&pool->stop) && atomic_load(&pool->queued) == 0)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+typedef struct
+{
+    thread_pool *pool;
+    size_t index;
+} worker_start;
+
+static void *worker_entry(void *arg)
+{
+    worker_start start = *(worker_start *)arg;
+    free(arg);
+    current_pool = start.pool;
+    current_index = start.index;
+    return worker_main(start.pool);
+}
+
+thread_pool *thread_pool_create(size_t workers)
+{
+    if (workers == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (size_t)online : 1;
+    }
+
+    thread_pool *pool = malloc(sizeof(thread_pool));
+    pool->workers = workers;
+    pool->threads = malloc(sizeof(pthread_t) * workers);
+    pool->deques = malloc(sizeof(task_deque) * (workers + 1));
+    for (size_t i = 0; i <= workers; i++)
+    {
+        deque_init(&pool->deques[i]);
+    }
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->stop, 0);
+
+    for (size_t i = 0; i < workers; i++)
+    {
+        worker_start *start = malloc(sizeof(worker_start));
+        start->pool = pool;
+        start->index = i;
+        pthread_create(&pool->threads[i], NULL, worker_entry, start);
+    }
+    return pool;
+}
+
+void thread_pool_destroy(thread_pool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&pool->idle_lock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (size_t i = 0; i < pool->workers; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (size_t i = 0; i <= pool->workers; i++)
+    {
+        deque_free(&pool->deques[i]);
+    }
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+static void create_shared_pool(void)
+{
+    shared_pool = thread_pool_create(0);
+}
+
+thread_pool *thread_pool_shared(void)
+{
+    pthread_once(&shared_once, create_shared_pool);
+    return shared_pool;
+}
+
+size_t thread_pool_size(const thread_pool *pool)
+{
+    return pool->workers;
+}
+
+void task_group_init(task_group *group)
+{
+    atomic_init(&group->pending, 0);
+}
+
+static void run_plain_task(pool_task *task)
+{
+    task->fn(task->arg);
+}
+
+void thread_pool_submit(thread_pool *pool, task_group *group, task_fn fn, void *arg)
+{
+    pool_task task = {run_plain_task, fn, arg, 0, 0, group};
+    pool_push(pool, &task);
+}
+
+// Runs queued tasks while the group is pending and sleeps with the idle
+// workers when there are none, until new work or the group's last task
+// wakes it.
+void task_group_wait(thread_pool *pool, task_group *group)
+{
+    pool_task task;
+    while (atomic_load(&group->pending) > 0)
+    {
+        if (pool_find_task(pool, &task))
+        {
+            pool_run_task(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->idle_lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+        while (atomic_load(&group->pending) > 0 && atomic_load(&pool->queued) == 0)
+        {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        atomic_fetch_sub(&pool->sleepers, 1);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+void cancel_token_init(cancel_token *token)
+{
+    atomic_init(&token->cancelled, 0);
+}
+
+void cancel_request(cancel_token *token)
+{
+    atomic_store_explicit(&token->cancelled, 1, memory_order_release);
+}
+
+int cancel_requested(const cancel_token *token)
+{
+    return token != NULL && atomic_load_explicit(&((cancel_token *)token)->cancelled, memory_order_acquire);
+}
+
+// Split the range in halves, leaving the upper halves for thieves, until
+// it is no larger than the grain, then run the leaf on the calling worker.
+static void run_range(pool_task *task)
+{
+    range_job *job = task->arg;
+    size_t begin = task->begin;
+    size_t end = task->end;
+    thread_pool *pool = current_pool;
+
+    while (end - begin > job->grain && !cancel_requested(job->cancel))
+    {
+        size_t mid = begin + (end - begin) / 2;
+        pool_task upper = {run_range, NULL, job, mid, end, &job->group};
+        pool_push(pool, &upper);
+        end = mid;
+    }
+    if (!cancel_requested(job->cancel))
+    {
+        job->fn(begin, end, job->ctx);
+    }
+}
+
+void parallel_for(thread_pool *pool, size_t begin, size_t end, size_t grain,
+                  range_fn fn, void *ctx, cancel_token *cancel)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    if (pool == NULL)
+    {
+        pool = thread_pool_shared();
+    }
+    if (grain == 0)
+    {
+        grain = (end - begin) / (pool->workers * CHUNKS_PER_WORKER);
+        grain = grain > 0 ? grain : 1;
+    }
+    if (end - begin <= grain)
+    {
+        if (!cancel_requested(cancel))
+        {
+            fn(begin, end, ctx);
+        }
+        return;
+    }
+
+    range_job job = {fn, ctx, grain, cancel, {0}};
+    task_group_init(&job.group);
+    atomic_fetch_add(&job.group.pending, 1);
+
+    // The caller takes the first half itself; its pushes land in its own
+    // deque (or the injection deque), where the workers steal them.
+    thread_pool *saved_pool = current_pool;
+    size_t saved_index = current_index;
+    if (current_pool != pool)
+    {
+        current_pool = pool;
+        current_index = pool->workers;
+    }
+    pool_task root = {run_range, NULL, &job, begin, end, &job.group};
+    pool_run_task(pool, &root);
+    task_group_wait(pool, &job.group);
+    current_pool = saved_pool;
+    current_index = saved_index;
+}
+
+static void run_reduce_chunks(size_t first, size_t last, void *ctx)
+{
+    reduce_job *job = ctx;
+    for (size_t c = first; c < last; c++)
+    {
+        size_t begin = job->begin + c * job->chunk;
+        size_t end = begin + job->chunk < job->end ? begin + job->chunk : job->end;
+        job->map(begin, end, job->accs + c * job->acc_size, job->ctx);
+    }
+}
+
+// Each chunk reduces into its own accumulator, and the partial results are
+// combined in chunk order, so the result does not depend on scheduling.
+void parallel_reduce(thread_pool *pool, size_t begin, size_t end, size_t grain,
+                     void *result, size_t acc_size, const void *identity,
+                     reduce_map_fn map, reduce_combine_fn combine, void *ctx,
+                     cancel_token *cancel)
+{
+    memcpy(result, identity, acc_size);
+    if (end <= begin)
+    {
+        return;
+    }
+    if (pool == NULL)
+    {
+        pool = thread_pool_shared();
+    }
+
+    size_t n = end - begin;
+    size_t chunk = grain;
+    if (chunk == 0)
+    {
+        size_t chunks = pool->workers * CHUNKS_PER_WORKER;
+        chunk = (n + chunks - 1) / chunks;
+    }
+    size_t chunks = (n + chunk - 1) / chunk;
+
+    reduce_job job = {map, ctx, malloc(acc_size * chunks), acc_size, begin, end, chunk};
+    for (size_t c = 0; c < chunks; c++)
+    {
+        memcpy(job.accs + c * acc_size, identity, acc_size);
+    }
+
+    parallel_for(pool, 0, chunks, 1, run_reduce_chunks, &job, cancel);
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        combine(result, job.accs + c * acc_size, ctx);
+    }
+    free(job.accs);
+}
@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_ /* Include guard */
+#define THREAD_POOL_
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// Work-stealing scheduler shared by every set. Each worker owns a deque:
+// it pushes and pops work at the bottom, idle workers steal from the top.
+// Threads that are not pool workers (e.g. main) submit through an extra
+// injection deque and help run tasks while they wait.
+
+typedef struct thread_pool thread_pool;
+
+typedef struct
+{
+    atomic_size_t pending;
+} task_group;
+
+typedef struct
+{
+    atomic_int cancelled;
+} cancel_token;
+
+typedef void (*task_fn)(void *arg);
+
+typedef void (*range_fn)(size_t begin, size_t end, void *ctx);
+
+typedef void (*reduce_map_fn)(size_t begin, size_t end, void *acc, void *ctx);
+
+typedef void (*reduce_combine_fn)(void *acc, const void *other, void *ctx);
+
+thread_pool *thread_pool_create(size_t workers);
+
+void thread_pool_destroy(thread_pool *pool);
+
+thread_pool *thread_pool_shared(void);
+
+size_t thread_pool_size(const thread_pool *pool);
+
+void task_group_init(task_group *group);
+
+void thread_pool_submit(thread_pool *pool, task_group *group, task_fn fn, void *arg);
+
+void task_group_wait(thread_pool *pool, task_group *group);
+
+void cancel_token_init(cancel_token *token);
+
+void cancel_request(cancel_token *token);
+
+int cancel_requested(const cancel_token *token);
+
+void parallel_for(thread_pool *pool, size_t begin, size_t end, size_t grain,
+                  range_fn fn, void *ctx, cancel_token *cancel);
+
+void parallel_reduce(thread_pool *pool, size_t begin, size_t end, size_t grain,
+                     void *result, size_t acc_size, const void *identity,
+                     reduce_map_fn map, reduce_combine_fn combine, void *ctx,
+                     cancel_token *cancel);
+
+#endif // THREAD_POOL_
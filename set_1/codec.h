@@ -0,0 +1,170 @@
+#ifndef CODEC_ /* Include guard */
+#define CODEC_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Codec and character-class tables are generated by the preprocessor from
+// alphabet specs. A spec is an X-macro that expands X(index, symbol) for
+// every symbol, so the same list yields both the encode table and the
+// designated-initializer decode table. Each DEFINE_* instantiation emits
+// its own tables and static inline encoder/decoder, so there is no runtime
+// alphabet selection. Decode tables store index + 1, leaving 0 for invalid.
+
+#define CODEC_ENCODE_ENTRY(index, symbol) [index] = symbol,
+#define CODEC_DECODE_ENTRY(index, symbol) [(unsigned char)(symbol)] = (index) + 1,
+#define CHAR_CLASS_ENTRY(symbol) [(unsigned char)(symbol)] = 1,
+
+#define BASE64_ALNUM(X) \
+    X(0, 'A') X(1, 'B') X(2, 'C') X(3, 'D') X(4, 'E') X(5, 'F') \
+    X(6, 'G') X(7, 'H') X(8, 'I') X(9, 'J') X(10, 'K') X(11, 'L') \
+    X(12, 'M') X(13, 'N') X(14, 'O') X(15, 'P') X(16, 'Q') X(17, 'R') \
+    X(18, 'S') X(19, 'T') X(20, 'U') X(21, 'V') X(22, 'W') X(23, 'X') \
+    X(24, 'Y') X(25, 'Z') X(26, 'a') X(27, 'b') X(28, 'c') X(29, 'd') \
+    X(30, 'e') X(31, 'f') X(32, 'g') X(33, 'h') X(34, 'i') X(35, 'j') \
+    X(36, 'k') X(37, 'l') X(38, 'm') X(39, 'n') X(40, 'o') X(41, 'p') \
+    X(42, 'q') X(43, 'r') X(44, 's') X(45, 't') X(46, 'u') X(47, 'v') \
+    X(48, 'w') X(49, 'x') X(50, 'y') X(51, 'z') X(52, '0') X(53, '1') \
+    X(54, '2') X(55, '3') X(56, '4') X(57, '5') X(58, '6') X(59, '7') \
+    X(60, '8') X(61, '9')
+
+#define BASE64_STD(X) BASE64_ALNUM(X) X(62, '+') X(63, '/')
+
+#define BASE64_URL(X) BASE64_ALNUM(X) X(62, '-') X(63, '_')
+
+#define BASE16_LOWER(X) \
+    X(0, '0') X(1, '1') X(2, '2') X(3, '3') X(4, '4') X(5, '5') X(6, '6') X(7, '7') \
+    X(8, '8') X(9, '9') X(10, 'a') X(11, 'b') X(12, 'c') X(13, 'd') X(14, 'e') X(15, 'f')
+
+#define BASE16_UPPER(X) \
+    X(0, '0') X(1, '1') X(2, '2') X(3, '3') X(4, '4') X(5, '5') X(6, '6') X(7, '7') \
+    X(8, '8') X(9, '9') X(10, 'A') X(11, 'B') X(12, 'C') X(13, 'D') X(14, 'E') X(15, 'F')
+
+#define BASE16_ANY(X) \
+    BASE16_LOWER(X) X(10, 'A') X(11, 'B') X(12, 'C') X(13, 'D') X(14, 'E') X(15, 'F')
+
+#define ENGLISH_SYMBOLS(X) \
+    X('a') X('b') X('c') X('d') X('e') X('f') X('g') X('h') \
+    X('i') X('j') X('k') X('l') X('m') X('n') X('o') X('p') \
+    X('q') X('r') X('s') X('t') X('u') X('v') X('w') X('x') \
+    X('y') X('z') X('A') X('B') X('C') X('D') X('E') X('F') \
+    X('G') X('H') X('I') X('J') X('K') X('L') X('M') X('N') \
+    X('O') X('P') X('Q') X('R') X('S') X('T') X('U') X('V') \
+    X('W') X('X') X('Y') X('Z') X('0') X('1') X('2') X('3') \
+    X('4') X('5') X('6') X('7') X('8') X('9') X(' ') X('!') \
+    X('"') X('\'') X('\n') X(',') X('.') X('?')
+
+#define DEFINE_BASE64_CODEC(name, ALPHABET, PAD)                                         \
+    static const char name##_encode_table[64] = {ALPHABET(CODEC_ENCODE_ENTRY)};          \
+    static const unsigned char name##_decode_table[256] = {ALPHABET(CODEC_DECODE_ENTRY)}; \
+                                                                                         \
+    static inline size_t name##_encoded_len(size_t len)                                  \
+    {                                                                                    \
+        return (len + 2) / 3 * 4;                                                        \
+    }                                                                                    \
+                                                                                         \
+    static inline size_t name##_encode(char *dst, const unsigned char *src, size_t len) \
+    {                                                                                    \
+        size_t i = 0, j = 0;                                                             \
+        for (; i + 3 <= len; i += 3)                                                     \
+        {                                                                                \
+            uint32_t n = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2]; \
+            dst[j++] = name##_encode_table[n >> 18];                                     \
+            dst[j++] = name##_encode_table[n >> 12 & 0x3F];                              \
+            dst[j++] = name##_encode_table[n >> 6 & 0x3F];                               \
+            dst[j++] = name##_encode_table[n & 0x3F];                                    \
+        }                                                                                \
+        if (i < len)                                                                     \
+        {                                                                                \
+            uint32_t n = (uint32_t)src[i] << 16 | (i + 1 < len ? (uint32_t)src[i + 1] << 8 : 0); \
+            dst[j++] = name##_encode_table[n >> 18];                                     \
+            dst[j++] = name##_encode_table[n >> 12 & 0x3F];                              \
+            dst[j++] = i + 1 < len ? name##_encode_table[n >> 6 & 0x3F] : (PAD);        \
+            dst[j++] = (PAD);                                                            \
+        }                                                                                \
+        dst[j] = 0;                                                                      \
+        return j;                                                                        \
+    }                                                                                    \
+                                                                                         \
+    /* Line breaks are skipped and PAD ends the input. dst may equal src. */            \
+    static inline long name##_decode(unsigned char *dst, const char *src, size_t len)   \
+    {                                                                                    \
+        uint32_t acc = 0;                                                                \
+        int bits = 0;                                                                    \
+        size_t j = 0;                                                                    \
+        for (size_t i = 0; i < len; i++)                                                 \
+        {                                                                                \
+            unsigned char c = (unsigned char)src[i];                                     \
+            if (c == (unsigned char)(PAD))                                               \
+            {                                                                            \
+                break;                                                                   \
+            }                                                                            \
+            if (c == '\n' || c == '\r')                                                  \
+            {                                                                            \
+                continue;                                                                \
+            }                                                                            \
+            if (name##_decode_table[c] == 0)                                             \
+            {                                                                            \
+                return -1;                                                               \
+            }                                                                            \
+            acc = (acc << 6 | (name##_decode_table[c] - 1u)) & 0xFFFFFF;                 \
+            bits += 6;                                                                   \
+            if (bits >= 8)                                                               \
+            {                                                                            \
+                bits -= 8;                                                               \
+                dst[j++] = (unsigned char)(acc >> bits);                                 \
+            }                                                                            \
+        }                                                                                \
+        return (long)j;                                                                  \
+    }
+
+// ENCODE_ALPHABET picks the output digits, ACCEPT_ALPHABET every digit the
+// decoder takes (e.g. both cases).
+#define DEFINE_BASE16_CODEC(name, ENCODE_ALPHABET, ACCEPT_ALPHABET)                        \
+    static const char name##_encode_table[16] = {ENCODE_ALPHABET(CODEC_ENCODE_ENTRY)};     \
+    static const unsigned char name##_decode_table[256] = {ACCEPT_ALPHABET(CODEC_DECODE_ENTRY)}; \
+                                                                                           \
+    static inline size_t name##_encode(char *dst, const unsigned char *src, size_t len)   \
+    {                                                                                      \
+        for (size_t i = 0; i < len; i++)                                                   \
+        {                                                                                  \
+            dst[2 * i] = name##_encode_table[src[i] >> 4];                                 \
+            dst[2 * i + 1] = name##_encode_table[src[i] & 0xF];                            \
+        }                                                                                  \
+        dst[2 * len] = 0;                                                                  \
+        return 2 * len;                                                                    \
+    }                                                                                      \
+                                                                                           \
+    /* Decodes len / 2 bytes, dst may equal src. */                                        \
+    static inline long name##_decode(unsigned char *dst, const char *src, size_t len)     \
+    {                                                                                      \
+        for (size_t i = 0; i + 1 < len; i += 2)                                            \
+        {                                                                                  \
+            unsigned char hi = name##_decode_table[(unsigned char)src[i]];                 \
+            unsigned char lo = name##_decode_table[(unsigned char)src[i + 1]];             \
+            if (hi == 0 || lo == 0)                                                        \
+            {                                                                              \
+                return -1;                                                                 \
+            }                                                                              \
+            dst[i / 2] = (unsigned char)((hi - 1) << 4 | (lo - 1));                        \
+        }                                                                                  \
+        return (long)(len / 2);                                                            \
+    }
+
+#define DEFINE_CHAR_CLASS(name, SYMBOLS)                                            \
+    static const unsigned char name##_table[256] = {SYMBOLS(CHAR_CLASS_ENTRY)};     \
+                                                                                    \
+    static inline int in_##name(unsigned int c)                                     \
+    {                                                                               \
+        return c < 256 && name##_table[c];                                          \
+    }
+
+DEFINE_BASE64_CODEC(base64_std, BASE64_STD, '=')
+
+DEFINE_BASE64_CODEC(base64_url, BASE64_URL, '=')
+
+DEFINE_BASE16_CODEC(hex, BASE16_LOWER, BASE16_ANY)
+
+DEFINE_CHAR_CLASS(english_symbols, ENGLISH_SYMBOLS)
+
+#endif // CODEC_
@@ -1,42 +1,41 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "codec.h"
 #include "set_1.h"
 
 #define ENOUGH 10000
 
-const char *index_to_base64[65] = {"A", "B", "C", "D", "E", "F", "G", "H", "I", "J",
-                                   "K", "L", "M", "N", "O", "P", "Q", "R", "S", "T",
-                                   "U", "V", "W", "X", "Y", "Z", "a", "b", "c", "d",
-                                   "e", "f", "g", "h", "i", "j", "k", "l", "m", "n",
-                                   "o", "p", "q", "r", "s", "t", "u", "v", "w", "x",
-                                   "y", "z", "0", "1", "2", "3", "4", "5", "6", "7",
-                                   "8", "9", "+", "/"};
-
-const int B64index[256] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 62, 63, 62, 62, 63, 52, 53, 54, 55,
-                           56, 57, 58, 59, 60, 61, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6,
-                           7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 0,
-                           0, 0, 0, 63, 0, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-                           41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51};
-
 char letter_frequencies[58] = {'E', 'e', 'T', 't', 'A', 'a', 'O', 'o', 'I', 'i', 'N', 'n', ' ', 'S',
                                's', 'R', 'r', 'H', 'h', 'D', 'd', 'L', 'l', 'U', 'u', 'C', 'c', 'M',
                                'm', 'F', 'f', 'Y', 'y', 'W', 'w', 'G', 'g', 'P', 'p', 'B', 'b', 'V',
                                'v', 'K', 'k', 'X', 'x', 'Q', 'q', 'J', 'j', 'Z', 'z',
                                '\'', '\"', '\n', '?', '!'};
 
+// NULL on a non-hex digit.
 unsigned int *str_to_hexbytes(const char *hex_str)
 {
     size_t len = strlen(hex_str);
     unsigned int *hex = malloc(sizeof(unsigned int) * len / 2);
-    for (int i = 0, j = 0; i < len; i += 2, j++)
+    for (size_t i = 0, j = 0; i + 1 < len; i += 2, j++)
     {
-        char tmp[3];
-        strncpy(tmp, hex_str + i, 2);
-        tmp[2] = 0;
-        hex[j] = strtol(tmp, NULL, 16);
+        unsigned char hi = hex_decode_table[(unsigned char)hex_str[i]];
+        unsigned char lo = hex_decode_table[(unsigned char)hex_str[i + 1]];
+        if (hi == 0 || lo == 0)
+        {
+            free(hex);
+            return NULL;
+        }
+        hex[j] = (unsigned int)((hi - 1) << 4 | (lo - 1));
     }
     return hex;
 }
@@ -49,7 +48,8 @@ unsigned int *str_to_base64bytes(const char *base64_str)
     {
         if (base64_str[i] != '\n')
         {
-            base64[i] = B64index[(int)base64_str[i]];
+            unsigned char index = base64_std_decode_table[(unsigned char)base64_str[i]];
+            base64[i] = index ? index - 1 : 0;
         }
     }
     return base64;
@@ -79,14 +79,15 @@ unsigned int *base64bytes_to_hexbytes(unsigned int *base64bytes, size_t len)
 
 unsigned int *hexbytes_to_base64bytes(unsigned int *hexbytes, size_t len)
 {
-    unsigned int *base64bytes = malloc(sizeof(unsigned int) * len);
-    for (int i = 0; i < len; i += 3)
+    unsigned int *base64bytes = malloc(sizeof(unsigned int) * ((len + 2) / 3 * 4));
+    for (size_t i = 0, j = 0; i < len; i += 3, j += 4)
     {
-        base64bytes[i] = (hexbytes[i] >> 2) & 0x3f;
-        base64bytes[i + 1] = ((hexbytes[i] & 0x3) << 4) | ((hexbytes[i + 1] & 0xF0) >> 4);
-        base64bytes[i + 2] = ((hexbytes[i + 1] & 0xf) << 2) | ((hexbytes[i + 2] & 0xC0) >> 6);
-        base64bytes[i + 3] = hexbytes[i + 2] & 0x3f;
-        printf("%d-%d-%d-%d\n", base64bytes[i], base64bytes[i + 1], base64bytes[i + 2], base64bytes[i + 3]);
+        unsigned int b1 = i + 1 < len ? hexbytes[i + 1] : 0;
+        unsigned int b2 = i + 2 < len ? hexbytes[i + 2] : 0;
+        base64bytes[j] = (hexbytes[i] >> 2) & 0x3f;
+        base64bytes[j + 1] = ((hexbytes[i] & 0x3) << 4) | ((b1 & 0xF0) >> 4);
+        base64bytes[j + 2] = ((b1 & 0xf) << 2) | ((b2 & 0xC0) >> 6);
+        base64bytes[j + 3] = b2 & 0x3f;
     }
     free(hexbytes);
     return base64bytes;
@@ -94,21 +95,34 @@ unsigned int *hexbytes_to_base64bytes(unsigned int *hexbytes, size_t len)
 
 char *base64_to_str(unsigned int *base64bytes, size_t len)
 {
-    char *str = malloc(sizeof(char) * len);
-    for (int i = 0; i <= len; i++)
+    char *str = malloc(sizeof(char) * (len + 1));
+    for (int i = 0; i < len; i++)
     {
-        strcat(str, index_to_base64[(int)base64bytes[i]]);
+        str[i] = base64_std_encode_table[base64bytes[i] & 0x3F];
     }
+    str[len] = 0;
     free(base64bytes);
     return str;
 }
 
+// NULL for an odd number of digits or a non-hex one.
 char *hex_to_base64(const char *input)
 {
-    size_t len = strlen(input) / 2;
-    unsigned int *hex = str_to_hexbytes(input);
-    unsigned int *base64 = hexbytes_to_base64bytes(hex, len);
-    return base64_to_str(base64, len);
+    size_t digits = strlen(input), len = digits / 2;
+    if (digits % 2)
+    {
+        return NULL;
+    }
+    unsigned char *bytes = malloc(len);
+    if (hex_decode(bytes, input, len * 2) < 0)
+    {
+        free(bytes);
+        return NULL;
+    }
+    char *str = malloc(base64_std_encoded_len(len) + 1);
+    base64_std_encode(str, bytes, len);
+    free(bytes);
+    return str;
 }
 
 char *base64_to_hex(const char *input)
@@ -122,19 +136,13 @@ char *base64_to_hex(const char *input)
 
 char *bytes_to_str(unsigned int *bytes, size_t len)
 {
-    char *str = malloc(sizeof(char) * len);
+    char *str = malloc(sizeof(char) * (len / 2 * 2 + 1));
     for (int i = 0; i < len / 2; i++)
     {
-        char tmp[3];
-        sprintf(tmp, "%x", bytes[i]);
-        if (strlen(tmp) == 1)
-        {
-            tmp[1] = tmp[0];
-            tmp[0] = '0';
-        }
-        tmp[2] = 0;
-        strcat(str, tmp);
+        str[2 * i] = hex_encode_table[bytes[i] >> 4 & 0xF];
+        str[2 * i + 1] = hex_encode_table[bytes[i] & 0xF];
     }
+    str[len / 2 * 2] = 0;
     free(bytes);
     return str;
 }
@@ -151,17 +159,169 @@ unsigned int *xor_hexbytes(unsigned int *hexbytes_1, unsigned int *hexbytes_2, s
     return hex;
 }
 
+// NULL unless both inputs are hex of the same, even, length.
 char *xor_hex(const char *input_1, const char *input_2)
 {
     size_t len = strlen(input_1);
-    if (len == strlen(input_2))
+    if (len == strlen(input_2) && len % 2 == 0)
     {
-        unsigned int *hexbytes_1 = str_to_hexbytes(input_1);
-        unsigned int *hexbytes_2 = str_to_hexbytes(input_2);
-        unsigned int *hexbytes = xor_hexbytes(hexbytes_1, hexbytes_2, len / 2);
-        return bytes_to_str(hexbytes, len);
+        unsigned char *bytes_1 = malloc(len / 2 + 1);
+        unsigned char *bytes_2 = malloc(len / 2 + 1);
+        char *str = NULL;
+        if (hex_decode(bytes_1, input_1, len) >= 0 && hex_decode(bytes_2, input_2, len) >= 0)
+        {
+            str = malloc(len + 1);
+            xor_bytes(bytes_1, bytes_1, bytes_2, len / 2);
+            hex_encode(str, bytes_1, len / 2);
+        }
+        free(bytes_1);
+        free(bytes_2);
+        return str;
+    }
+    return NULL;
+}
+
+static void xor_bytes_scalar(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t len)
+{
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        x ^= y;
+        memcpy(dst + i, &x, 8);
+    }
+    for (; i < len; i++)
+    {
+        dst[i] = a[i] ^ b[i];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Loads are unaligned; streaming stores need an aligned destination, so the
+// scalar path covers the head until dst is aligned, and the tail.
+__attribute__((target("avx2"))) static void xor_bytes_avx2(unsigned char *dst, const unsigned char *a,
+                                                            const unsigned char *b, size_t len, int stream)
+{
+    size_t i = 0;
+    if (stream)
+    {
+        size_t head = (32 - ((uintptr_t)dst & 31)) & 31;
+        head = head < len ? head : len;
+        xor_bytes_scalar(dst, a, b, head);
+        i = head;
+        for (; i + 32 <= len; i += 32)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+            _mm256_stream_si256((__m256i *)(dst + i), _mm256_xor_si256(x, y));
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 128 <= len; i += 128)
+        {
+            for (size_t k = 0; k < 128; k += 32)
+            {
+                __m256i x = _mm256_loadu_si256((const __m256i *)(a + i + k));
+                __m256i y = _mm256_loadu_si256((const __m256i *)(b + i + k));
+                _mm256_storeu_si256((__m256i *)(dst + i + k), _mm256_xor_si256(x, y));
+            }
+        }
+        for (; i + 32 <= len; i += 32)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+            _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(x, y));
+        }
+    }
+    xor_bytes_scalar(dst + i, a + i, b + i, len - i);
+}
+
+__attribute__((target("avx512f"))) static void xor_bytes_avx512(unsigned char *dst, const unsigned char *a,
+                                                                 const unsigned char *b, size_t len, int stream)
+{
+    size_t i = 0;
+    if (stream)
+    {
+        size_t head = (64 - ((uintptr_t)dst & 63)) & 63;
+        head = head < len ? head : len;
+        xor_bytes_scalar(dst, a, b, head);
+        i = head;
+        for (; i + 64 <= len; i += 64)
+        {
+            __m512i x = _mm512_loadu_si512(a + i);
+            __m512i y = _mm512_loadu_si512(b + i);
+            _mm512_stream_si512((void *)(dst + i), _mm512_xor_si512(x, y));
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 64 <= len; i += 64)
+        {
+            __m512i x = _mm512_loadu_si512(a + i);
+            __m512i y = _mm512_loadu_si512(b + i);
+            _mm512_storeu_si512(dst + i, _mm512_xor_si512(x, y));
+        }
+    }
+    xor_bytes_scalar(dst + i, a + i, b + i, len - i);
+}
+#endif
+
+typedef void (*xor_kernel)(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t len, int stream);
+
+static void xor_bytes_portable(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t len, int stream)
+{
+    (void)stream;
+    xor_bytes_scalar(dst, a, b, len);
+}
+
+static xor_kernel xor_kernel_selected;
+static pthread_once_t xor_kernel_once = PTHREAD_ONCE_INIT;
+
+static void init_xor_kernel(void)
+{
+    xor_kernel_selected = xor_bytes_portable;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        xor_kernel_selected = xor_bytes_avx512;
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        xor_kernel_selected = xor_bytes_avx2;
+    }
+#endif
+}
+
+// Safe from pool workers: the first caller selects, the rest wait for it.
+static xor_kernel select_xor_kernel(void)
+{
+    pthread_once(&xor_kernel_once, init_xor_kernel);
+    return xor_kernel_selected;
+}
+
+// dst may be a or b (in place). Buffers must otherwise not overlap.
+void xor_bytes(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t len)
+{
+    select_xor_kernel()(dst, a, b, len, len >= XOR_NONTEMPORAL_THRESHOLD);
+}
+
+// With XOR_NONTEMPORAL every job bypasses the cache, which pays off when the
+// batch as a whole is far larger than the last-level cache even if each
+// record is small. Without it, only records past the threshold stream.
+void xor_batch(const xor_job *jobs, size_t count, int flags)
+{
+    xor_kernel kernel = select_xor_kernel();
+    for (size_t i = 0; i < count; i++)
+    {
+        int stream = (flags & XOR_NONTEMPORAL) || jobs[i].len >= XOR_NONTEMPORAL_THRESHOLD;
+        kernel(jobs[i].dst, jobs[i].a, jobs[i].b, jobs[i].len, stream);
     }
-    return 0;
 }
 
 unsigned int get_most_frequent_byte(unsigned int *bytes, size_t len)
@@ -192,23 +352,7 @@ unsigned int get_most_frequent_byte(unsigned int *bytes, size_t len)
 
 int is_english_symbol(unsigned int c)
 {
-    if ((0x61 <= c && c <= 0x79)    // a -> y
-        || (0x41 <= c && c <= 0x59) // A -> Y
-        || (0x30 <= c && c <= 0x39) // 0 -> 9
-        || (0x20 <= c && c <= 0x22) // space ! "
-        || c == 0x27                // '
-        || c == 0x0A                // \n
-        || c == 0x2C                // ,
-        || c == 0x2E                // .
-        || c == 0x3F                // ?
-        || c == 0x5A                // Z
-        || c == 0x7A                // z
-
-    )
-    {
-        return 1;
-    }
-    return 0;
+    return in_english_symbols(c);
 }
 
 char *attack_single_byte_xor(const char *input)
@@ -312,4 +456,105 @@ int guess_keysize(char *buffer, int max_keysize, int min_keysize)
         }
     }
     return index_lowest_score;
-}
\ No newline at end of file
+}
+
+// The in-place decoders write byte j only after reading past input
+// character 2j (hex) or 4j/3 (base64), so output never overtakes input and
+// the decoded bytes end up at the front of the same buffer. Line breaks are
+// skipped so whole files can be decoded in one pass.
+long hex_decode_inplace(char *buffer, size_t len)
+{
+    unsigned char *out = (unsigned char *)buffer;
+    size_t j = 0;
+    int half = -1;
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)buffer[i];
+        if (c == '\n' || c == '\r')
+        {
+            continue;
+        }
+        unsigned char digit = hex_decode_table[c];
+        if (digit == 0)
+        {
+            return -1;
+        }
+        if (half < 0)
+        {
+            half = digit - 1;
+        }
+        else
+        {
+            out[j++] = (unsigned char)(half << 4 | (digit - 1));
+            half = -1;
+        }
+    }
+    if (half >= 0)
+    {
+        return -1; // odd number of digits
+    }
+    return (long)j;
+}
+
+long base64_decode_inplace(char *buffer, size_t len)
+{
+    return base64_std_decode((unsigned char *)buffer, buffer, len);
+}
+
+long decode_inplace(char *buffer, size_t len, enum decode_mode mode)
+{
+    return mode == DECODE_HEX ? hex_decode_inplace(buffer, len) : base64_decode_inplace(buffer, len);
+}
+
+// Private writable mapping: pages are copied on first write, so decoding
+// in place never touches the file and peak memory stays at the input size.
+unsigned char *map_file_private(const char *path, size_t *len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    *len = st.st_size;
+    return data;
+}
+
+void unmap_file(unsigned char *data, size_t len)
+{
+    if (data != NULL)
+    {
+        munmap(data, len);
+    }
+}
+
+unsigned char *decode_file_inplace(const char *path, enum decode_mode mode, long *decoded_len, size_t *mapped_len)
+{
+    unsigned char *data = map_file_private(path, mapped_len);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+
+    *decoded_len = decode_inplace((char *)data, *mapped_len, mode);
+    if (*decoded_len < 0)
+    {
+        unmap_file(data, *mapped_len);
+        return NULL;
+    }
+    return data;
+}
@@ -1,6 +1,25 @@
 #ifndef SET_1_ /* Include guard */
 #define SET_1_
 
+#include <stddef.h>
+
+enum decode_mode
+{
+    DECODE_HEX,
+    DECODE_BASE64
+};
+
+#define XOR_NONTEMPORAL 1
+#define XOR_NONTEMPORAL_THRESHOLD (8 << 20)
+
+typedef struct
+{
+    unsigned char *dst;
+    const unsigned char *a;
+    const unsigned char *b;
+    size_t len;
+} xor_job;
+
 unsigned int *str_to_hexbytes(const char *hex_str);
 
 unsigned int *str_to_base64bytes(const char *base64_str);
@@ -21,6 +40,10 @@ unsigned int *xor_hexbytes(unsigned int *hexbytes_1, unsigned int *hexbytes_2, s
 
 char *xor_hex(const char *input_1, const char *input_2);
 
+void xor_bytes(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t len);
+
+void xor_batch(const xor_job *jobs, size_t count, int flags);
+
 unsigned int get_most_frequent_byte(unsigned int *bytes, size_t len);
 
 int is_english_symbol(unsigned int c);
@@ -35,4 +58,16 @@ int hamming_distance(unsigned int *input_1, unsigned int *input_2, size_t len);
 
 int guess_keysize(char *buffer, int max_keysize, int min_keysize);
 
+long hex_decode_inplace(char *buffer, size_t len);
+
+long base64_decode_inplace(char *buffer, size_t len);
+
+long decode_inplace(char *buffer, size_t len, enum decode_mode mode);
+
+unsigned char *map_file_private(const char *path, size_t *len);
+
+void unmap_file(unsigned char *data, size_t len);
+
+unsigned char *decode_file_inplace(const char *path, enum decode_mode mode, long *decoded_len, size_t *mapped_len);
+
 #endif // SET_1_
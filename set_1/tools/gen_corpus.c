@@ -0,0 +1,392 @@
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../codec.h"
+#include "../../common/thread_pool.h"
+
+// Synthetic corpora for benchmarking the set 1 attacks at scale.
+//
+//     gen_corpus <xor|vigenere|ecb> <size[K|M|G]> <output> [-s seed] [-r ratio] [-k 3,7,29]
+//
+// xor       challenge 4: 60-char hex lines, one in `ratio` is English XOR'd
+//           with a single byte, the rest are random noise.
+// vigenere  challenge 6: base64 blobs (60-char lines, blank line between
+//           records) of English under repeating-key XOR, key lengths drawn
+//           from -k.
+// ecb       challenge 8: 320-char hex lines, one in `ratio` has the repeated
+//           16-byte blocks that give ECB away, the rest are random.
+//
+// Every record has a fixed size, so chunks of records are generated in
+// parallel and written with pwrite at known offsets. Ground truth goes to
+// <output>.truth as one fixed-width line per record. Each chunk seeds its
+// own xoshiro256** stream from (seed, chunk), so output is reproducible
+// regardless of thread count.
+
+#define CHUNK_BYTES (4 << 20)
+#define XOR_PLAIN_LEN 30
+#define VIGENERE_PLAIN_LEN 2880
+#define VIGENERE_LINE 60
+#define ECB_LINE_BYTES 160
+#define ECB_BLOCK 16
+#define MAX_KEYS 16
+#define MAX_KEYSIZE 40
+
+enum corpus_kind
+{
+    CORPUS_XOR,
+    CORPUS_VIGENERE,
+    CORPUS_ECB
+};
+
+typedef struct
+{
+    uint64_t s[4];
+} xoshiro256;
+
+typedef struct
+{
+    enum corpus_kind kind;
+    uint64_t seed;
+    unsigned int ratio;
+    int keysizes[MAX_KEYS];
+    int keysize_count;
+    size_t record_size;
+    size_t truth_size;
+    size_t records;
+    size_t records_per_chunk;
+    int out_fd;
+    int truth_fd;
+} corpus;
+
+static const char *words[] = {
+    "the", "of", "and", "to", "in", "is", "you", "that", "it", "he", "was", "for",
+    "on", "are", "as", "with", "his", "they", "at", "be", "this", "have", "from",
+    "or", "one", "had", "by", "word", "but", "not", "what", "all", "were", "we",
+    "when", "your", "can", "said", "there", "use", "an", "each", "which", "she",
+    "do", "how", "their", "if", "will", "up", "other", "about", "out", "many",
+    "then", "them", "these", "so", "some", "her", "would", "make", "like", "him",
+    "into", "time", "has", "look", "two", "more", "write", "go", "see", "number"};
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void xoshiro_seed(xoshiro256 *rng, uint64_t seed, uint64_t stream)
+{
+    uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int i = 0; i < 4; i++)
+    {
+        rng->s[i] = splitmix64(&state);
+    }
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t xoshiro_next(xoshiro256 *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+static uint64_t xoshiro_below(xoshiro256 *rng, uint64_t bound)
+{
+    return (uint64_t)(((unsigned __int128)xoshiro_next(rng) * bound) >> 64);
+}
+
+static void random_bytes(xoshiro256 *rng, unsigned char *out, size_t len)
+{
+    for (size_t i = 0; i < len; i += 8)
+    {
+        uint64_t r = xoshiro_next(rng);
+        size_t n = len - i < 8 ? len - i : 8;
+        memcpy(out + i, &r, n);
+    }
+}
+
+static void english_text(xoshiro256 *rng, unsigned char *out, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        const char *word = words[xoshiro_below(rng, sizeof(words) / sizeof(words[0]))];
+        for (size_t k = 0; word[k] && i < len; k++)
+        {
+            out[i++] = (unsigned char)word[k];
+        }
+        if (i < len)
+        {
+            out[i++] = ' ';
+        }
+    }
+}
+
+static void write_xor_record(const corpus *c, xoshiro256 *rng, char *out, char *truth)
+{
+    unsigned char plain[XOR_PLAIN_LEN];
+    int hit = xoshiro_below(rng, c->ratio) == 0;
+    unsigned char key = 0;
+    if (hit)
+    {
+        key = (unsigned char)(1 + xoshiro_below(rng, 255));
+        english_text(rng, plain, sizeof(plain));
+        for (size_t i = 0; i < sizeof(plain); i++)
+        {
+            plain[i] ^= key;
+        }
+    }
+    else
+    {
+        random_bytes(rng, plain, sizeof(plain));
+    }
+    hex_encode(out, plain, sizeof(plain));
+    out[2 * XOR_PLAIN_LEN] = '\n';
+    snprintf(truth, c->truth_size + 1, "%c %02x\n", hit ? '+' : '-', key);
+}
+
+static void write_vigenere_record(const corpus *c, xoshiro256 *rng, char *out, char *truth)
+{
+    unsigned char plain[VIGENERE_PLAIN_LEN];
+    unsigned char key[MAX_KEYSIZE];
+    char encoded[VIGENERE_PLAIN_LEN / 3 * 4 + 1];
+    int keysize = c->keysizes[xoshiro_below(rng, c->keysize_count)];
+
+    random_bytes(rng, key, keysize);
+    english_text(rng, plain, sizeof(plain));
+    for (size_t i = 0; i < sizeof(plain); i++)
+    {
+        plain[i] ^= key[i % keysize];
+    }
+    base64_std_encode(encoded, plain, sizeof(plain));
+    for (size_t i = 0; i < sizeof(encoded) - 1; i += VIGENERE_LINE)
+    {
+        memcpy(out, encoded + i, VIGENERE_LINE);
+        out[VIGENERE_LINE] = '\n';
+        out += VIGENERE_LINE + 1;
+    }
+    *out = '\n';
+
+    char key_hex[2 * MAX_KEYSIZE + 1];
+    hex_encode(key_hex, key, keysize);
+    snprintf(truth, c->truth_size + 1, "%02d %-*s\n", keysize, 2 * MAX_KEYSIZE, key_hex);
+}
+
+static void write_ecb_record(const corpus *c, xoshiro256 *rng, char *out, char *truth)
+{
+    unsigned char line[ECB_LINE_BYTES];
+    int hit = xoshiro_below(rng, c->ratio) == 0;
+    random_bytes(rng, line, sizeof(line));
+    if (hit)
+    {
+        // No AES in this tree; what challenge 8 detects is identical
+        // ciphertext blocks, so repeat a few random blocks across the line.
+        size_t blocks = ECB_LINE_BYTES / ECB_BLOCK;
+        size_t distinct = 2 + xoshiro_below(rng, blocks / 2 - 1);
+        for (size_t b = distinct; b < blocks; b++)
+        {
+            memcpy(line + b * ECB_BLOCK, line + xoshiro_below(rng, distinct) * ECB_BLOCK, ECB_BLOCK);
+        }
+    }
+    hex_encode(out, line, sizeof(line));
+    out[2 * ECB_LINE_BYTES] = '\n';
+    snprintf(truth, c->truth_size + 1, "%c\n", hit ? '+' : '-');
+}
+
+static void generate_chunks(size_t first, size_t last, void *ctx)
+{
+    const corpus *c = ctx;
+    char *out = malloc(c->record_size * c->records_per_chunk + 1);
+    char *truth = malloc(c->truth_size * c->records_per_chunk + 1);
+
+    for (size_t chunk = first; chunk < last; chunk++)
+    {
+        size_t begin = chunk * c->records_per_chunk;
+        size_t end = begin + c->records_per_chunk < c->records ? begin + c->records_per_chunk : c->records;
+        xoshiro256 rng;
+        xoshiro_seed(&rng, c->seed, chunk);
+
+        for (size_t r = begin; r < end; r++)
+        {
+            char *record = out + (r - begin) * c->record_size;
+            char *record_truth = truth + (r - begin) * c->truth_size;
+            switch (c->kind)
+            {
+            case CORPUS_XOR:
+                write_xor_record(c, &rng, record, record_truth);
+                break;
+            case CORPUS_VIGENERE:
+                write_vigenere_record(c, &rng, record, record_truth);
+                break;
+            case CORPUS_ECB:
+                write_ecb_record(c, &rng, record, record_truth);
+                break;
+            }
+        }
+
+        if (pwrite(c->out_fd, out, (end - begin) * c->record_size, begin * c->record_size) < 0 ||
+            pwrite(c->truth_fd, truth, (end - begin) * c->truth_size, begin * c->truth_size) < 0)
+        {
+            perror("pwrite");
+            exit(1);
+        }
+    }
+
+    free(out);
+    free(truth);
+}
+
+static size_t parse_size(const char *arg)
+{
+    char *end;
+    size_t size = strtoull(arg, &end, 10);
+    switch (*end)
+    {
+    case 'G':
+    case 'g':
+        size <<= 10;
+        /* fall through */
+    case 'M':
+    case 'm':
+        size <<= 10;
+        /* fall through */
+    case 'K':
+    case 'k':
+        size <<= 10;
+    }
+    return size;
+}
+
+static int parse_keysizes(corpus *c, char *arg)
+{
+    c->keysize_count = 0;
+    for (char *tok = strtok(arg, ","); tok != NULL && c->keysize_count < MAX_KEYS; tok = strtok(NULL, ","))
+    {
+        int keysize = atoi(tok);
+        if (keysize < 1 || keysize > MAX_KEYSIZE)
+        {
+            return 0;
+        }
+        c->keysizes[c->keysize_count++] = keysize;
+    }
+    return c->keysize_count > 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s <xor|vigenere|ecb> <size[K|M|G]> <output> [-s seed] [-r ratio] [-k 3,7,29]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    corpus c = {0};
+    c.seed = 1;
+    c.ratio = 100;
+    c.keysizes[0] = 5;
+    c.keysizes[1] = 13;
+    c.keysizes[2] = 29;
+    c.keysize_count = 3;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:k:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            c.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'r':
+            c.ratio = (unsigned int)atoi(optarg);
+            break;
+        case 'k':
+            if (!parse_keysizes(&c, optarg))
+            {
+                usage(argv[0]);
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind != 3 || c.ratio == 0)
+    {
+        usage(argv[0]);
+    }
+
+    const char *kind = argv[optind];
+    if (strcmp(kind, "xor") == 0)
+    {
+        c.kind = CORPUS_XOR;
+        c.record_size = 2 * XOR_PLAIN_LEN + 1;
+        c.truth_size = 5;
+    }
+    else if (strcmp(kind, "vigenere") == 0)
+    {
+        c.kind = CORPUS_VIGENERE;
+        c.record_size = VIGENERE_PLAIN_LEN / 3 * 4 / VIGENERE_LINE * (VIGENERE_LINE + 1) + 1;
+        c.truth_size = 3 + 2 * MAX_KEYSIZE + 1;
+    }
+    else if (strcmp(kind, "ecb") == 0)
+    {
+        c.kind = CORPUS_ECB;
+        c.record_size = 2 * ECB_LINE_BYTES + 1;
+        c.truth_size = 2;
+    }
+    else
+    {
+        usage(argv[0]);
+    }
+
+    size_t size = parse_size(argv[optind + 1]);
+    c.records = size / c.record_size > 0 ? size / c.record_size : 1;
+    c.records_per_chunk = CHUNK_BYTES / c.record_size;
+
+    char truth_path[4096];
+    snprintf(truth_path, sizeof(truth_path), "%s.truth", argv[optind + 2]);
+    c.out_fd = open(argv[optind + 2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    c.truth_fd = open(truth_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (c.out_fd < 0 || c.truth_fd < 0)
+    {
+        printf("Cannot open file \n");
+        exit(1);
+    }
+    if (ftruncate(c.out_fd, c.records * c.record_size) < 0 ||
+        ftruncate(c.truth_fd, c.records * c.truth_size) < 0)
+    {
+        perror("ftruncate");
+        exit(1);
+    }
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t chunks = (c.records + c.records_per_chunk - 1) / c.records_per_chunk;
+    parallel_for(thread_pool_shared(), 0, chunks, 1, generate_chunks, &c, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    close(c.out_fd);
+    close(c.truth_fd);
+
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%zu records, %zu bytes in %.2fs (%.1f MB/s)\n", c.records, c.records * c.record_size,
+           seconds, c.records * c.record_size / seconds / 1e6);
+    return 0;
+}
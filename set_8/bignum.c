@@ -0,0 +1,699 @@
+#include <string.h>
+#include <sys/random.h>
+#include "bignum.h"
+
+#define BN_DIV_LIMBS (2 * BN_MAX_LIMBS + 2)
+#define DEC_CHUNK 10000000000000000000ULL // 10^19
+#define DEC_CHUNK_DIGITS 19
+
+void bn_zero(limb_t *r, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        r[i] = 0;
+    }
+}
+
+void bn_copy(limb_t *r, const limb_t *a, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        r[i] = a[i];
+    }
+}
+
+void bn_set_word(limb_t *r, size_t n, limb_t w)
+{
+    bn_zero(r, n);
+    r[0] = w;
+}
+
+int bn_is_zero(const limb_t *a, size_t n)
+{
+    limb_t acc = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        acc |= a[i];
+    }
+    return acc == 0;
+}
+
+int bn_cmp(const limb_t *a, const limb_t *b, size_t n)
+{
+    for (size_t i = n; i-- > 0;)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] > b[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+int bn_cmp_word(const limb_t *a, size_t n, limb_t w)
+{
+    for (size_t i = n; i-- > 1;)
+    {
+        if (a[i] != 0)
+        {
+            return 1;
+        }
+    }
+    return a[0] > w ? 1 : (a[0] < w ? -1 : 0);
+}
+
+limb_t bn_add(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    return bn_add_n(r, a, b, n);
+}
+
+limb_t bn_sub(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    return bn_sub_n(r, a, b, n);
+}
+
+limb_t bn_add_word(limb_t *r, const limb_t *a, size_t n, limb_t w)
+{
+    limb_t carry = w;
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t s = a[i] + carry;
+        carry = s < carry;
+        r[i] = s;
+    }
+    return carry;
+}
+
+limb_t bn_sub_word(limb_t *r, const limb_t *a, size_t n, limb_t w)
+{
+    limb_t borrow = w;
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t d = a[i] - borrow;
+        borrow = a[i] < borrow;
+        r[i] = d;
+    }
+    return borrow;
+}
+
+limb_t bn_mul_word(limb_t *r, const limb_t *a, size_t n, limb_t w)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        r[i] = bn_mac(a[i], w, 0, carry, &carry);
+    }
+    return carry;
+}
+
+size_t bn_bits(const limb_t *a, size_t n)
+{
+    for (size_t i = n; i-- > 0;)
+    {
+        if (a[i] != 0)
+        {
+            return i * BN_LIMB_BITS + (BN_LIMB_BITS - __builtin_clzll(a[i]));
+        }
+    }
+    return 0;
+}
+
+int bn_bit(const limb_t *a, size_t i)
+{
+    return (a[i / BN_LIMB_BITS] >> (i % BN_LIMB_BITS)) & 1;
+}
+
+void bn_shl(limb_t *r, const limb_t *a, size_t n, size_t shift)
+{
+    size_t limbs = shift / BN_LIMB_BITS;
+    unsigned bits = shift % BN_LIMB_BITS;
+    for (size_t i = n; i-- > 0;)
+    {
+        limb_t v = 0;
+        if (i >= limbs)
+        {
+            v = a[i - limbs] << bits;
+            if (bits && i > limbs)
+            {
+                v |= a[i - limbs - 1] >> (BN_LIMB_BITS - bits);
+            }
+        }
+        r[i] = v;
+    }
+}
+
+void bn_shr(limb_t *r, const limb_t *a, size_t n, size_t shift)
+{
+    size_t limbs = shift / BN_LIMB_BITS;
+    unsigned bits = shift % BN_LIMB_BITS;
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t v = 0;
+        if (i + limbs < n)
+        {
+            v = a[i + limbs] >> bits;
+            if (bits && i + limbs + 1 < n)
+            {
+                v |= a[i + limbs + 1] << (BN_LIMB_BITS - bits);
+            }
+        }
+        r[i] = v;
+    }
+}
+
+// r[0..2n) = a * b. r must not alias a or b.
+void bn_mul_schoolbook(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    bn_zero(r, 2 * n);
+    for (size_t i = 0; i < n; i++)
+    {
+        r[i + n] = bn_addmul_1(r + i, a, n, b[i]);
+    }
+}
+
+// r[0..rn) += a[0..an), returns the carry out of r.
+static limb_t bn_add_into(limb_t *r, size_t rn, const limb_t *a, size_t an)
+{
+    limb_t carry = bn_add_n(r, r, a, an);
+    return bn_add_word(r + an, r + an, rn - an, carry);
+}
+
+static limb_t bn_sub_from(limb_t *r, size_t rn, const limb_t *a, size_t an)
+{
+    limb_t borrow = bn_sub_n(r, r, a, an);
+    return bn_sub_word(r + an, r + an, rn - an, borrow);
+}
+
+// One level of (a1*B^h + a0)(b1*B^h + b0) = z2*B^2h + z1*B^h + z0 with
+// z1 = (a0 + a1)(b0 + b1) - z0 - z2, recursing while n stays even and
+// above the threshold.
+void bn_mul_karatsuba(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    if (n < BN_KARATSUBA_THRESHOLD || (n & 1))
+    {
+        bn_mul_schoolbook(r, a, b, n);
+        return;
+    }
+
+    size_t h = n / 2;
+    limb_t sa[BN_MAX_LIMBS / 2], sb[BN_MAX_LIMBS / 2];
+    limb_t z1[BN_MAX_LIMBS + 2];
+    limb_t ca = bn_add_n(sa, a, a + h, h);
+    limb_t cb = bn_add_n(sb, b, b + h, h);
+
+    bn_mul_karatsuba(z1, sa, sb, h);
+    z1[2 * h] = ca & cb;
+    z1[2 * h + 1] = 0;
+    if (ca)
+    {
+        bn_add_into(z1 + h, h + 2, sb, h);
+    }
+    if (cb)
+    {
+        bn_add_into(z1 + h, h + 2, sa, h);
+    }
+
+    bn_mul_karatsuba(r, a, b, h);
+    bn_mul_karatsuba(r + 2 * h, a + h, b + h, h);
+    bn_sub_from(z1, 2 * h + 2, r, 2 * h);
+    bn_sub_from(z1, 2 * h + 2, r + 2 * h, 2 * h);
+    bn_add_into(r + h, 3 * h, z1, 2 * h + 2);
+}
+
+void bn_mul(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    bn_mul_karatsuba(r, a, b, n);
+}
+
+// Off-diagonal products once, doubled, plus the squares on the diagonal.
+void bn_sqr(limb_t *r, const limb_t *a, size_t n)
+{
+    bn_zero(r, 2 * n);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        r[i + n] = bn_addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    }
+    bn_shl(r, r, 2 * n, 1);
+
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t hi;
+        limb_t lo = bn_mac(a[i], a[i], 0, 0, &hi);
+        unsigned __int128 s = (unsigned __int128)r[2 * i] + lo + carry;
+        r[2 * i] = (limb_t)s;
+        s = (unsigned __int128)r[2 * i + 1] + hi + (limb_t)(s >> 64);
+        r[2 * i + 1] = (limb_t)s;
+        carry = (limb_t)(s >> 64);
+    }
+}
+
+// q may be NULL or alias a. Returns a mod w.
+limb_t bn_div_word(limb_t *q, const limb_t *a, size_t n, limb_t w)
+{
+    limb_t rem = 0;
+    for (size_t i = n; i-- > 0;)
+    {
+        unsigned __int128 num = (unsigned __int128)rem << 64 | a[i];
+        limb_t digit = (limb_t)(num / w);
+        rem = (limb_t)(num - (unsigned __int128)digit * w);
+        if (q != NULL)
+        {
+            q[i] = digit;
+        }
+    }
+    return rem;
+}
+
+limb_t bn_mod_word(const limb_t *a, size_t n, limb_t w)
+{
+    return bn_div_word(NULL, a, n, w);
+}
+
+// Knuth's algorithm D. q gets na limbs and r gets nd limbs; either may be
+// NULL. na may be up to 2 * BN_MAX_LIMBS + 1 so double-width products can
+// be reduced directly.
+void bn_divmod(limb_t *q, limb_t *r, const limb_t *a, size_t na, const limb_t *d, size_t nd)
+{
+    limb_t quot[BN_DIV_LIMBS] = {0};
+    size_t dn = nd;
+    size_t an = na;
+    while (dn > 0 && d[dn - 1] == 0)
+    {
+        dn--;
+    }
+    while (an > 0 && a[an - 1] == 0)
+    {
+        an--;
+    }
+
+    if (dn == 1)
+    {
+        limb_t rem = bn_div_word(quot, a, na, d[0]);
+        if (q != NULL)
+        {
+            bn_copy(q, quot, na);
+        }
+        if (r != NULL)
+        {
+            bn_set_word(r, nd, rem);
+        }
+        return;
+    }
+    if (dn == 0 || an < dn)
+    {
+        // a is shorter than d, so it fits in r; copy first since r may alias a.
+        if (r != NULL)
+        {
+            limb_t keep[BN_MAX_LIMBS];
+            size_t len = an < nd ? an : nd;
+            bn_copy(keep, a, len);
+            bn_zero(r, nd);
+            bn_copy(r, keep, len);
+        }
+        if (q != NULL)
+        {
+            bn_zero(q, na);
+        }
+        return;
+    }
+
+    unsigned s = __builtin_clzll(d[dn - 1]);
+    limb_t v[BN_DIV_LIMBS];
+    limb_t u[BN_DIV_LIMBS];
+    bn_copy(v, d, dn);
+    bn_shl(v, v, dn, s);
+    bn_copy(u, a, an);
+    u[an] = 0;
+    bn_shl(u, u, an + 1, s);
+
+    for (size_t j = an - dn + 1; j-- > 0;)
+    {
+        unsigned __int128 num = (unsigned __int128)u[j + dn] << 64 | u[j + dn - 1];
+        unsigned __int128 qhat = num / v[dn - 1];
+        unsigned __int128 rhat = num % v[dn - 1];
+        while ((qhat >> 64) != 0 ||
+               qhat * v[dn - 2] > (rhat << 64 | u[j + dn - 2]))
+        {
+            qhat--;
+            rhat += v[dn - 1];
+            if ((rhat >> 64) != 0)
+            {
+                break;
+            }
+        }
+
+        limb_t carry = 0, borrow = 0;
+        for (size_t i = 0; i < dn; i++)
+        {
+            limb_t p = bn_mac((limb_t)qhat, v[i], 0, carry, &carry);
+            unsigned __int128 t = (unsigned __int128)u[i + j] - p - borrow;
+            u[i + j] = (limb_t)t;
+            borrow = (limb_t)(t >> 64) & 1;
+        }
+        unsigned __int128 t = (unsigned __int128)u[j + dn] - carry - borrow;
+        u[j + dn] = (limb_t)t;
+
+        if ((t >> 64) != 0)
+        {
+            qhat--;
+            u[j + dn] += bn_add_n(u + j, u + j, v, dn);
+        }
+        quot[j] = (limb_t)qhat;
+    }
+
+    if (q != NULL)
+    {
+        bn_copy(q, quot, na);
+    }
+    if (r != NULL)
+    {
+        bn_shr(u, u, dn + 1, s);
+        bn_zero(r, nd);
+        bn_copy(r, u, dn);
+    }
+}
+
+void bn_mod(limb_t *r, const limb_t *a, size_t na, const limb_t *m, size_t nm)
+{
+    bn_divmod(NULL, r, a, na, m, nm);
+}
+
+// Returns 0 on a non-digit or if the value does not fit in n limbs.
+int bn_from_dec(limb_t *r, size_t n, const char *str)
+{
+    bn_zero(r, n);
+    while (*str)
+    {
+        limb_t chunk = 0, scale = 1;
+        for (int k = 0; k < DEC_CHUNK_DIGITS && *str; k++, str++)
+        {
+            if (*str < '0' || *str > '9')
+            {
+                return 0;
+            }
+            chunk = chunk * 10 + (limb_t)(*str - '0');
+            scale *= 10;
+        }
+        if (bn_mul_word(r, r, n, scale) != 0 || bn_add_word(r, r, n, chunk) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// n may be up to 2 * BN_MAX_LIMBS, so full products can be printed.
+char *bn_to_dec(char *buf, size_t buflen, const limb_t *a, size_t n)
+{
+    limb_t t[BN_DIV_LIMBS];
+    char tmp[2 * BN_MAX_BITS * 3 / 10 + DEC_CHUNK_DIGITS + 2];
+    size_t len = 0;
+
+    bn_copy(t, a, n);
+    do
+    {
+        limb_t chunk = bn_div_word(t, t, n, DEC_CHUNK);
+        for (int k = 0; k < DEC_CHUNK_DIGITS; k++)
+        {
+            tmp[len++] = (char)('0' + chunk % 10);
+            chunk /= 10;
+        }
+    } while (!bn_is_zero(t, n));
+
+    while (len > 1 && tmp[len - 1] == '0')
+    {
+        len--;
+    }
+    if (len + 1 > buflen)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] = tmp[len - 1 - i];
+    }
+    buf[len] = 0;
+    return buf;
+}
+
+// Big-endian byte strings, as used on the wire and as MAC/hash input.
+void bn_from_bytes(limb_t *r, size_t n, const unsigned char *bytes, size_t len)
+{
+    bn_zero(r, n);
+    for (size_t i = 0; i < len && i < n * 8; i++)
+    {
+        r[i / 8] |= (limb_t)bytes[len - 1 - i] << (8 * (i % 8));
+    }
+}
+
+void bn_to_bytes(unsigned char *bytes, size_t len, const limb_t *a, size_t n)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        bytes[len - 1 - i] = i < n * 8 ? (unsigned char)(a[i / 8] >> (8 * (i % 8))) : 0;
+    }
+}
+
+// Uniform in [0, bound) by rejection on the bound's bit length.
+void bn_random_below(limb_t *r, const limb_t *bound, size_t n)
+{
+    size_t bits = bn_bits(bound, n);
+    size_t limbs = BN_LIMBS(bits);
+    bn_zero(r, n);
+    if (bits == 0)
+    {
+        return;
+    }
+    do
+    {
+        getrandom(r, limbs * sizeof(limb_t), 0);
+        if (bits % BN_LIMB_BITS)
+        {
+            r[limbs - 1] &= ((limb_t)1 << (bits % BN_LIMB_BITS)) - 1;
+        }
+    } while (bn_cmp(r, bound, n) >= 0);
+}
+
+// Binary GCD; r may alias a or b.
+void bn_gcd(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    limb_t u[BN_MAX_LIMBS], v[BN_MAX_LIMBS];
+    size_t shift = 0;
+
+    bn_copy(u, a, n);
+    bn_copy(v, b, n);
+    if (bn_is_zero(u, n) || bn_is_zero(v, n))
+    {
+        bn_copy(r, bn_is_zero(u, n) ? v : u, n);
+        return;
+    }
+    while (((u[0] | v[0]) & 1) == 0)
+    {
+        bn_shr(u, u, n, 1);
+        bn_shr(v, v, n, 1);
+        shift++;
+    }
+    while ((u[0] & 1) == 0)
+    {
+        bn_shr(u, u, n, 1);
+    }
+    while (!bn_is_zero(v, n))
+    {
+        while ((v[0] & 1) == 0)
+        {
+            bn_shr(v, v, n, 1);
+        }
+        if (bn_cmp(u, v, n) > 0)
+        {
+            limb_t t[BN_MAX_LIMBS];
+            bn_copy(t, u, n);
+            bn_copy(u, v, n);
+            bn_copy(v, t, n);
+        }
+        bn_sub(v, v, u, n);
+    }
+    bn_shl(r, u, n, shift);
+}
+
+// x = x / 2 mod m for odd m, keeping the carry of x + m.
+static void half_mod(limb_t *x, const limb_t *m, size_t n)
+{
+    limb_t carry = 0;
+    if (x[0] & 1)
+    {
+        carry = bn_add(x, x, m, n);
+    }
+    bn_shr(x, x, n, 1);
+    x[n - 1] |= carry << 63;
+}
+
+// Binary extended Euclid for odd m: branches on the operands, so only for
+// public values. Returns 0 if a has no inverse mod m.
+int bn_inv_mod_vartime(limb_t *r, const limb_t *a, const limb_t *m, size_t n)
+{
+    limb_t u[BN_MAX_LIMBS], v[BN_MAX_LIMBS], x1[BN_MAX_LIMBS], x2[BN_MAX_LIMBS];
+
+    bn_mod(u, a, n, m, n);
+    bn_copy(v, m, n);
+    bn_set_word(x1, n, 1);
+    bn_zero(x2, n);
+    if (bn_is_zero(u, n))
+    {
+        return 0;
+    }
+    while (bn_cmp_word(u, n, 1) != 0 && bn_cmp_word(v, n, 1) != 0)
+    {
+        while ((u[0] & 1) == 0)
+        {
+            bn_shr(u, u, n, 1);
+            half_mod(x1, m, n);
+        }
+        while ((v[0] & 1) == 0)
+        {
+            bn_shr(v, v, n, 1);
+            half_mod(x2, m, n);
+        }
+        if (bn_cmp(u, v, n) >= 0)
+        {
+            bn_sub(u, u, v, n);
+            if (bn_sub(x1, x1, x2, n))
+            {
+                bn_add(x1, x1, m, n);
+            }
+        }
+        else
+        {
+            bn_sub(v, v, u, n);
+            if (bn_sub(x2, x2, x1, n))
+            {
+                bn_add(x2, x2, m, n);
+            }
+        }
+        if (bn_is_zero(u, n) || bn_is_zero(v, n))
+        {
+            return 0;
+        }
+    }
+    bn_copy(r, bn_cmp_word(u, n, 1) == 0 ? x1 : x2, n);
+    return 1;
+}
+
+void mont_init(mont_ctx *ctx, const limb_t *m, size_t n)
+{
+    limb_t t[BN_DIV_LIMBS];
+    limb_t inv = m[0];
+
+    ctx->n = n;
+    bn_zero(ctx->m, BN_MAX_LIMBS);
+    bn_copy(ctx->m, m, n);
+
+    // Newton iteration doubles the correct low bits each step: 3 -> 96.
+    for (int i = 0; i < 5; i++)
+    {
+        inv *= 2 - m[0] * inv;
+    }
+    ctx->m0inv = (limb_t)0 - inv;
+
+    bn_zero(t, n + 1);
+    t[n] = 1;
+    bn_mod(ctx->one, t, n + 1, m, n);
+
+    bn_zero(t, 2 * n + 1);
+    t[2 * n] = 1;
+    bn_mod(ctx->r2, t, 2 * n + 1, m, n);
+}
+
+// Dispatch to constant-width instantiations so the CIOS loops unroll.
+void mont_mul(const mont_ctx *ctx, limb_t *r, const limb_t *a, const limb_t *b)
+{
+    switch (ctx->n)
+    {
+    case 2:
+        bn_mont_mul_n(r, a, b, ctx->m, ctx->m0inv, 2);
+        break;
+    case 4:
+        bn_mont_mul_n(r, a, b, ctx->m, ctx->m0inv, 4);
+        break;
+    case 8:
+        bn_mont_mul_n(r, a, b, ctx->m, ctx->m0inv, 8);
+        break;
+    case 16:
+        bn_mont_mul_n(r, a, b, ctx->m, ctx->m0inv, 16);
+        break;
+    case 32:
+        bn_mont_mul_n(r, a, b, ctx->m, ctx->m0inv, 32);
+        break;
+    default:
+        bn_mont_mul_n(r, a, b, ctx->m, ctx->m0inv, ctx->n);
+    }
+}
+
+// t has 2n limbs and t < m * R; r = t / R mod m.
+void mont_redc(const mont_ctx *ctx, limb_t *r, const limb_t *t)
+{
+    size_t n = ctx->n;
+    limb_t u[2 * BN_MAX_LIMBS + 1];
+    bn_copy(u, t, 2 * n);
+    u[2 * n] = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t q = u[i] * ctx->m0inv;
+        limb_t carry = bn_addmul_1(u + i, ctx->m, n, q);
+        bn_add_word(u + i + n, u + i + n, n + 1 - i, carry);
+    }
+
+    limb_t d[BN_MAX_LIMBS];
+    limb_t borrow = bn_sub_n(d, u + n, ctx->m, n);
+    bn_copy(r, u + n, n);
+    bn_cmov(r, d, n, u[2 * n] | (borrow ^ 1));
+}
+
+void mont_sqr(const mont_ctx *ctx, limb_t *r, const limb_t *a)
+{
+    if (ctx->n < 4)
+    {
+        mont_mul(ctx, r, a, a);
+        return;
+    }
+    limb_t t[2 * BN_MAX_LIMBS];
+    bn_sqr(t, a, ctx->n);
+    mont_redc(ctx, r, t);
+}
+
+void mont_to(const mont_ctx *ctx, limb_t *r, const limb_t *a)
+{
+    mont_mul(ctx, r, a, ctx->r2);
+}
+
+void mont_from(const mont_ctx *ctx, limb_t *r, const limb_t *a)
+{
+    limb_t one[BN_MAX_LIMBS];
+    bn_set_word(one, ctx->n, 1);
+    mont_mul(ctx, r, a, one);
+}
+
+void mont_add(const mont_ctx *ctx, limb_t *r, const limb_t *a, const limb_t *b)
+{
+    size_t n = ctx->n;
+    limb_t d[BN_MAX_LIMBS];
+    limb_t carry = bn_add_n(r, a, b, n);
+    limb_t borrow = bn_sub_n(d, r, ctx->m, n);
+    bn_cmov(r, d, n, carry | (borrow ^ 1));
+}
+
+void mont_sub(const mont_ctx *ctx, limb_t *r, const limb_t *a, const limb_t *b)
+{
+    size_t n = ctx->n;
+    limb_t d[BN_MAX_LIMBS];
+    limb_t borrow = bn_sub_n(r, a, b, n);
+    bn_add_n(d, r, ctx->m, n);
+    bn_cmov(r, d, n, borrow);
+}
+
+void mont_neg(const mont_ctx *ctx, limb_t *r, const limb_t *a)
+{
+    limb_t zero[BN_MAX_LIMBS] = {0};
+    mont_sub(ctx, r, zero, a);
+}
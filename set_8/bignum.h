@@ -0,0 +1,260 @@
+#ifndef BIGNUM_ /* Include guard */
+#define BIGNUM_
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__BMI2__) && defined(__ADX__)
+#include <immintrin.h>
+#define BN_USE_ADX 1
+#else
+#define BN_USE_ADX 0
+#endif
+
+// Fixed-width multi-precision integers: little-endian arrays of 64-bit
+// limbs, always on the stack. The bnN types fix the width at compile time;
+// the bn_* routines take the limb count explicitly (mpn style) so the same
+// code serves every width, and the hot kernels below are static inline so
+// callers with a constant n get fully specialized code.
+
+typedef uint64_t limb_t;
+
+#define BN_LIMB_BITS 64
+#define BN_LIMBS(bits) (((bits) + BN_LIMB_BITS - 1) / BN_LIMB_BITS)
+#define BN_MAX_BITS 2048
+#define BN_MAX_LIMBS BN_LIMBS(BN_MAX_BITS)
+#define BN_KARATSUBA_THRESHOLD 16
+
+typedef struct
+{
+    limb_t v[BN_LIMBS(128)];
+} bn128;
+
+typedef struct
+{
+    limb_t v[BN_LIMBS(256)];
+} bn256;
+
+typedef struct
+{
+    limb_t v[BN_LIMBS(512)];
+} bn512;
+
+typedef struct
+{
+    limb_t v[BN_LIMBS(1024)];
+} bn1024;
+
+typedef struct
+{
+    limb_t v[BN_LIMBS(2048)];
+} bn2048;
+
+typedef struct
+{
+    size_t n;
+    limb_t m[BN_MAX_LIMBS];
+    limb_t m0inv;             // -m^-1 mod 2^64
+    limb_t one[BN_MAX_LIMBS]; // R mod m, i.e. 1 in Montgomery form
+    limb_t r2[BN_MAX_LIMBS];  // R^2 mod m
+} mont_ctx;
+
+// lo(a * b + c + carry), high limb to *hi. Never overflows 128 bits.
+static inline limb_t bn_mac(limb_t a, limb_t b, limb_t c, limb_t carry, limb_t *hi)
+{
+    unsigned __int128 t = (unsigned __int128)a * b + c + carry;
+    *hi = (limb_t)(t >> 64);
+    return (limb_t)t;
+}
+
+// t[0..n-1] += a[0..n-1] * b, returns the carry limb. With BMI2/ADX the
+// low halves ride the OF chain (adox) and the high halves the CF chain
+// (adcx), so the two additions per limb do not serialize on one flag.
+static inline limb_t bn_addmul_1(limb_t *t, const limb_t *a, size_t n, limb_t b)
+{
+#if BN_USE_ADX
+    unsigned char cf = 0, of = 0;
+    unsigned long long hi_prev = 0;
+    for (size_t j = 0; j < n; j++)
+    {
+        unsigned long long hi, tj = t[j];
+        unsigned long long lo = _mulx_u64(a[j], b, &hi);
+        of = _addcarryx_u64(of, tj, lo, &tj);
+        cf = _addcarryx_u64(cf, tj, hi_prev, &tj);
+        t[j] = tj;
+        hi_prev = hi;
+    }
+    return hi_prev + of + cf;
+#else
+    limb_t carry = 0;
+    for (size_t j = 0; j < n; j++)
+    {
+        t[j] = bn_mac(a[j], b, t[j], carry, &carry);
+    }
+    return carry;
+#endif
+}
+
+static inline limb_t bn_add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned __int128 s = (unsigned __int128)a[i] + b[i] + carry;
+        r[i] = (limb_t)s;
+        carry = (limb_t)(s >> 64);
+    }
+    return carry;
+}
+
+static inline limb_t bn_sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    limb_t borrow = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned __int128 d = (unsigned __int128)a[i] - b[i] - borrow;
+        r[i] = (limb_t)d;
+        borrow = (limb_t)(d >> 64) & 1;
+    }
+    return borrow;
+}
+
+// r = cond ? a : r without branching on cond.
+static inline void bn_cmov(limb_t *r, const limb_t *a, size_t n, limb_t cond)
+{
+    limb_t mask = (limb_t)0 - (cond != 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        r[i] ^= mask & (r[i] ^ a[i]);
+    }
+}
+
+// Swaps a and b when swap is nonzero, with the same memory traffic either way.
+static inline void bn_cswap(limb_t *a, limb_t *b, size_t n, limb_t swap)
+{
+    limb_t mask = (limb_t)0 - (swap != 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t t = mask & (a[i] ^ b[i]);
+        a[i] ^= t;
+        b[i] ^= t;
+    }
+}
+
+// Coarsely integrated operand scanning: each outer step multiplies one limb
+// of b in, then does one limb of reduction fused with the one-limb shift.
+// r may alias a or b. Requires a, b < m and m odd.
+static inline void bn_mont_mul_n(limb_t *r, const limb_t *a, const limb_t *b, const limb_t *m,
+                                 limb_t m0inv, size_t n)
+{
+    limb_t t[BN_MAX_LIMBS + 2];
+    for (size_t j = 0; j < n + 2; j++)
+    {
+        t[j] = 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t carry = bn_addmul_1(t, a, n, b[i]);
+        unsigned __int128 s = (unsigned __int128)t[n] + carry;
+        t[n] = (limb_t)s;
+        t[n + 1] = (limb_t)(s >> 64);
+
+        limb_t q = t[0] * m0inv;
+        bn_mac(q, m[0], t[0], 0, &carry);
+        for (size_t j = 1; j < n; j++)
+        {
+            t[j - 1] = bn_mac(q, m[j], t[j], carry, &carry);
+        }
+        s = (unsigned __int128)t[n] + carry;
+        t[n - 1] = (limb_t)s;
+        t[n] = t[n + 1] + (limb_t)(s >> 64);
+    }
+
+    limb_t d[BN_MAX_LIMBS];
+    limb_t borrow = bn_sub_n(d, t, m, n);
+    for (size_t j = 0; j < n; j++)
+    {
+        r[j] = t[j];
+    }
+    bn_cmov(r, d, n, t[n] | (borrow ^ 1));
+}
+
+void bn_zero(limb_t *r, size_t n);
+
+void bn_copy(limb_t *r, const limb_t *a, size_t n);
+
+void bn_set_word(limb_t *r, size_t n, limb_t w);
+
+int bn_is_zero(const limb_t *a, size_t n);
+
+int bn_cmp(const limb_t *a, const limb_t *b, size_t n);
+
+int bn_cmp_word(const limb_t *a, size_t n, limb_t w);
+
+limb_t bn_add(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+limb_t bn_sub(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+limb_t bn_add_word(limb_t *r, const limb_t *a, size_t n, limb_t w);
+
+limb_t bn_sub_word(limb_t *r, const limb_t *a, size_t n, limb_t w);
+
+limb_t bn_mul_word(limb_t *r, const limb_t *a, size_t n, limb_t w);
+
+size_t bn_bits(const limb_t *a, size_t n);
+
+int bn_bit(const limb_t *a, size_t i);
+
+void bn_shl(limb_t *r, const limb_t *a, size_t n, size_t shift);
+
+void bn_shr(limb_t *r, const limb_t *a, size_t n, size_t shift);
+
+void bn_mul_schoolbook(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+void bn_mul_karatsuba(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+void bn_mul(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+void bn_sqr(limb_t *r, const limb_t *a, size_t n);
+
+limb_t bn_div_word(limb_t *q, const limb_t *a, size_t n, limb_t w);
+
+limb_t bn_mod_word(const limb_t *a, size_t n, limb_t w);
+
+void bn_divmod(limb_t *q, limb_t *r, const limb_t *a, size_t na, const limb_t *d, size_t nd);
+
+void bn_mod(limb_t *r, const limb_t *a, size_t na, const limb_t *m, size_t nm);
+
+int bn_from_dec(limb_t *r, size_t n, const char *str);
+
+char *bn_to_dec(char *buf, size_t buflen, const limb_t *a, size_t n);
+
+void bn_from_bytes(limb_t *r, size_t n, const unsigned char *bytes, size_t len);
+
+void bn_to_bytes(unsigned char *bytes, size_t len, const limb_t *a, size_t n);
+
+void bn_random_below(limb_t *r, const limb_t *bound, size_t n);
+
+void bn_gcd(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+int bn_inv_mod_vartime(limb_t *r, const limb_t *a, const limb_t *m, size_t n);
+
+void mont_init(mont_ctx *ctx, const limb_t *m, size_t n);
+
+void mont_mul(const mont_ctx *ctx, limb_t *r, const limb_t *a, const limb_t *b);
+
+void mont_sqr(const mont_ctx *ctx, limb_t *r, const limb_t *a);
+
+void mont_redc(const mont_ctx *ctx, limb_t *r, const limb_t *t);
+
+void mont_to(const mont_ctx *ctx, limb_t *r, const limb_t *a);
+
+void mont_from(const mont_ctx *ctx, limb_t *r, const limb_t *a);
+
+void mont_add(const mont_ctx *ctx, limb_t *r, const limb_t *a, const limb_t *b);
+
+void mont_sub(const mont_ctx *ctx, limb_t *r, const limb_t *a, const limb_t *b);
+
+void mont_neg(const mont_ctx *ctx, limb_t *r, const limb_t *a);
+
+#endif // BIGNUM_
@@ -1,3 +1,8 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../set_8.h"
+
 
 // // ------------------------------------------------------------
 
@@ -93,3 +98,69 @@
 
 //    Once (r1*r2*...*rn) > q, you'll have enough information to
 //    reassemble Bob's secret key using the Chinese Remainder Theorem.
+
+#define SMALL_FACTOR_BOUND (1 << 16)
+
+static const char *p_str = "7199773997391911030609999317773941274322764333428698921736339643928346453700085358802973900485592910475480089726140708102474957429903531369589969318716771";
+static const char *g_str = "4565356397095740655436854503483826832136106141639563487732438195343690437606117828318042418238184896212352329118608100083187535033402010599512641674644143";
+static const char *q_str = "236234353446506858198510045061214171961";
+static const char *message = "crazy flamboyant for the rap enjoyment";
+
+int main(void)
+{
+    dh_group grp;
+    limb_t x[BN_MAX_LIMBS], pub[BN_MAX_LIMBS], pm1[BN_MAX_LIMBS], j[BN_MAX_LIMBS];
+    limb_t recovered[BN_MAX_LIMBS];
+    char buf[1024];
+    struct timespec start, stop;
+    factor_params params;
+    factor_list factors;
+    crt_ctx crt;
+
+    dh_group_init(&grp, p_str, g_str, q_str);
+    size_t n = grp.n;
+    dh_keypair(&grp, x, pub);
+
+    bn_sub_word(pm1, grp.p, n, 1);
+    bn_divmod(j, NULL, pm1, n, grp.q, n);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    factor_params_default(&params);
+    params.trial_bound = SMALL_FACTOR_BOUND;
+    params.smooth_bound = SMALL_FACTOR_BOUND;
+    factor(&factors, j, n, &params);
+    crt_init(&crt, n);
+
+    for (size_t i = 0; i < factors.count && !crt_exceeds(&crt, grp.q); i++)
+    {
+        if (factors.factors[i].multiplicity != 1)
+        {
+            continue;
+        }
+        limb_t r = factors.factors[i].value[0];
+
+        limb_t h[BN_MAX_LIMBS], shared[BN_MAX_LIMBS];
+        unsigned char tag[SHA256_DIGEST_SIZE];
+        dh_subgroup_element(&grp, h, r);
+        dh_shared(&grp, shared, h, x); // Bob, answering Eve's bogus public key
+        dh_mac(&grp, tag, shared, (const unsigned char *)message, strlen(message));
+
+        long b = dh_residue_search(&grp, h, r, tag, (const unsigned char *)message, strlen(message));
+        if (b < 0)
+        {
+            printf("No residue found mod %llu\n", (unsigned long long)r);
+            continue;
+        }
+        printf("x = %ld mod %llu\n", b, (unsigned long long)r);
+        crt_add(&crt, (limb_t)b, r);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    crt_result(&crt, recovered, NULL);
+    crt_free(&crt);
+    printf("Recovered: %s\n", bn_to_dec(buf, sizeof(buf), recovered, n));
+    printf("Bob's x:   %s\n", bn_to_dec(buf, sizeof(buf), x, n));
+    printf("%s in %.1f ms\n", bn_cmp(recovered, x, n) == 0 ? "Match" : "Mismatch",
+           (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6);
+    return 0;
+}
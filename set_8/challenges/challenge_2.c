@@ -162,3 +162,122 @@
 // much of Bob's secret as you can. You'll be able to get a good chunk of
 // it, but not the whole thing. Then use the kangaroo algorithm to run
 // down the remaining bits.
+
+#include <stdio.h>
+#include <string.h>
+#include "../set_8.h"
+
+#define SMALL_FACTOR_BOUND (1 << 16)
+
+static const char *p_str = "11470374874925275658116663507232161402086650258453896274534991676898999262641581519101074740642369848233294239851519212341844337347119899874391456329785623";
+static const char *q_str = "335062023296420808191071248367701059461";
+static const char *g_str = "622952335333961296978159266084741085889881358738459939978290179936063635566740258555167783009058567397963466103140082647486611657350811560630587013183357";
+static const char *y20_str = "7760073848032689505395005705677365876654629189298052775754597607446617558600394076764814236081991643094239886772481052254010323780165093955236429914607119";
+static const char *y40_str = "9388897478013399550694114614498790691034187453089355259602614074132918843899833277397448144245883225611726912025846772975325932794909655215329941809013733";
+static const char *message = "crazy flamboyant for the rap enjoyment";
+
+static void report(const char *label, int found, uint64_t index, const kangaroo_stats *stats)
+{
+    if (found)
+    {
+        printf("%s: index %llu\n", label, (unsigned long long)index);
+    }
+    else
+    {
+        printf("%s: no collision\n", label);
+    }
+    printf("    %llu jumps in %.2f s, %.2f M jumps/s on %u threads\n", (unsigned long long)stats->jumps,
+           stats->seconds, stats->jumps / stats->seconds / 1e6, stats->threads);
+    printf("    expected %llu jumps, actual/expected %.2f, %llu distinguished points (2^-%u), %llu useless\n",
+           (unsigned long long)stats->expected_jumps, (double)stats->jumps / stats->expected_jumps,
+           (unsigned long long)stats->distinguished, stats->dp_bits,
+           (unsigned long long)stats->useless_collisions);
+    if (stats->resumed)
+    {
+        printf("    resumed from checkpoint\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *checkpoint = argc > 1 ? argv[1] : NULL; // distinguished points for the 2^40 search
+    dh_group grp;
+    limb_t g[BN_MAX_LIMBS], y[BN_MAX_LIMBS], x[BN_MAX_LIMBS], pub[BN_MAX_LIMBS];
+    limb_t pm1[BN_MAX_LIMBS], j[BN_MAX_LIMBS], residue[BN_MAX_LIMBS], modulus[BN_MAX_LIMBS];
+    limb_t e[BN_MAX_LIMBS], t[BN_MAX_LIMBS], g_r[BN_MAX_LIMBS], bound[BN_MAX_LIMBS];
+    char buf[1024];
+    uint64_t index;
+    kangaroo_stats stats;
+    factor_params params;
+    factor_list factors;
+    crt_ctx crt;
+
+    dh_group_init(&grp, p_str, g_str, q_str);
+    size_t n = grp.n;
+    mont_from(&grp.ctx, g, grp.g);
+
+    bn_from_dec(y, n, y20_str);
+    int found = dh_kangaroo(&grp, &index, g, y, 0, (uint64_t)1 << 20, NULL, &stats);
+    report("[0, 2^20]", found, index, &stats);
+
+    bn_from_dec(y, n, y40_str);
+    found = dh_kangaroo(&grp, &index, g, y, 0, (uint64_t)1 << 40, checkpoint, &stats);
+    report("[0, 2^40]", found, index, &stats);
+
+    // Bob's key: residues from the small subgroups of j = (p-1)/q first.
+    dh_keypair(&grp, x, pub);
+    bn_sub_word(pm1, grp.p, n, 1);
+    bn_divmod(j, NULL, pm1, n, grp.q, n);
+    factor_params_default(&params);
+    params.trial_bound = SMALL_FACTOR_BOUND;
+    params.smooth_bound = SMALL_FACTOR_BOUND;
+    factor(&factors, j, n, &params);
+    crt_init(&crt, n);
+
+    for (size_t i = 0; i < factors.count; i++)
+    {
+        if (factors.factors[i].multiplicity != 1)
+        {
+            continue;
+        }
+        limb_t r = factors.factors[i].value[0];
+        limb_t h[BN_MAX_LIMBS], shared[BN_MAX_LIMBS];
+        unsigned char tag[SHA256_DIGEST_SIZE];
+        dh_subgroup_element(&grp, h, r);
+        dh_shared(&grp, shared, h, x);
+        dh_mac(&grp, tag, shared, (const unsigned char *)message, strlen(message));
+
+        long b = dh_residue_search(&grp, h, r, tag, (const unsigned char *)message, strlen(message));
+        if (b >= 0)
+        {
+            crt_add(&crt, (limb_t)b, r);
+        }
+    }
+    crt_result(&crt, residue, modulus);
+    crt_free(&crt);
+    printf("x = %s", bn_to_dec(buf, sizeof(buf), residue, n));
+    printf(" mod %s\n", bn_to_dec(buf, sizeof(buf), modulus, n));
+
+    // x = n + m r: y' = y g^-n = (g^r)^m with m in [0, (q-1)/r].
+    bn_sub(e, grp.q, residue, n);
+    mod_exp(&grp.ctx, t, g, e, n);
+    mont_to(&grp.ctx, t, t);
+    mont_mul(&grp.ctx, y, pub, t);
+    mod_exp(&grp.ctx, g_r, g, modulus, n);
+    bn_sub_word(t, grp.q, n, 1);
+    bn_divmod(bound, NULL, t, n, modulus, n);
+    if (bn_bits(bound, n) > 63)
+    {
+        printf("Remaining range too wide for the kangaroo\n");
+        return 1;
+    }
+
+    found = dh_kangaroo(&grp, &index, g_r, y, 0, bound[0], NULL, &stats);
+    report("Bob's m", found, index, &stats);
+    bn_mul_word(t, modulus, n, index);
+    bn_add(t, t, residue, n);
+    printf("Recovered: %s\n", bn_to_dec(buf, sizeof(buf), t, n));
+    printf("Bob's x:   %s\n", bn_to_dec(buf, sizeof(buf), x, n));
+    printf("%s\n", found && bn_cmp(t, x, n) == 0 ? "Match" : "Mismatch");
+    return 0;
+}
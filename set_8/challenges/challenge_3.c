@@ -275,3 +275,89 @@
 
 // Implement the key-recovery attack from #57 using small-order points
 // from invalid curves.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../set_8.h"
+
+#define SMALL_ORDER_BOUND (1 << 16)
+
+static const char *p_str = "233970423115425145524320034830162017933";
+static const char *order_str = "29246302889428143187362802287225875743";
+static const char *bogus_b[] = {"210", "504", "727"};
+static const char *bogus_order[] = {"233970423115425145550826547352470124412", "233970423115425145544350131142039591210",
+                                    "233970423115425145545378039958152057148"};
+static const char *message = "crazy flamboyant for the rap enjoyment";
+
+typedef struct
+{
+    const ec_curve *curve;
+    const limb_t *secret;
+} victim;
+
+// Bob takes whatever point he is sent, on or off the curve.
+static void bob_oracle(unsigned char *tag, const ec_affine *point, void *ctx)
+{
+    const victim *bob = ctx;
+    ec_jacobian shared;
+    ec_affine normal;
+    ec_mul(bob->curve, &shared, point, bob->secret, bob->curve->order_n);
+    ec_to_affine(bob->curve, &normal, &shared);
+    ec_mac(bob->curve, tag, &normal, (const unsigned char *)message, strlen(message));
+}
+
+int main(void)
+{
+    ec_curve curve, bogus[3];
+    limb_t alice[BN_MAX_LIMBS], bob[BN_MAX_LIMBS], shared_a[BN_MAX_LIMBS], shared_b[BN_MAX_LIMBS];
+    limb_t recovered[BN_MAX_LIMBS], modulus[BN_MAX_LIMBS];
+    ec_affine alice_pub, bob_pub;
+    ec_jacobian check;
+    char buf[256];
+    struct timespec start, stop;
+
+    if (!ec_curve_init(&curve, p_str, "-95051", "11279326", "182", "85518893674295321206118380980485522083",
+                       order_str))
+    {
+        printf("Bad curve parameters\n");
+        return 1;
+    }
+    ec_mul(&curve, &check, &curve.base, curve.order, curve.order_n);
+    printf("order * G is %s\n", ec_is_infinity(&curve, &check) ? "the identity" : "NOT the identity");
+
+    ec_keypair(&curve, alice, &alice_pub);
+    ec_keypair(&curve, bob, &bob_pub);
+    ec_ecdh(&curve, shared_a, &bob_pub, alice);
+    ec_ecdh(&curve, shared_b, &alice_pub, bob);
+    printf("ECDH handshake %s\n", bn_cmp(shared_a, shared_b, curve.n) == 0 ? "agrees" : "disagrees");
+
+    for (int i = 0; i < 3; i++)
+    {
+        ec_curve_with_b(&bogus[i], &curve, bogus_b[i], bogus_order[i]);
+    }
+
+    victim target = {&curve, bob};
+    point_cache cache;
+    crt_ctx crt;
+    point_cache_init(&cache);
+    crt_init(&crt, curve.order_n + 1); // room for the product that first passes the order
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t used = invalid_curve_attack(bogus, 3, SMALL_ORDER_BOUND, curve.order, bob_oracle, &target,
+                                       (const unsigned char *)message, strlen(message), &cache, &crt);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    crt_result(&crt, recovered, modulus);
+    bn_mod(recovered, recovered, curve.order_n + 1, curve.order, curve.order_n);
+    printf("%zu small subgroups available, %zu points harvested, %zu residues combined\n", used, cache.count,
+           crt.count);
+    printf("Recovered: %s\n", bn_to_dec(buf, sizeof(buf), recovered, curve.order_n));
+    printf("Bob's key: %s\n", bn_to_dec(buf, sizeof(buf), bob, curve.order_n));
+    printf("%s in %.1f ms\n", bn_cmp(recovered, bob, curve.order_n) == 0 ? "Match" : "Mismatch",
+           (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6);
+
+    crt_free(&crt);
+    point_cache_free(&cache);
+    return 0;
+}
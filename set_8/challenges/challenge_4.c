@@ -238,3 +238,148 @@
 // HINT: You may come to notice that k*u = -k*u, resulting in a
 // combinatorial explosion of potential CRT outputs. Try sending extra
 // queries to narrow the range of possibilities.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../set_8.h"
+
+#define TWIST_BOUND (1 << 24)
+
+static const char *p_str = "233970423115425145524320034830162017933";
+static const char *order_str = "29246302889428143187362802287225875743";
+static const char *curve_order_str = "233970423115425145498902418297807005944";
+static const char *twist_u_str = "76600469441198017145391791613091732004";
+static const char *message = "crazy flamboyant for the rap enjoyment";
+
+typedef struct
+{
+    const mcurve *curve;
+    const limb_t *secret;
+} victim;
+
+// Alice ladders whatever u she is sent, on the curve or the twist.
+static void alice_oracle(unsigned char *tag, const limb_t *u, void *ctx)
+{
+    const victim *alice = ctx;
+    limb_t shared[BN_MAX_LIMBS];
+    ladder(alice->curve, shared, u, alice->secret, alice->curve->order_n);
+    twist_mac(alice->curve, tag, shared, (const unsigned char *)message, strlen(message));
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *stop)
+{
+    return (stop->tv_sec - start->tv_sec) * 1e3 + (stop->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main(void)
+{
+    mcurve curve;
+    ec_curve weier;
+    limb_t u[BN_MAX_LIMBS], x[BN_MAX_LIMBS], k[BN_MAX_LIMBS], alice[BN_MAX_LIMBS], alice_u[BN_MAX_LIMBS];
+    ec_jacobian j;
+    ec_affine a;
+    char buf[256];
+    struct timespec start, stop;
+
+    if (!mcurve_init(&curve, p_str, "534", "4", order_str, curve_order_str) ||
+        !mcurve_to_weierstrass(&curve, &weier))
+    {
+        printf("Bad curve parameters\n");
+        return 1;
+    }
+    size_t n = curve.n, on = curve.order_n;
+
+    ladder(&curve, u, curve.base_u, curve.order, on);
+    printf("ladder(4, n) = %s\n", bn_to_dec(buf, sizeof(buf), u, n));
+
+    int agree = 1;
+    for (int i = 0; i < 16; i++)
+    {
+        bn_random_below(k, curve.order, on);
+        ladder(&curve, u, curve.base_u, k, on);
+        ec_mul(&weier, &j, &weier.base, k, on);
+        ec_to_affine(&weier, &a, &j);
+        ec_affine_get(&weier, x, NULL, &a);
+        mcurve_x_to_u(&curve, x, x);
+        agree &= bn_cmp(u, x, n) == 0;
+    }
+    printf("Montgomery and Weierstrass multiples %s\n", agree ? "agree" : "DISAGREE");
+
+    bn_from_dec(u, BN_MAX_LIMBS, twist_u_str);
+    bn_set_word(k, on, 11);
+    ladder(&curve, x, u, k, on);
+    printf("ladder(%s, 11) = %s, ", twist_u_str, bn_to_dec(buf, sizeof(buf), x, n));
+    printf("u is %s\n", mcurve_on_twist(&curve, u) ? "on the twist" : "on the curve");
+    printf("Twist order: %s\n", bn_to_dec(buf, sizeof(buf), curve.twist_order, on));
+
+    bn_random_below(alice, curve.order, on);
+    ladder(&curve, alice_u, curve.base_u, alice, on);
+    victim target = {&curve, alice};
+    twist_result result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ok = twist_attack(&curve, TWIST_BOUND, alice_oracle, &target, (const unsigned char *)message,
+                          strlen(message), &result);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("%zu twist factors below 2^24, %zu queries, signs %s in %.1f ms\n", result.count, result.queries,
+           ok ? "resolved" : "NOT resolved", elapsed_ms(&start, &stop));
+    if (!ok)
+    {
+        return 1;
+    }
+    printf("k = +-%s", bn_to_dec(buf, sizeof(buf), result.residue, on));
+    printf(" mod %s\n", bn_to_dec(buf, sizeof(buf), result.modulus, on));
+
+    // k = +-c + m N with m < n / N. Alice's public u lifts to +-kG, so
+    // x(m (N G)) matches Y - cG or Y + cG, whichever sign c really has.
+    limb_t bound[BN_MAX_LIMBS], rem[BN_MAX_LIMBS];
+    ec_affine step, targets[2];
+    ec_jacobian cg;
+    bn_divmod(bound, rem, curve.order, on, result.modulus, on);
+    ec_mul(&weier, &j, &weier.base, result.modulus, on);
+    ec_to_affine(&weier, &step, &j);
+    mcurve_u_to_x(&curve, x, alice_u);
+    ec_lift_x(&weier, &a, x);
+    ec_mul(&weier, &cg, &weier.base, result.residue, on);
+    for (int s = 0; s < 2; s++)
+    {
+        ec_from_affine(&weier, &j, &a);
+        ec_add(&weier, &j, &j, &cg);
+        ec_to_affine(&weier, &targets[s], &j);
+        ec_neg(&weier, &cg, &cg);
+    }
+
+    uint64_t m;
+    kangaroo_stats stats;
+    int found = ec_kangaroo(&weier, &m, &step, targets, 2, 0, bound[0], NULL, &stats);
+    printf("Kangaroo over [0, %llu]: %s, %llu additions in %.2f s (%.2f M/s per core)\n",
+           (unsigned long long)bound[0], found ? "collision" : "no collision", (unsigned long long)stats.jumps,
+           stats.seconds, stats.rate / 1e6);
+
+    // Either sign of c. A u-only public key cannot tell k from n - k, so
+    // the recovered key is compared up to that sign too.
+    limb_t recovered[BN_MAX_LIMBS], other[BN_MAX_LIMBS];
+    int match = 0;
+    for (int s = 0; s < 2 && found && !match; s++)
+    {
+        bn_mul_word(recovered, result.modulus, on, m);
+        if (s == 0)
+        {
+            bn_add(recovered, recovered, result.residue, on);
+        }
+        else
+        {
+            bn_sub(recovered, recovered, result.residue, on);
+        }
+        bn_mod(recovered, recovered, on, curve.order, on);
+        ladder(&curve, u, curve.base_u, recovered, on);
+        match = bn_cmp(u, alice_u, n) == 0;
+    }
+    bn_sub(other, curve.order, recovered, on);
+    printf("Recovered:   +-%s\n", match ? bn_to_dec(buf, sizeof(buf), recovered, on) : "nothing");
+    printf("Alice's key: %s\n", bn_to_dec(buf, sizeof(buf), alice, on));
+    printf("%s\n", match && (bn_cmp(recovered, alice, on) == 0 || bn_cmp(other, alice, on) == 0) ? "Match"
+                                                                                                 : "Mismatch");
+    return 0;
+}
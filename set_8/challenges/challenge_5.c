@@ -147,3 +147,430 @@
 // use this same technique for other surprising results. Try generating a
 // random (or chosen) ciphertext and creating a key to decrypt it to a
 // plaintext of your choice!
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../set_8.h"
+
+#define BATCH_SIGNATURES 4096
+#define TORSION_FORGERIES 6
+#define RSA_PRIME_BITS 256
+#define RSA_E 65537
+#define PRIME_ROUNDS 24
+#define DSKS_PRIME_BITS (RSA_PRIME_BITS + 8) // so that p' q' > N
+#define DSKS_FACTOR_BITS 32
+#define DSKS_RHO_FACTOR_BITS 44 // one factor past the BSGS bound, for Pollard rho
+
+static const char *p_str = "233970423115425145524320034830162017933";
+static const char *order_str = "29246302889428143187362802287225875743";
+static const char *group_order_str = "233970423115425145498902418297807005944"; // 8 n
+static const char *message = "Hi Eve, this is Alice. Please don't impersonate me.";
+
+typedef struct
+{
+    ecdsa_sig *sigs;
+    size_t valid;
+    size_t first_invalid;
+} batch_state;
+
+static void collect_signature(size_t index, const ecdsa_sig *sig, void *ctx)
+{
+    batch_state *state = ctx;
+    state->sigs[index] = *sig;
+}
+
+static void count_valid(size_t index, int valid, void *ctx)
+{
+    batch_state *state = ctx;
+    if (valid)
+    {
+        state->valid++;
+    }
+    else if (state->first_invalid == (size_t)-1)
+    {
+        state->first_invalid = index;
+    }
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *stop)
+{
+    return (double)(stop->tv_sec - start->tv_sec) * 1e3 + (double)(stop->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Eve's domain parameters: G' = (u1 + u2 d')^-1 R and Q' = d' G', so that
+// u1 G' + u2 Q' = R for the u1, u2 any verifier derives from (m, r, s).
+static void forge_ecdsa_key(const ecdsa_ctx *alice, const ecdsa_sig *sig, const ec_affine *q, ec_curve *eve_curve,
+                            limb_t *eve_d, ec_affine *eve_q)
+{
+    const ec_curve *curve = alice->curve;
+    const mont_ctx *sc = &alice->scalar;
+    size_t n = alice->n;
+    limb_t w[BN_MAX_LIMBS], h[BN_MAX_LIMBS], u1[BN_MAX_LIMBS], u2[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+    ec_jacobian r, p;
+    ec_affine r_affine;
+
+    mont_to(sc, w, sig->s);
+    mont_inv_vartime(sc, &alice->scalar_inv, w, w);
+    ecdsa_hash(alice, h, (const unsigned char *)message, strlen(message));
+    mont_mul(sc, u1, w, h);
+    mont_mul(sc, u2, w, sig->r);
+    ec_mul_double(curve, &r, &curve->base, u1, q, u2, n);
+    ec_to_affine(curve, &r_affine, &r);
+
+    bn_sub_word(t, curve->order, n, 1);
+    bn_random_below(eve_d, t, n);
+    bn_add_word(eve_d, eve_d, n, 1);
+    mont_to(sc, t, u2);
+    mont_mul(sc, t, t, eve_d);
+    mont_add(sc, t, t, u1);
+    mont_to(sc, t, t);
+    mont_inv_vartime(sc, &alice->scalar_inv, t, t);
+    mont_from(sc, t, t);
+
+    *eve_curve = *curve;
+    ec_mul(curve, &p, &r_affine, t, n);
+    ec_to_affine(curve, &eve_curve->base, &p);
+    ec_mul(curve, &p, &eve_curve->base, eve_d, n);
+    ec_to_affine(curve, eve_q, &p);
+}
+
+// Signatures whose nonce point is R' = k G + T for the point T of order
+// 2, with the hint naming R'. Each is invalid, since u1 G + u2 Q = k G;
+// the forged s makes the combination off by sum z_i T, which vanishes
+// whenever the odd z_i are even in number. single and combined get how
+// many of the count forgeries each check accepts; returns 0 if the curve
+// has no point of order 2.
+static int torsion_forgeries(const ecdsa_ctx *alice, const limb_t *d, const ec_affine *q, const ecdsa_msg *msgs,
+                              size_t count, size_t *single, size_t *combined)
+{
+    const ec_curve *curve = alice->curve;
+    const mont_ctx *sc = &alice->scalar;
+    size_t n = alice->n;
+    limb_t k[BN_MAX_LIMBS], t[BN_MAX_LIMBS], h[BN_MAX_LIMBS], dm[BN_MAX_LIMBS];
+    limb_t x[BN_MAX_LIMBS], y[BN_MAX_LIMBS], quotient[BN_MAX_LIMBS];
+    ec_curve full;
+    ec_affine torsion, point;
+    ec_jacobian p;
+    ecdsa_sig *sigs = malloc(sizeof(ecdsa_sig) * count);
+    int *valid = malloc(sizeof(int) * count);
+
+    if (!ec_curve_with_b(&full, curve, "11279326", group_order_str) || !ec_small_order_point(&full, &torsion, 2))
+    {
+        free(valid);
+        free(sigs);
+        return 0;
+    }
+    mont_to(sc, dm, d);
+    for (size_t i = 0; i < count; i++)
+    {
+        bn_sub_word(t, curve->order, n, 1);
+        bn_random_below(k, t, n);
+        bn_add_word(k, k, n, 1);
+        ecdsa_base_mul(alice, &p, k);
+        ec_add_mixed(curve, &p, &p, &torsion);
+        ec_to_affine(curve, &point, &p);
+        ec_affine_get(curve, x, y, &point);
+        bn_divmod(quotient, sigs[i].r, x, curve->n, curve->order, n);
+        sigs[i].recovery = (int)(quotient[0] << 1 | (y[0] & 1));
+
+        ecdsa_hash(alice, h, msgs[i].data, msgs[i].len);
+        mont_mul(sc, t, dm, sigs[i].r);
+        mont_add(sc, t, t, h);
+        mont_to(sc, k, k);
+        mont_inv_vartime(sc, &alice->scalar_inv, k, k);
+        mont_mul(sc, sigs[i].s, k, t);
+    }
+    *single = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        *single += (size_t)ecdsa_verify(alice, &sigs[i], q, msgs[i].data, msgs[i].len);
+    }
+    *combined = ecdsa_verify_batch_random(alice, q, msgs, sigs, count, valid);
+    free(valid);
+    free(sigs);
+    return 1;
+}
+
+// A prime of exactly `bits` bits.
+static void random_prime(limb_t *p, size_t bits)
+{
+    size_t n = BN_LIMBS(bits);
+    limb_t top[BN_MAX_LIMBS];
+    bn_zero(top, n);
+    top[(bits - 1) / BN_LIMB_BITS] = (limb_t)1 << ((bits - 1) % BN_LIMB_BITS);
+    do
+    {
+        bn_random_below(p, top, n);
+        bn_add(p, p, top, n);
+        p[0] |= 1;
+    } while (!bn_is_probable_prime(p, n, PRIME_ROUNDS));
+}
+
+// d = e^-1 mod phi for odd e: with u = phi^-1 mod e, phi (e - u) + 1 is a
+// multiple of e, and its quotient by e is d.
+static int rsa_private_exponent(limb_t *d, const limb_t *e, const limb_t *phi, size_t n)
+{
+    limb_t u[BN_MAX_LIMBS], t[BN_MAX_LIMBS], product[BN_MAX_LIMBS], q[BN_MAX_LIMBS];
+    if (!bn_inv_mod_vartime(u, phi, e, n))
+    {
+        return 0;
+    }
+    bn_sub(t, e, u, n);
+    bn_mul(product, phi, t, n);
+    bn_add_word(product, product, 2 * n, 1);
+    bn_divmod(q, NULL, product, 2 * n, e, n);
+    bn_copy(d, q, n);
+    return 1;
+}
+
+// 00 01 ff .. ff 00 SHA-256(m), as wide as Alice's modulus.
+static void rsa_pad(limb_t *pm, size_t n, size_t bytes)
+{
+    unsigned char em[BN_MAX_LIMBS * sizeof(limb_t)];
+    memset(em, 0xff, bytes);
+    em[0] = 0x00;
+    em[1] = 0x01;
+    em[bytes - SHA256_DIGEST_SIZE - 1] = 0x00;
+    sha256(em + bytes - SHA256_DIGEST_SIZE, (const unsigned char *)message, strlen(message));
+    bn_from_bytes(pm, n, em, bytes);
+}
+
+static int is_primitive_root(const mont_ctx *ctx, const limb_t *g, const limb_t *pm1, const factor_list *odd)
+{
+    size_t n = ctx->n;
+    limb_t e[BN_MAX_LIMBS], r[BN_MAX_LIMBS];
+    for (size_t i = 0; i <= odd->count; i++)
+    {
+        limb_t q = i < odd->count ? odd->factors[i].value[0] : 2;
+        bn_div_word(e, pm1, n, q);
+        mod_exp(ctx, r, g, e, n);
+        if (bn_cmp_word(r, n, 1) == 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// p = 2 q_1 .. q_k + 1 for distinct odd primes q_i, none of them in
+// avoid, one of DSKS_RHO_FACTOR_BITS bits and the rest of
+// DSKS_FACTOR_BITS, with s and pm both primitive roots mod p. odd gets
+// the q_i; s and pm are taken mod p.
+static void smooth_prime(limb_t *p, factor_list *odd, size_t n, const limb_t *s, const limb_t *pm, size_t sn,
+                         const factor_list *avoid)
+{
+    limb_t pm1[BN_MAX_LIMBS], sp[BN_MAX_LIMBS], pmp[BN_MAX_LIMBS], q[BN_MAX_LIMBS];
+    mont_ctx ctx;
+
+    odd->n = n;
+    bn_set_word(odd->cofactor, n, 1);
+    for (;;)
+    {
+        odd->count = 0;
+        bn_set_word(pm1, n, 2);
+        while (bn_bits(pm1, n) < DSKS_PRIME_BITS)
+        {
+            int fresh;
+            do
+            {
+                random_prime(q, odd->count == 0 ? DSKS_RHO_FACTOR_BITS : DSKS_FACTOR_BITS);
+                fresh = 1;
+                for (size_t i = 0; i < odd->count; i++)
+                {
+                    fresh &= odd->factors[i].value[0] != q[0];
+                }
+                for (size_t i = 0; avoid != NULL && i < avoid->count; i++)
+                {
+                    fresh &= avoid->factors[i].value[0] != q[0];
+                }
+            } while (!fresh);
+            prime_factor *f = &odd->factors[odd->count++];
+            bn_set_word(f->value, n, q[0]);
+            f->multiplicity = 1;
+            bn_mul_word(pm1, pm1, n, q[0]);
+        }
+        bn_add_word(p, pm1, n, 1);
+        if (!bn_is_probable_prime(p, n, PRIME_ROUNDS))
+        {
+            continue;
+        }
+        mont_init(&ctx, p, n);
+        bn_mod(sp, s, sn, p, n);
+        bn_mod(pmp, pm, sn, p, n);
+        if (is_primitive_root(&ctx, sp, pm1, odd) && is_primitive_root(&ctx, pmp, pm1, odd))
+        {
+            return;
+        }
+    }
+}
+
+// log_s pm in (Z/pZ)^*, folded into crt mod the prime powers of odd, or
+// of all of p - 1 when odd is NULL.
+static int dsks_log(crt_ctx *crt, const limb_t *p, size_t n, const limb_t *s, const limb_t *pm, size_t sn,
+                    const factor_list *odd)
+{
+    mont_ctx ctx;
+    limb_t g[BN_MAX_LIMBS], h[BN_MAX_LIMBS], pm1[BN_MAX_LIMBS];
+
+    mont_init(&ctx, p, n);
+    bn_mod(g, s, sn, p, n);
+    bn_mod(h, pm, sn, p, n);
+    mont_to(&ctx, g, g);
+    mont_to(&ctx, h, h);
+    bn_sub_word(pm1, p, n, 1);
+    return dlog_pohlig_hellman(&ctx, crt, g, h, pm1, odd, NULL);
+}
+
+// Alice's RSA signature, and a key (e', N') of Eve's under which it
+// verifies: N' = p' q' with smooth p' - 1 and q' - 1 that share only the
+// factor 2, and e' = log_s pad(m) mod lcm(p' - 1, q' - 1).
+static void forge_rsa_key(void)
+{
+    size_t half = BN_LIMBS(RSA_PRIME_BITS), n = 2 * half;
+    size_t pn = BN_LIMBS(DSKS_PRIME_BITS + DSKS_FACTOR_BITS), wide = 2 * pn;
+    limb_t p[BN_MAX_LIMBS] = {0}, q[BN_MAX_LIMBS] = {0}, big_n[BN_MAX_LIMBS], phi[BN_MAX_LIMBS];
+    limb_t e[BN_MAX_LIMBS] = {0}, d[BN_MAX_LIMBS], pm[BN_MAX_LIMBS] = {0}, s[BN_MAX_LIMBS] = {0};
+    limb_t check[BN_MAX_LIMBS], pm1[BN_MAX_LIMBS], qm1[BN_MAX_LIMBS];
+    struct timespec start, stop;
+    factor_list p_odd, q_odd;
+    mont_ctx ctx;
+    crt_ctx crt;
+    char buf[256];
+
+    random_prime(p, RSA_PRIME_BITS);
+    random_prime(q, RSA_PRIME_BITS);
+    bn_mul(big_n, p, q, half);
+    bn_sub_word(pm1, p, half, 1);
+    bn_sub_word(qm1, q, half, 1);
+    bn_mul(phi, pm1, qm1, half);
+    bn_set_word(e, n, RSA_E);
+    rsa_private_exponent(d, e, phi, n);
+    mont_init(&ctx, big_n, n);
+    rsa_pad(pm, n, n * sizeof(limb_t));
+    mod_exp(&ctx, s, pm, d, n);
+    mod_exp(&ctx, check, s, e, n);
+    printf("Alice's RSA signature %s under her key\n", bn_cmp(check, pm, n) == 0 ? "verifies" : "FAILS");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bn_zero(p, BN_MAX_LIMBS);
+    bn_zero(q, BN_MAX_LIMBS);
+    smooth_prime(p, &p_odd, pn, s, pm, n, NULL);
+    smooth_prime(q, &q_odd, pn, s, pm, n, &p_odd);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("Eve's p' and q' (%zu and %zu bits) in %.1f ms\n", bn_bits(p, pn), bn_bits(q, pn),
+           elapsed_ms(&start, &stop));
+
+    // p' - 1 is factored by the solver itself; q' - 1 is handed over
+    // without the 2 that crt already holds from p'.
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    crt_init(&crt, wide);
+    int ok = dsks_log(&crt, p, pn, s, pm, n, NULL) && dsks_log(&crt, q, pn, s, pm, n, &q_odd);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    crt_result(&crt, e, NULL);
+    crt_free(&crt);
+    if (!ok)
+    {
+        printf("Pohlig-Hellman failed\n");
+        return;
+    }
+    printf("e' = %s (%zu bits) in %.1f ms\n", bn_to_dec(buf, sizeof(buf), e, wide), bn_bits(e, wide),
+           elapsed_ms(&start, &stop));
+
+    bn_mul(big_n, p, q, pn);
+    bn_sub_word(pm1, p, pn, 1);
+    bn_sub_word(qm1, q, pn, 1);
+    bn_mul(phi, pm1, qm1, pn);
+    mont_init(&ctx, big_n, wide);
+    mod_exp(&ctx, check, s, e, wide);
+    printf("Alice's RSA signature %s under Eve's key\n", bn_cmp(check, pm, wide) == 0 ? "verifies" : "FAILS");
+    if (rsa_private_exponent(d, e, phi, wide))
+    {
+        mod_exp(&ctx, check, pm, d, wide);
+        printf("Eve's d' %s the signature\n", bn_cmp(check, s, wide) == 0 ? "reproduces" : "does NOT reproduce");
+    }
+}
+
+int main(void)
+{
+    ec_curve curve, eve_curve;
+    ecdsa_ctx alice, eve;
+    limb_t alice_d[BN_MAX_LIMBS], eve_d[BN_MAX_LIMBS];
+    ec_affine alice_q, eve_q;
+    ecdsa_sig sig;
+    struct timespec start, stop;
+    const unsigned char *msg = (const unsigned char *)message;
+    size_t len = strlen(message);
+
+    if (!ec_curve_init(&curve, p_str, "-95051", "11279326", "182", "85518893674295321206118380980485522083",
+                       order_str))
+    {
+        printf("Bad curve parameters\n");
+        return 1;
+    }
+    ecdsa_init(&alice, &curve);
+    ecdsa_keypair(&alice, alice_d, &alice_q);
+    ecdsa_sign(&alice, &sig, alice_d, msg, len);
+    printf("Alice's signature %s under her key\n", ecdsa_verify(&alice, &sig, &alice_q, msg, len) ? "verifies" : "FAILS");
+
+    forge_ecdsa_key(&alice, &sig, &alice_q, &eve_curve, eve_d, &eve_q);
+    ecdsa_init(&eve, &eve_curve);
+    printf("Alice's signature %s under Eve's key\n", ecdsa_verify(&eve, &sig, &eve_q, msg, len) ? "verifies" : "FAILS");
+
+    // A batch the size of challenge 62's, signed and checked in chunks.
+    ecdsa_msg *msgs = malloc(sizeof(ecdsa_msg) * BATCH_SIGNATURES);
+    char(*texts)[32] = malloc(32 * BATCH_SIGNATURES);
+    batch_state state = {malloc(sizeof(ecdsa_sig) * BATCH_SIGNATURES), 0, (size_t)-1};
+    for (size_t i = 0; i < BATCH_SIGNATURES; i++)
+    {
+        msgs[i].len = (size_t)snprintf(texts[i], sizeof(texts[i]), "message %zu", i);
+        msgs[i].data = (const unsigned char *)texts[i];
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ecdsa_sign_batch(&alice, alice_d, msgs, BATCH_SIGNATURES, collect_signature, &state);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("Signed %d messages in %.1f ms\n", BATCH_SIGNATURES, elapsed_ms(&start, &stop));
+
+    state.sigs[BATCH_SIGNATURES / 3].s[0] ^= 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ecdsa_verify_batch(&alice, &alice_q, msgs, state.sigs, BATCH_SIGNATURES, count_valid, &state);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("Verified %d signatures in %.1f ms: %zu valid, first bad at %zu\n", BATCH_SIGNATURES,
+           elapsed_ms(&start, &stop), state.valid, state.first_invalid);
+
+    int *valid = malloc(sizeof(int) * BATCH_SIGNATURES);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t accepted = ecdsa_verify_batch_random(&alice, &alice_q, msgs, state.sigs, BATCH_SIGNATURES, valid);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    size_t first_invalid = 0;
+    while (first_invalid < BATCH_SIGNATURES && valid[first_invalid])
+    {
+        first_invalid++;
+    }
+    printf("Combined check of %d signatures in %.1f ms: %zu valid, first bad at %zu\n", BATCH_SIGNATURES,
+           elapsed_ms(&start, &stop), accepted, first_invalid);
+
+    free(valid);
+
+    size_t single, combined;
+    if (torsion_forgeries(&alice, alice_d, &alice_q, msgs, TORSION_FORGERIES, &single, &combined))
+    {
+        printf("Torsion-shifted forgeries accepted: %zu of %d individually, %zu of %d combined\n", single,
+               TORSION_FORGERIES, combined, TORSION_FORGERIES);
+    }
+    else
+    {
+        printf("No point of order 2 for the torsion-shifted forgeries\n");
+    }
+
+    forge_rsa_key();
+
+    free(state.sigs);
+    free(texts);
+    free(msgs);
+    ecdsa_free(&eve);
+    ecdsa_free(&alice);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+#include "crt.h"
+
+// Returns 0 when a is not invertible mod m.
+limb_t inverse_mod_word(limb_t a, limb_t m)
+{
+    __int128 t = 0, new_t = 1;
+    __int128 r = m, new_r = a % m;
+    while (new_r != 0)
+    {
+        __int128 quotient = r / new_r, tmp;
+        tmp = t - quotient * new_t;
+        t = new_t;
+        new_t = tmp;
+        tmp = r - quotient * new_r;
+        r = new_r;
+        new_r = tmp;
+    }
+    if (r != 1)
+    {
+        return 0;
+    }
+    return (limb_t)(t < 0 ? t + m : t);
+}
+
+static limb_t mul_mod_word(limb_t a, limb_t b, limb_t m)
+{
+    return (limb_t)((unsigned __int128)a * b % m);
+}
+
+// r = a + b mod m for a, b < m; the carry out of n limbs is folded in.
+static void add_mod(limb_t *r, const limb_t *a, const limb_t *b, const limb_t *m, size_t n)
+{
+    limb_t carry = bn_add(r, a, b, n);
+    if (carry || bn_cmp(r, m, n) >= 0)
+    {
+        bn_sub(r, r, m, n);
+    }
+}
+
+void crt_init(crt_ctx *crt, size_t n)
+{
+    crt->n = n;
+    crt->count = 0;
+    crt->pairs = 0;
+    bn_zero(crt->value, BN_MAX_LIMBS);
+    bn_set_word(crt->modulus, BN_MAX_LIMBS, 1);
+    pthread_mutex_init(&crt->lock, NULL);
+}
+
+void crt_free(crt_ctx *crt)
+{
+    pthread_mutex_destroy(&crt->lock);
+}
+
+// Garner step: x' = x + M * ((b - x) M^-1 mod r), M' = M r. Safe to call
+// from concurrent residue workers. Returns 0 if r shares a factor with the
+// moduli already present or the product no longer fits in n limbs.
+static int crt_insert(crt_ctx *crt, limb_t residue, limb_t modulus, int signed_pair)
+{
+    size_t n = crt->n;
+    limb_t step[BN_MAX_LIMBS], grown[BN_MAX_LIMBS];
+    int ok = 0;
+
+    pthread_mutex_lock(&crt->lock);
+    if (crt->count < CRT_MAX_MODULI && modulus > 1 && bn_mul_word(grown, crt->modulus, n, modulus) == 0)
+    {
+        limb_t inverse = inverse_mod_word(bn_mod_word(crt->modulus, n, modulus), modulus);
+        if (inverse != 0)
+        {
+            crt_term *term = &crt->terms[crt->count++];
+            term->modulus = modulus;
+            term->residue = residue % modulus;
+            term->inverse = inverse;
+            term->signed_pair = signed_pair;
+            crt->pairs += signed_pair != 0;
+
+            limb_t x = bn_mod_word(crt->value, n, modulus);
+            limb_t t = mul_mod_word((term->residue + modulus - x) % modulus, inverse, modulus);
+            bn_mul_word(step, crt->modulus, n, t);
+            bn_add(crt->value, crt->value, step, n);
+            bn_copy(crt->modulus, grown, n);
+            ok = 1;
+        }
+    }
+    pthread_mutex_unlock(&crt->lock);
+    return ok;
+}
+
+int crt_add(crt_ctx *crt, limb_t residue, limb_t modulus)
+{
+    return crt_insert(crt, residue, modulus, 0);
+}
+
+int crt_add_pair(crt_ctx *crt, limb_t residue, limb_t modulus)
+{
+    return crt_insert(crt, residue, modulus, 1);
+}
+
+void crt_result(crt_ctx *crt, limb_t *value, limb_t *modulus)
+{
+    pthread_mutex_lock(&crt->lock);
+    if (value != NULL)
+    {
+        bn_copy(value, crt->value, crt->n);
+    }
+    if (modulus != NULL)
+    {
+        bn_copy(modulus, crt->modulus, crt->n);
+    }
+    pthread_mutex_unlock(&crt->lock);
+}
+
+int crt_exceeds(crt_ctx *crt, const limb_t *bound)
+{
+    pthread_mutex_lock(&crt->lock);
+    int exceeds = bn_cmp(crt->modulus, bound, crt->n) > 0;
+    pthread_mutex_unlock(&crt->lock);
+    return exceeds;
+}
+
+// Flipping pair i from +b to -b moves x by -2 b e_i, where e_i is the CRT
+// basis element (1 mod r_i, 0 mod the others): e_i = (M / r_i) times its
+// inverse mod r_i. Taking a snapshot keeps the walk consistent while
+// workers go on adding residues.
+void crt_signs_begin(crt_sign_iter *it, crt_ctx *crt)
+{
+    size_t n = crt->n;
+    limb_t cofactor[BN_MAX_LIMBS], basis[BN_MAX_LIMBS], wide[BN_MAX_LIMBS + 1];
+
+    pthread_mutex_lock(&crt->lock);
+    it->n = n;
+    it->pairs = 0;
+    it->step = 0;
+    it->signs = 0;
+    bn_copy(it->modulus, crt->modulus, n);
+    bn_copy(it->value, crt->value, n);
+    for (size_t i = 0; i < crt->count && it->pairs < CRT_MAX_SIGN_PAIRS; i++)
+    {
+        const crt_term *term = &crt->terms[i];
+        if (!term->signed_pair)
+        {
+            continue;
+        }
+        limb_t r = term->modulus;
+        bn_div_word(cofactor, crt->modulus, n, r);
+        limb_t scale = inverse_mod_word(bn_mod_word(cofactor, n, r), r);
+        scale = mul_mod_word(scale, mul_mod_word(2, term->residue, r), r);
+        bn_zero(wide, n + 1);
+        wide[n] = bn_mul_word(basis, cofactor, n, scale);
+        bn_copy(wide, basis, n);
+        bn_mod(it->delta[it->pairs++], wide, n + 1, crt->modulus, n);
+    }
+    pthread_mutex_unlock(&crt->lock);
+}
+
+// Returns 0 once all 2^pairs combinations have been produced.
+int crt_signs_next(crt_sign_iter *it, limb_t *value)
+{
+    size_t n = it->n;
+    if (it->step >> it->pairs)
+    {
+        return 0;
+    }
+    if (it->step != 0)
+    {
+        // Gray code: step k flips the bit at the position of k's lowest set bit.
+        size_t i = (size_t)__builtin_ctzll(it->step);
+        limb_t neg[BN_MAX_LIMBS];
+        it->signs ^= (uint64_t)1 << i;
+        if (it->signs >> i & 1)
+        {
+            bn_sub(neg, it->modulus, it->delta[i], n);
+            if (bn_cmp(neg, it->modulus, n) == 0)
+            {
+                bn_zero(neg, n);
+            }
+            add_mod(it->value, it->value, neg, it->modulus, n);
+        }
+        else
+        {
+            add_mod(it->value, it->value, it->delta[i], it->modulus, n);
+        }
+    }
+    it->step++;
+    bn_copy(value, it->value, n);
+    return 1;
+}
@@ -0,0 +1,66 @@
+#ifndef CRT_ /* Include guard */
+#define CRT_
+
+#include <pthread.h>
+#include <stdint.h>
+#include "bignum.h"
+
+// Incremental Chinese remaindering over word-sized, pairwise coprime
+// moduli. Residues are folded in with Garner's mixed-radix step as they
+// arrive; a residue known only up to sign (x = +-b mod r) is folded in
+// with its + sign and enumerated later by crt_signs_next.
+
+#define CRT_MAX_MODULI 64
+#define CRT_MAX_SIGN_PAIRS 63
+
+typedef struct
+{
+    limb_t modulus;
+    limb_t residue;
+    limb_t inverse; // (product of earlier moduli)^-1 mod modulus
+    int signed_pair;
+} crt_term;
+
+typedef struct
+{
+    size_t n;
+    size_t count;
+    size_t pairs;
+    crt_term terms[CRT_MAX_MODULI];
+    limb_t value[BN_MAX_LIMBS];
+    limb_t modulus[BN_MAX_LIMBS];
+    pthread_mutex_t lock;
+} crt_ctx;
+
+// Walks all 2^pairs sign choices in Gray-code order, so each step flips
+// one sign and costs a single modular addition.
+typedef struct
+{
+    size_t n;
+    size_t pairs;
+    uint64_t step;
+    uint64_t signs; // bit i set: pair i taken as -b
+    limb_t modulus[BN_MAX_LIMBS];
+    limb_t value[BN_MAX_LIMBS];
+    limb_t delta[CRT_MAX_SIGN_PAIRS][BN_MAX_LIMBS]; // 2 b_i e_i mod M
+} crt_sign_iter;
+
+void crt_init(crt_ctx *crt, size_t n);
+
+void crt_free(crt_ctx *crt);
+
+int crt_add(crt_ctx *crt, limb_t residue, limb_t modulus);
+
+int crt_add_pair(crt_ctx *crt, limb_t residue, limb_t modulus);
+
+void crt_result(crt_ctx *crt, limb_t *value, limb_t *modulus);
+
+int crt_exceeds(crt_ctx *crt, const limb_t *bound);
+
+limb_t inverse_mod_word(limb_t a, limb_t m);
+
+void crt_signs_begin(crt_sign_iter *it, crt_ctx *crt);
+
+int crt_signs_next(crt_sign_iter *it, limb_t *value);
+
+#endif // CRT_
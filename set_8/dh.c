@@ -0,0 +1,45 @@
+#include "dh.h"
+#include "modexp.h"
+
+int dh_group_init(dh_group *grp, const char *p, const char *g, const char *q)
+{
+    limb_t gp[BN_MAX_LIMBS];
+    if (!bn_from_dec(grp->p, BN_MAX_LIMBS, p) || !bn_from_dec(gp, BN_MAX_LIMBS, g) ||
+        !bn_from_dec(grp->q, BN_MAX_LIMBS, q))
+    {
+        return 0;
+    }
+
+    size_t bits = bn_bits(grp->p, BN_MAX_LIMBS);
+    grp->n = BN_LIMBS(bits);
+    grp->bytes = (bits + 7) / 8;
+    mont_init(&grp->ctx, grp->p, grp->n);
+    mont_to(&grp->ctx, grp->g, gp);
+    return 1;
+}
+
+// secret is uniform in [1, q); pub = g^secret through the cached comb.
+void dh_keypair(const dh_group *grp, limb_t *secret, limb_t *pub)
+{
+    size_t n = grp->n;
+    limb_t qm1[BN_MAX_LIMBS];
+    bn_sub_word(qm1, grp->q, n, 1);
+    bn_random_below(secret, qm1, n);
+    bn_add_word(secret, secret, n, 1);
+
+    const fixed_base *fb = fixed_base_cached(&grp->ctx, grp->g, bn_bits(grp->q, n));
+    fixed_base_exp(fb, pub, secret, n);
+    mont_from(&grp->ctx, pub, pub);
+}
+
+void dh_shared(const dh_group *grp, limb_t *shared, const limb_t *peer, const limb_t *secret)
+{
+    mod_exp(&grp->ctx, shared, peer, secret, grp->n);
+}
+
+void dh_mac(const dh_group *grp, unsigned char *tag, const limb_t *shared, const unsigned char *msg, size_t len)
+{
+    unsigned char key[BN_MAX_LIMBS * sizeof(limb_t)];
+    bn_to_bytes(key, grp->bytes, shared, grp->n);
+    hmac_sha256(tag, key, grp->bytes, msg, len);
+}
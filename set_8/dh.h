@@ -0,0 +1,29 @@
+#ifndef DH_ /* Include guard */
+#define DH_
+
+#include "bignum.h"
+#include "sha256.h"
+
+// Finite-field Diffie-Hellman over a prime-order subgroup of (Z/pZ)^*.
+// Public values and shared secrets are plain integers mod p; the MAC key
+// is the shared secret as a big-endian string of `bytes` bytes.
+
+typedef struct
+{
+    size_t n;
+    size_t bytes;
+    mont_ctx ctx;
+    limb_t p[BN_MAX_LIMBS];
+    limb_t g[BN_MAX_LIMBS]; // Montgomery form
+    limb_t q[BN_MAX_LIMBS];
+} dh_group;
+
+int dh_group_init(dh_group *grp, const char *p, const char *g, const char *q);
+
+void dh_keypair(const dh_group *grp, limb_t *secret, limb_t *pub);
+
+void dh_shared(const dh_group *grp, limb_t *shared, const limb_t *peer, const limb_t *secret);
+
+void dh_mac(const dh_group *grp, unsigned char *tag, const limb_t *shared, const unsigned char *msg, size_t len);
+
+#endif // DH_
@@ -0,0 +1,329 @@
+#include <math.h>
+#include <stdlib.h>
+#include "dlog.h"
+#include "modexp.h"
+
+#define DLOG_HASH_MUL 0x9e3779b97f4a7c15ull
+
+typedef struct
+{
+    uint32_t fingerprint;
+    uint32_t index; // baby step + 1, 0 for an empty slot
+} bsgs_entry;
+
+typedef struct
+{
+    const mont_ctx *ctx;
+    crt_ctx *crt;
+    const limb_t *g;
+    const limb_t *h;
+    const limb_t *order;
+    const factor_list *factors;
+    const dlog_params *params;
+    int *solved;
+} ph_job;
+
+void dlog_params_default(dlog_params *params)
+{
+    params->bsgs_bound = (uint64_t)1 << 40;
+    params->bsgs_max_entries = (size_t)1 << 20;
+    params->rho_iterations = 0;
+}
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t add_mod(uint64_t a, uint64_t b, uint64_t m)
+{
+    return a >= m - b ? a - (m - b) : a + b;
+}
+
+static uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t m)
+{
+    return (uint64_t)((unsigned __int128)a * b % m);
+}
+
+static void exp_word(const mont_ctx *ctx, limb_t *r, const limb_t *base, uint64_t e)
+{
+    limb_t el = e;
+    mont_exp(ctx, r, base, &el, 1);
+}
+
+// Montgomery values are close to uniform, so their low limb hashes well.
+static uint64_t element_key(const limb_t *a)
+{
+    return a[0] * DLOG_HASH_MUL;
+}
+
+static int same_element(const mont_ctx *ctx, const limb_t *a, const limb_t *b)
+{
+    return bn_cmp(a, b, ctx->n) == 0;
+}
+
+// x < order with g^x = h, for g of the given order; the table lives only
+// for the call.
+int dlog_bsgs(const mont_ctx *ctx, uint64_t *x, const limb_t *g, const limb_t *h, uint64_t order,
+              size_t max_entries)
+{
+    limb_t e[BN_MAX_LIMBS], step[BN_MAX_LIMBS], check[BN_MAX_LIMBS];
+    uint64_t m = (uint64_t)sqrt((double)order);
+    while (m * m < order)
+    {
+        m++;
+    }
+    m = m < max_entries ? m : max_entries;
+    m = m < UINT32_MAX ? m : UINT32_MAX - 1;
+    unsigned bits = 1;
+    while (((size_t)1 << bits) < 2 * m)
+    {
+        bits++;
+    }
+    size_t mask = ((size_t)1 << bits) - 1;
+    bsgs_entry *table = calloc(mask + 1, sizeof(bsgs_entry));
+
+    bn_copy(e, ctx->one, ctx->n);
+    for (uint64_t j = 0; j < m; j++)
+    {
+        uint64_t key = element_key(e);
+        size_t slot = (size_t)(key >> (64 - bits));
+        while (table[slot].index != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        table[slot].fingerprint = (uint32_t)key;
+        table[slot].index = (uint32_t)(j + 1);
+        mont_mul(ctx, e, e, g);
+    }
+
+    // Giant steps multiply by g^-m = g^(order - m).
+    exp_word(ctx, step, g, order - m % order);
+    bn_copy(e, h, ctx->n);
+    int found = 0;
+    for (uint64_t i = 0; i * m < order && !found; i++)
+    {
+        uint64_t key = element_key(e);
+        for (size_t slot = (size_t)(key >> (64 - bits)); table[slot].index != 0; slot = (slot + 1) & mask)
+        {
+            if (table[slot].fingerprint != (uint32_t)key)
+            {
+                continue;
+            }
+            uint64_t candidate = (i * m + table[slot].index - 1) % order;
+            exp_word(ctx, check, g, candidate);
+            if (same_element(ctx, check, h))
+            {
+                *x = candidate;
+                found = 1;
+                break;
+            }
+        }
+        mont_mul(ctx, e, e, step);
+    }
+    free(table);
+    return found;
+}
+
+// x with g^x = h for g of prime order. The walk keeps x = g^a h^b; when
+// Brent's saved point comes round again, g^a h^b = g^a' h^b' gives
+// x = (a - a') / (b' - b). A degenerate collision (b = b') restarts the
+// walk with fresh multipliers. iterations = 0 allows
+// DLOG_RHO_WORK_LIMIT times the expected sqrt(pi q / 2) steps, so an h
+// outside the subgroup is given up on rather than walked forever.
+int dlog_rho(const mont_ctx *ctx, uint64_t *x, const limb_t *g, const limb_t *h, uint64_t order,
+             uint64_t iterations, uint64_t seed)
+{
+    size_t n = ctx->n;
+    limb_t mult[DLOG_RHO_PARTITIONS][BN_MAX_LIMBS], alpha_g[BN_MAX_LIMBS], beta_h[BN_MAX_LIMBS];
+    limb_t w[BN_MAX_LIMBS], saved[BN_MAX_LIMBS], check[BN_MAX_LIMBS];
+    uint64_t alpha[DLOG_RHO_PARTITIONS], beta[DLOG_RHO_PARTITIONS];
+    uint64_t rng = seed, done = 0;
+
+    if (order < 2)
+    {
+        *x = 0;
+        return 1;
+    }
+    if (iterations == 0)
+    {
+        iterations = (uint64_t)(DLOG_RHO_WORK_LIMIT * sqrt(M_PI * (double)order / 2));
+    }
+    for (;;)
+    {
+        for (size_t k = 0; k < DLOG_RHO_PARTITIONS; k++)
+        {
+            alpha[k] = splitmix64(&rng) % order;
+            beta[k] = splitmix64(&rng) % order;
+            exp_word(ctx, alpha_g, g, alpha[k]);
+            exp_word(ctx, beta_h, h, beta[k]);
+            mont_mul(ctx, mult[k], alpha_g, beta_h);
+        }
+        uint64_t a = splitmix64(&rng) % order, b = splitmix64(&rng) % order;
+        exp_word(ctx, alpha_g, g, a);
+        exp_word(ctx, beta_h, h, b);
+        mont_mul(ctx, w, alpha_g, beta_h);
+
+        uint64_t saved_a = a, saved_b = b, power = 1, length = 0;
+        bn_copy(saved, w, n);
+        for (;;)
+        {
+            if (done++ >= iterations)
+            {
+                return 0;
+            }
+            size_t k = (size_t)(element_key(w) >> 32) % DLOG_RHO_PARTITIONS;
+            mont_mul(ctx, w, w, mult[k]);
+            a = add_mod(a, alpha[k], order);
+            b = add_mod(b, beta[k], order);
+            length++;
+            if (same_element(ctx, w, saved))
+            {
+                break;
+            }
+            if (length == power)
+            {
+                bn_copy(saved, w, n);
+                saved_a = a;
+                saved_b = b;
+                power *= 2;
+                length = 0;
+            }
+        }
+        if (b != saved_b)
+        {
+            uint64_t inv = inverse_mod_word(add_mod(saved_b, order - b, order), order);
+            uint64_t candidate = mul_mod(add_mod(a, order - saved_a, order), inv, order);
+            exp_word(ctx, check, g, candidate);
+            if (same_element(ctx, check, h))
+            {
+                *x = candidate;
+                return 1;
+            }
+        }
+    }
+}
+
+static int solve_prime(const mont_ctx *ctx, uint64_t *x, const limb_t *g, const limb_t *h, uint64_t q,
+                       const dlog_params *params, uint64_t seed)
+{
+    if (q <= params->bsgs_bound)
+    {
+        return dlog_bsgs(ctx, x, g, h, q, params->bsgs_max_entries);
+    }
+    return dlog_rho(ctx, x, g, h, q, params->rho_iterations, seed);
+}
+
+// x mod q^e from gc = g^(N / q^e), hc = h^(N / q^e). With gamma =
+// gc^(q^(e-1)) of order q, digit k is the log of
+// (hc gc^-x)^(q^(e-1-k)) to base gamma. Fails when gamma = 1, i.e. when g
+// does not reach the full q-part of the group.
+static int solve_prime_power(const ph_job *job, size_t index, uint64_t *x)
+{
+    const mont_ctx *ctx = job->ctx;
+    const prime_factor *f = &job->factors->factors[index];
+    size_t n = ctx->n;
+    uint64_t q = f->value[0], qe = 1;
+    limb_t cofactor[BN_MAX_LIMBS], gc[BN_MAX_LIMBS], hc[BN_MAX_LIMBS], gamma[BN_MAX_LIMBS];
+    limb_t t[BN_MAX_LIMBS], y[BN_MAX_LIMBS];
+
+    for (unsigned k = 0; k < f->multiplicity; k++)
+    {
+        qe *= q;
+    }
+    bn_copy(cofactor, job->order, n);
+    bn_div_word(cofactor, cofactor, n, qe);
+    mont_exp(ctx, gc, job->g, cofactor, n);
+    mont_exp(ctx, hc, job->h, cofactor, n);
+    exp_word(ctx, gamma, gc, qe / q);
+    if (same_element(ctx, gamma, ctx->one))
+    {
+        return 0;
+    }
+
+    uint64_t digit, place = 1, shift = qe / q;
+    *x = 0;
+    for (unsigned k = 0; k < f->multiplicity; k++)
+    {
+        exp_word(ctx, t, gc, (qe - *x) % qe);
+        mont_mul(ctx, t, t, hc);
+        exp_word(ctx, y, t, shift);
+        if (!solve_prime(ctx, &digit, gamma, y, q, job->params, q ^ index))
+        {
+            return 0;
+        }
+        *x += digit * place;
+        place *= q;
+        shift /= q;
+    }
+    return 1;
+}
+
+static void prime_power_range(size_t begin, size_t end, void *arg)
+{
+    ph_job *job = arg;
+    for (size_t i = begin; i < end; i++)
+    {
+        const prime_factor *f = &job->factors->factors[i];
+        uint64_t x, qe = 1;
+        for (unsigned k = 0; k < f->multiplicity; k++)
+        {
+            qe *= f->value[0];
+        }
+        job->solved[i] = solve_prime_power(job, i, &x) && crt_add(job->crt, x, qe);
+    }
+}
+
+// Folds x mod q^e into crt for every prime power of factors, which
+// defaults to the full factorization of order; the factors may also be
+// a subset, e.g. to leave out a modulus crt already holds. Returns 1 when
+// every listed component was solved, 0 if one failed or the order could
+// not be factored into prime powers that fit in a limb.
+int dlog_pohlig_hellman(const mont_ctx *ctx, crt_ctx *crt, const limb_t *g, const limb_t *h, const limb_t *order,
+                        const factor_list *factors, const dlog_params *params)
+{
+    size_t n = ctx->n;
+    dlog_params defaults;
+    factor_list own;
+
+    if (params == NULL)
+    {
+        dlog_params_default(&defaults);
+        params = &defaults;
+    }
+    if (factors == NULL)
+    {
+        factor(&own, order, n, NULL);
+        if (bn_cmp_word(own.cofactor, n, 1) != 0)
+        {
+            return 0;
+        }
+        factors = &own;
+    }
+    for (size_t i = 0; i < factors->count; i++)
+    {
+        const prime_factor *f = &factors->factors[i];
+        unsigned __int128 qe = 1;
+        for (unsigned k = 0; k < f->multiplicity && qe <= UINT64_MAX; k++)
+        {
+            qe *= f->value[0];
+        }
+        if (bn_cmp_word(f->value, factors->n, f->value[0]) != 0 || qe > UINT64_MAX)
+        {
+            return 0;
+        }
+    }
+
+    ph_job job = {ctx, crt, g, h, order, factors, params, calloc(factors->count, sizeof(int))};
+    parallel_for(NULL, 0, factors->count, 1, prime_power_range, &job, NULL);
+    int ok = 1;
+    for (size_t i = 0; i < factors->count; i++)
+    {
+        ok &= job.solved[i];
+    }
+    free(job.solved);
+    return ok;
+}
@@ -0,0 +1,47 @@
+#ifndef DLOG_ /* Include guard */
+#define DLOG_
+
+#include <stdint.h>
+#include "crt.h"
+#include "factor.h"
+
+// Discrete logarithms in (Z/mZ)^* by Pohlig-Hellman: with N the order of
+// the group and q^e one of its prime powers, x mod q^e is read off
+// g^(N / q^e) and h^(N / q^e) one base-q digit at a time, each digit a
+// logarithm in the subgroup of order q. Every prime power is solved as a
+// separate task on the shared pool and its residue folded into the
+// caller's crt_ctx as soon as it is known. Elements are in Montgomery
+// form; prime powers must fit in a limb.
+//
+// Logarithms in a subgroup of prime order q use baby-step giant-step up
+// to bsgs_bound and Pollard rho above it. The BSGS table holds at most
+// bsgs_max_entries baby steps, each 8 bytes in an open-addressing array
+// at most half full: a 32-bit fingerprint of the element and its index.
+// A fingerprint match is confirmed with one exponentiation, so the
+// elements themselves are never stored; past the entry cap the search
+// takes more giant steps instead of more memory. Rho walks an r-adding
+// walk of DLOG_RHO_PARTITIONS multipliers and finds its cycle with
+// Brent's method, which keeps a single saved point.
+
+#define DLOG_RHO_PARTITIONS 32
+#define DLOG_RHO_WORK_LIMIT 8 // default give-up point, in multiples of the expected walk
+
+typedef struct
+{
+    uint64_t bsgs_bound;
+    size_t bsgs_max_entries;
+    uint64_t rho_iterations; // per prime, across restarts; 0 for the default limit
+} dlog_params;
+
+void dlog_params_default(dlog_params *params);
+
+int dlog_bsgs(const mont_ctx *ctx, uint64_t *x, const limb_t *g, const limb_t *h, uint64_t order,
+              size_t max_entries);
+
+int dlog_rho(const mont_ctx *ctx, uint64_t *x, const limb_t *g, const limb_t *h, uint64_t order,
+             uint64_t iterations, uint64_t seed);
+
+int dlog_pohlig_hellman(const mont_ctx *ctx, crt_ctx *crt, const limb_t *g, const limb_t *h, const limb_t *order,
+                        const factor_list *factors, const dlog_params *params);
+
+#endif // DLOG_
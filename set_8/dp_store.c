@@ -0,0 +1,221 @@
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dp_store.h"
+
+#define DP_MAGIC 0x3130305453505044ull // "DPPST001"
+#define DP_READY 1ull
+#define DP_FINGERPRINT_SHIFT 16
+#define DP_OPEN_ATTEMPTS 8
+#define DP_READY_SPINS (1u << 20) // then the writer is taken to have died mid-insert
+
+static size_t mapping_size(size_t capacity)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t bytes = page + capacity * sizeof(dp_entry);
+    return (bytes + page - 1) / page * page;
+}
+
+// Opens path under an exclusive flock, resuming it when its header
+// matches magic and problem. A stale file is unlinked rather than
+// truncated, since other processes may still map it and would fault on
+// the lost pages; the fresh file takes its place. Returns the locked fd
+// with *slots and store->resumed set, or -1.
+static int open_file(dp_store *store, const char *path, size_t *slots, uint64_t problem)
+{
+    for (int attempt = 0; attempt < DP_OPEN_ATTEMPTS; attempt++)
+    {
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        // Serializes the check-and-initialize against other processes
+        // opening the same file.
+        flock(fd, LOCK_EX);
+
+        struct stat st;
+        dp_header existing = {0};
+        if (fstat(fd, &st) < 0)
+        {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return -1;
+        }
+        if (st.st_nlink == 0)
+        {
+            // Replaced by another process between our open and flock.
+            flock(fd, LOCK_UN);
+            close(fd);
+            continue;
+        }
+        if ((size_t)st.st_size >= sizeof(existing) &&
+            pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+            existing.magic == DP_MAGIC && existing.problem == problem &&
+            (size_t)st.st_size == mapping_size(existing.capacity))
+        {
+            *slots = existing.capacity;
+            store->resumed = 1;
+            return fd;
+        }
+        if (st.st_size == 0)
+        {
+            if (ftruncate(fd, (off_t)mapping_size(*slots)) < 0)
+            {
+                flock(fd, LOCK_UN);
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+        unlink(path);
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+    return -1;
+}
+
+// Capacity is rounded up to a power of two. A file whose header matches
+// magic and problem is resumed as is (with its own capacity); anything
+// else is replaced by a new file. Returns 0 on failure.
+int dp_store_open(dp_store *store, const char *path, size_t capacity, uint64_t problem)
+{
+    size_t slots = 1024;
+    while (slots < capacity)
+    {
+        slots <<= 1;
+    }
+
+    store->fd = -1;
+    store->resumed = 0;
+    if (path == NULL)
+    {
+        store->mapped = mapping_size(slots);
+        void *data = mmap(NULL, store->mapped, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+        {
+            return 0;
+        }
+        store->header = data;
+    }
+    else
+    {
+        int fd = open_file(store, path, &slots, problem);
+        if (fd < 0)
+        {
+            return 0;
+        }
+        store->mapped = mapping_size(slots);
+        void *data = mmap(NULL, store->mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return 0;
+        }
+        store->header = data;
+        store->fd = fd;
+    }
+
+    store->entries = (dp_entry *)((char *)store->header + (size_t)sysconf(_SC_PAGESIZE));
+    store->mask = slots - 1;
+    if (!store->resumed)
+    {
+        store->header->capacity = slots;
+        store->header->problem = problem;
+        atomic_store(&store->header->count, 0);
+        store->header->magic = DP_MAGIC;
+    }
+    if (store->fd >= 0)
+    {
+        flock(store->fd, LOCK_UN);
+    }
+    return 1;
+}
+
+// Checkpoint: schedule the mapping for write-back without blocking.
+void dp_store_sync(dp_store *store)
+{
+    if (store->fd >= 0)
+    {
+        msync(store->header, store->mapped, MS_ASYNC);
+    }
+}
+
+void dp_store_close(dp_store *store)
+{
+    if (store->fd >= 0)
+    {
+        msync(store->header, store->mapped, MS_SYNC);
+    }
+    munmap(store->header, store->mapped);
+    if (store->fd >= 0)
+    {
+        close(store->fd);
+    }
+}
+
+// Inserts the point, or reports the entry already holding its fingerprint
+// in hit. A claimed slot is published by setting its ready bit after the
+// distance is written; readers that find the fingerprint first wait for
+// it, but only so long: a writer that died between claim and publish
+// (in a run since resumed, or in another process on the same file)
+// leaves a slot that never becomes ready, and it is passed over as a
+// miss. Whether a collision is useful (tame/wild) is the caller's call.
+dp_result dp_store_insert(dp_store *store, uint64_t fingerprint, uint64_t distance, uint32_t tag, dp_hit *hit)
+{
+    uint64_t key = fingerprint << DP_FINGERPRINT_SHIFT;
+    uint64_t claim = key | (uint64_t)(tag & ((1u << DP_TAG_BITS) - 1)) << 1;
+    if (key == 0)
+    {
+        key = (uint64_t)1 << DP_FINGERPRINT_SHIFT;
+        claim |= key;
+    }
+
+    for (size_t slot = (size_t)(fingerprint ^ fingerprint >> 29) & store->mask, probes = 0; probes <= store->mask;
+         slot = (slot + 1) & store->mask, probes++)
+    {
+        dp_entry *entry = &store->entries[slot];
+        uint64_t word = atomic_load_explicit(&entry->word, memory_order_acquire);
+        if (word == 0)
+        {
+            if (atomic_load_explicit(&store->header->count, memory_order_relaxed) >=
+                (uint64_t)(DP_MAX_LOAD * (store->mask + 1)))
+            {
+                return DP_FULL;
+            }
+            if (atomic_compare_exchange_strong(&entry->word, &word, claim))
+            {
+                atomic_store_explicit(&entry->distance, distance, memory_order_relaxed);
+                atomic_fetch_or_explicit(&entry->word, DP_READY, memory_order_release);
+                atomic_fetch_add_explicit(&store->header->count, 1, memory_order_relaxed);
+                return DP_STORED;
+            }
+        }
+        if ((word & ~(((uint64_t)1 << DP_FINGERPRINT_SHIFT) - 1)) != key)
+        {
+            continue;
+        }
+        for (unsigned spins = 0; !(word & DP_READY) && spins < DP_READY_SPINS; spins++)
+        {
+            sched_yield();
+            word = atomic_load_explicit(&entry->word, memory_order_acquire);
+        }
+        if (!(word & DP_READY))
+        {
+            continue;
+        }
+        hit->distance = atomic_load_explicit(&entry->distance, memory_order_relaxed);
+        hit->tag = (uint32_t)(word >> 1) & ((1u << DP_TAG_BITS) - 1);
+        return DP_COLLISION;
+    }
+    return DP_FULL;
+}
+
+size_t dp_store_count(const dp_store *store)
+{
+    return (size_t)atomic_load(&store->header->count);
+}
@@ -0,0 +1,66 @@
+#ifndef DP_STORE_ /* Include guard */
+#define DP_STORE_
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Concurrent open-addressing table of distinguished points for collision
+// searches. Entries are 16 bytes: a 48-bit fingerprint, a 15-bit tag and a
+// ready bit packed in one word claimed by CAS, plus the walk distance.
+// Backed by an anonymous mapping or, when a path is given, a shared file
+// mapping that survives restarts and can be opened by several processes
+// at once; `problem` identifies the search so a stale file is replaced.
+
+#define DP_TAG_BITS 15
+#define DP_TAG_WILD (1u << (DP_TAG_BITS - 1))
+#define DP_MAX_LOAD 0.75
+
+typedef enum
+{
+    DP_STORED,
+    DP_COLLISION,
+    DP_FULL
+} dp_result;
+
+typedef struct
+{
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t problem;
+    _Atomic uint64_t count;
+} dp_header;
+
+typedef struct
+{
+    _Atomic uint64_t word;
+    _Atomic uint64_t distance;
+} dp_entry;
+
+typedef struct
+{
+    uint64_t distance;
+    uint32_t tag;
+} dp_hit;
+
+typedef struct
+{
+    dp_header *header;
+    dp_entry *entries;
+    size_t mask;
+    size_t mapped;
+    int fd;
+    int resumed;
+} dp_store;
+
+int dp_store_open(dp_store *store, const char *path, size_t capacity, uint64_t problem);
+
+void dp_store_sync(dp_store *store);
+
+void dp_store_close(dp_store *store);
+
+dp_result dp_store_insert(dp_store *store, uint64_t fingerprint, uint64_t distance, uint32_t tag, dp_hit *hit);
+
+size_t dp_store_count(const dp_store *store);
+
+#endif // DP_STORE_
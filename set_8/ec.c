@@ -0,0 +1,630 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ec.h"
+#include "../common/thread_pool.h"
+
+#define EC_MUL_GRAIN 16
+
+typedef struct
+{
+    const ec_curve *curve;
+    ec_jacobian *out;
+    const ec_affine *points;
+    const limb_t *scalars;
+    size_t kn;
+} mul_batch_job;
+
+int ec_curve_init(ec_curve *curve, const char *p, const char *a, const char *b, const char *gx, const char *gy,
+                  const char *order)
+{
+    limb_t x[BN_MAX_LIMBS], y[BN_MAX_LIMBS];
+    if (!bn_from_dec(curve->p, BN_MAX_LIMBS, p) || !bn_from_dec(curve->order, BN_MAX_LIMBS, order))
+    {
+        return 0;
+    }
+    curve->n = BN_LIMBS(bn_bits(curve->p, BN_MAX_LIMBS));
+    curve->bytes = (bn_bits(curve->p, BN_MAX_LIMBS) + 7) / 8;
+    curve->order_n = BN_LIMBS(bn_bits(curve->order, BN_MAX_LIMBS));
+    mont_init(&curve->ctx, curve->p, curve->n);
+    mont_inv_init(&curve->inv, &curve->ctx);
+    mont_sqrt_init(&curve->sqrt, &curve->ctx);
+
+    if (!ec_field_from_dec(curve, curve->a, a) || !ec_field_from_dec(curve, curve->b, b) ||
+        !ec_field_from_dec(curve, x, gx) || !ec_field_from_dec(curve, y, gy))
+    {
+        return 0;
+    }
+    bn_copy(curve->base.x, x, curve->n);
+    bn_copy(curve->base.y, y, curve->n);
+    curve->base.infinity = 0;
+    return ec_on_curve(curve, &curve->base);
+}
+
+// Same field and a, different b: the curves an invalid-curve attacker
+// draws points from. order is that curve's group order; there is no base
+// point.
+int ec_curve_with_b(ec_curve *r, const ec_curve *curve, const char *b, const char *order)
+{
+    *r = *curve;
+    if (!ec_field_from_dec(r, r->b, b) || !bn_from_dec(r->order, BN_MAX_LIMBS, order))
+    {
+        return 0;
+    }
+    r->order_n = BN_LIMBS(bn_bits(r->order, BN_MAX_LIMBS));
+    bn_zero(r->base.x, r->n);
+    bn_zero(r->base.y, r->n);
+    r->base.infinity = 1;
+    return 1;
+}
+
+// Decimal, optionally negative, reduced mod p and put in Montgomery form.
+int ec_field_from_dec(const ec_curve *curve, limb_t *r, const char *str)
+{
+    limb_t v[BN_MAX_LIMBS];
+    int negative = *str == '-';
+    if (!bn_from_dec(v, BN_MAX_LIMBS, str + negative))
+    {
+        return 0;
+    }
+    bn_mod(v, v, BN_MAX_LIMBS, curve->p, curve->n);
+    mont_to(&curve->ctx, r, v);
+    if (negative)
+    {
+        mont_neg(&curve->ctx, r, r);
+    }
+    return 1;
+}
+
+// Constant-time safegcd, Montgomery form in and out; zero maps to zero.
+void ec_field_inv(const ec_curve *curve, limb_t *r, const limb_t *a)
+{
+    mont_inv(&curve->ctx, &curve->inv, r, a);
+}
+
+// Elements spaced BN_MAX_LIMBS apart, one safegcd for the whole array;
+// zeros come back as zero and r may alias a.
+void ec_field_inv_batch(const ec_curve *curve, limb_t *r, const limb_t *a, size_t count)
+{
+    mont_inv_batch(&curve->ctx, &curve->inv, r, a, count);
+}
+
+// x and y plain.
+void ec_affine_set(const ec_curve *curve, ec_affine *r, const limb_t *x, const limb_t *y)
+{
+    mont_to(&curve->ctx, r->x, x);
+    mont_to(&curve->ctx, r->y, y);
+    r->infinity = 0;
+}
+
+void ec_affine_get(const ec_curve *curve, limb_t *x, limb_t *y, const ec_affine *a)
+{
+    if (x != NULL)
+    {
+        mont_from(&curve->ctx, x, a->x);
+    }
+    if (y != NULL)
+    {
+        mont_from(&curve->ctx, y, a->y);
+    }
+}
+
+int ec_on_curve(const ec_curve *curve, const ec_affine *a)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t lhs[BN_MAX_LIMBS], rhs[BN_MAX_LIMBS];
+    if (a->infinity)
+    {
+        return 1;
+    }
+    mont_sqr(ctx, lhs, a->y);
+    mont_sqr(ctx, rhs, a->x);
+    mont_add(ctx, rhs, rhs, curve->a);
+    mont_mul(ctx, rhs, rhs, a->x);
+    mont_add(ctx, rhs, rhs, curve->b);
+    return bn_cmp(lhs, rhs, curve->n) == 0;
+}
+
+void ec_set_infinity(const ec_curve *curve, ec_jacobian *r)
+{
+    bn_copy(r->x, curve->ctx.one, curve->n);
+    bn_copy(r->y, curve->ctx.one, curve->n);
+    bn_zero(r->z, curve->n);
+}
+
+int ec_is_infinity(const ec_curve *curve, const ec_jacobian *a)
+{
+    return bn_is_zero(a->z, curve->n);
+}
+
+void ec_from_affine(const ec_curve *curve, ec_jacobian *r, const ec_affine *a)
+{
+    if (a->infinity)
+    {
+        ec_set_infinity(curve, r);
+        return;
+    }
+    bn_copy(r->x, a->x, curve->n);
+    bn_copy(r->y, a->y, curve->n);
+    bn_copy(r->z, curve->ctx.one, curve->n);
+}
+
+void ec_to_affine(const ec_curve *curve, ec_affine *r, const ec_jacobian *a)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t zi[BN_MAX_LIMBS], zi2[BN_MAX_LIMBS];
+    if (ec_is_infinity(curve, a))
+    {
+        bn_zero(r->x, curve->n);
+        bn_zero(r->y, curve->n);
+        r->infinity = 1;
+        return;
+    }
+    ec_field_inv(curve, zi, a->z);
+    mont_sqr(ctx, zi2, zi);
+    mont_mul(ctx, r->x, a->x, zi2);
+    mont_mul(ctx, zi2, zi2, zi);
+    mont_mul(ctx, r->y, a->y, zi2);
+    r->infinity = 0;
+}
+
+// Montgomery form in and out, by whichever method mont_sqrt_init picked
+// for p. Returns 0 when a is not a square mod p.
+int ec_field_sqrt(const ec_curve *curve, limb_t *r, const limb_t *a)
+{
+    return mont_sqrt(&curve->ctx, &curve->sqrt, r, a);
+}
+
+// The point with plain x-coordinate x, taking the smaller of the two
+// square roots (as plain integers) for y, so P and -P lift to the same
+// representative. Returns 0 when x belongs to the twist.
+int ec_lift_x(const ec_curve *curve, ec_affine *r, const limb_t *x)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t rhs[BN_MAX_LIMBS], y[BN_MAX_LIMBS], neg[BN_MAX_LIMBS];
+
+    mont_to(ctx, r->x, x);
+    mont_sqr(ctx, rhs, r->x);
+    mont_add(ctx, rhs, rhs, curve->a);
+    mont_mul(ctx, rhs, rhs, r->x);
+    mont_add(ctx, rhs, rhs, curve->b);
+    if (!ec_field_sqrt(curve, r->y, rhs))
+    {
+        return 0;
+    }
+    mont_from(ctx, y, r->y);
+    bn_sub(neg, curve->p, y, n);
+    if (!bn_is_zero(y, n) && bn_cmp(neg, y, n) < 0)
+    {
+        mont_neg(ctx, r->y, r->y);
+    }
+    r->infinity = 0;
+    return 1;
+}
+
+// One shared inversion for the whole array instead of one per point.
+void ec_to_affine_batch(const ec_curve *curve, ec_affine *r, const ec_jacobian *a, size_t count)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t zi2[BN_MAX_LIMBS];
+    if (count == 0)
+    {
+        return;
+    }
+
+    limb_t *zi = malloc(sizeof(limb_t) * BN_MAX_LIMBS * count);
+    for (size_t i = 0; i < count; i++)
+    {
+        bn_copy(zi + i * BN_MAX_LIMBS, a[i].z, curve->n);
+    }
+    ec_field_inv_batch(curve, zi, zi, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const limb_t *z = zi + i * BN_MAX_LIMBS;
+        if (bn_is_zero(z, curve->n))
+        {
+            bn_zero(r[i].x, curve->n);
+            bn_zero(r[i].y, curve->n);
+            r[i].infinity = 1;
+            continue;
+        }
+        mont_sqr(ctx, zi2, z);
+        mont_mul(ctx, r[i].x, a[i].x, zi2);
+        mont_mul(ctx, zi2, zi2, z);
+        mont_mul(ctx, r[i].y, a[i].y, zi2);
+        r[i].infinity = 0;
+    }
+    free(zi);
+}
+
+// X1 Z2^2 = X2 Z1^2 and Y1 Z2^3 = Y2 Z1^3, without normalizing either side.
+int ec_equal(const ec_curve *curve, const ec_jacobian *a, const ec_jacobian *b)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t za[BN_MAX_LIMBS], zb[BN_MAX_LIMBS], l[BN_MAX_LIMBS], r[BN_MAX_LIMBS];
+    int ia = ec_is_infinity(curve, a), ib = ec_is_infinity(curve, b);
+    if (ia || ib)
+    {
+        return ia && ib;
+    }
+    mont_sqr(ctx, za, a->z);
+    mont_sqr(ctx, zb, b->z);
+    mont_mul(ctx, l, a->x, zb);
+    mont_mul(ctx, r, b->x, za);
+    if (bn_cmp(l, r, n) != 0)
+    {
+        return 0;
+    }
+    mont_mul(ctx, za, za, a->z);
+    mont_mul(ctx, zb, zb, b->z);
+    mont_mul(ctx, l, a->y, zb);
+    mont_mul(ctx, r, b->y, za);
+    return bn_cmp(l, r, n) == 0;
+}
+
+void ec_neg(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a)
+{
+    bn_copy(r->x, a->x, curve->n);
+    mont_neg(&curve->ctx, r->y, a->y);
+    bn_copy(r->z, a->z, curve->n);
+}
+
+void ec_affine_neg(const ec_curve *curve, ec_affine *r, const ec_affine *a)
+{
+    bn_copy(r->x, a->x, curve->n);
+    mont_neg(&curve->ctx, r->y, a->y);
+    r->infinity = a->infinity;
+}
+
+// dbl-2007-bl: 1M + 8S for general a.
+void ec_double(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t xx[BN_MAX_LIMBS], yy[BN_MAX_LIMBS], yyyy[BN_MAX_LIMBS], zz[BN_MAX_LIMBS];
+    limb_t s[BN_MAX_LIMBS], m[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+    if (ec_is_infinity(curve, a) || bn_is_zero(a->y, curve->n))
+    {
+        ec_set_infinity(curve, r);
+        return;
+    }
+    mont_sqr(ctx, xx, a->x);
+    mont_sqr(ctx, yy, a->y);
+    mont_sqr(ctx, yyyy, yy);
+    mont_sqr(ctx, zz, a->z);
+
+    // S = 2 ((X + YY)^2 - XX - YYYY)
+    mont_add(ctx, s, a->x, yy);
+    mont_sqr(ctx, s, s);
+    mont_sub(ctx, s, s, xx);
+    mont_sub(ctx, s, s, yyyy);
+    mont_add(ctx, s, s, s);
+
+    // M = 3 XX + a ZZ^2
+    mont_sqr(ctx, t, zz);
+    mont_mul(ctx, m, curve->a, t);
+    mont_add(ctx, m, m, xx);
+    mont_add(ctx, m, m, xx);
+    mont_add(ctx, m, m, xx);
+
+    // Z3 = (Y + Z)^2 - YY - ZZ, before X3 and Y3 may overwrite a.
+    mont_add(ctx, r->z, a->y, a->z);
+    mont_sqr(ctx, r->z, r->z);
+    mont_sub(ctx, r->z, r->z, yy);
+    mont_sub(ctx, r->z, r->z, zz);
+
+    // X3 = M^2 - 2 S, Y3 = M (S - X3) - 8 YYYY
+    mont_sqr(ctx, t, m);
+    mont_sub(ctx, t, t, s);
+    mont_sub(ctx, r->x, t, s);
+    mont_sub(ctx, t, s, r->x);
+    mont_mul(ctx, t, m, t);
+    mont_add(ctx, yyyy, yyyy, yyyy);
+    mont_add(ctx, yyyy, yyyy, yyyy);
+    mont_add(ctx, yyyy, yyyy, yyyy);
+    mont_sub(ctx, r->y, t, yyyy);
+}
+
+// add-2007-bl: 11M + 5S. Falls back to doubling for a = b.
+void ec_add(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a, const ec_jacobian *b)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t z1z1[BN_MAX_LIMBS], z2z2[BN_MAX_LIMBS], u1[BN_MAX_LIMBS], u2[BN_MAX_LIMBS];
+    limb_t s1[BN_MAX_LIMBS], s2[BN_MAX_LIMBS], h[BN_MAX_LIMBS], i[BN_MAX_LIMBS];
+    limb_t j[BN_MAX_LIMBS], rr[BN_MAX_LIMBS], v[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+    if (ec_is_infinity(curve, a))
+    {
+        *r = *b;
+        return;
+    }
+    if (ec_is_infinity(curve, b))
+    {
+        *r = *a;
+        return;
+    }
+    mont_sqr(ctx, z1z1, a->z);
+    mont_sqr(ctx, z2z2, b->z);
+    mont_mul(ctx, u1, a->x, z2z2);
+    mont_mul(ctx, u2, b->x, z1z1);
+    mont_mul(ctx, s1, a->y, b->z);
+    mont_mul(ctx, s1, s1, z2z2);
+    mont_mul(ctx, s2, b->y, a->z);
+    mont_mul(ctx, s2, s2, z1z1);
+    mont_sub(ctx, h, u2, u1);
+    mont_sub(ctx, rr, s2, s1);
+    if (bn_is_zero(h, n))
+    {
+        if (bn_is_zero(rr, n))
+        {
+            ec_double(curve, r, a);
+        }
+        else
+        {
+            ec_set_infinity(curve, r);
+        }
+        return;
+    }
+    mont_add(ctx, rr, rr, rr);
+    mont_add(ctx, i, h, h);
+    mont_sqr(ctx, i, i);
+    mont_mul(ctx, j, h, i);
+    mont_mul(ctx, v, u1, i);
+
+    // Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) H
+    mont_add(ctx, t, a->z, b->z);
+    mont_sqr(ctx, t, t);
+    mont_sub(ctx, t, t, z1z1);
+    mont_sub(ctx, t, t, z2z2);
+    mont_mul(ctx, r->z, t, h);
+
+    // X3 = r^2 - J - 2 V, Y3 = r (V - X3) - 2 S1 J
+    mont_sqr(ctx, t, rr);
+    mont_sub(ctx, t, t, j);
+    mont_sub(ctx, t, t, v);
+    mont_sub(ctx, r->x, t, v);
+    mont_sub(ctx, t, v, r->x);
+    mont_mul(ctx, t, rr, t);
+    mont_mul(ctx, s1, s1, j);
+    mont_add(ctx, s1, s1, s1);
+    mont_sub(ctx, r->y, t, s1);
+}
+
+// madd-2007-bl: 7M + 4S with b affine (Z2 = 1).
+void ec_add_mixed(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a, const ec_affine *b)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t z1z1[BN_MAX_LIMBS], u2[BN_MAX_LIMBS], s2[BN_MAX_LIMBS], h[BN_MAX_LIMBS];
+    limb_t hh[BN_MAX_LIMBS], i[BN_MAX_LIMBS], j[BN_MAX_LIMBS], rr[BN_MAX_LIMBS];
+    limb_t v[BN_MAX_LIMBS], t[BN_MAX_LIMBS], y1[BN_MAX_LIMBS];
+
+    if (b->infinity)
+    {
+        *r = *a;
+        return;
+    }
+    if (ec_is_infinity(curve, a))
+    {
+        ec_from_affine(curve, r, b);
+        return;
+    }
+    mont_sqr(ctx, z1z1, a->z);
+    mont_mul(ctx, u2, b->x, z1z1);
+    mont_mul(ctx, s2, b->y, a->z);
+    mont_mul(ctx, s2, s2, z1z1);
+    mont_sub(ctx, h, u2, a->x);
+    mont_sub(ctx, rr, s2, a->y);
+    if (bn_is_zero(h, n))
+    {
+        if (bn_is_zero(rr, n))
+        {
+            ec_double(curve, r, a);
+        }
+        else
+        {
+            ec_set_infinity(curve, r);
+        }
+        return;
+    }
+    mont_add(ctx, rr, rr, rr);
+    mont_sqr(ctx, hh, h);
+    mont_add(ctx, i, hh, hh);
+    mont_add(ctx, i, i, i);
+    mont_mul(ctx, j, h, i);
+    mont_mul(ctx, v, a->x, i);
+    bn_copy(y1, a->y, n);
+
+    // Z3 = (Z1 + H)^2 - Z1Z1 - HH
+    mont_add(ctx, t, a->z, h);
+    mont_sqr(ctx, t, t);
+    mont_sub(ctx, t, t, z1z1);
+    mont_sub(ctx, r->z, t, hh);
+
+    // X3 = r^2 - J - 2 V, Y3 = r (V - X3) - 2 Y1 J
+    mont_sqr(ctx, t, rr);
+    mont_sub(ctx, t, t, j);
+    mont_sub(ctx, t, t, v);
+    mont_sub(ctx, r->x, t, v);
+    mont_sub(ctx, t, v, r->x);
+    mont_mul(ctx, t, rr, t);
+    mont_mul(ctx, y1, y1, j);
+    mont_add(ctx, y1, y1, y1);
+    mont_sub(ctx, r->y, t, y1);
+}
+
+// Width-w NAF, least significant digit first: every nonzero digit is odd
+// and below 2^(w-1) in magnitude, and any w consecutive digits hold at
+// most one nonzero. digits needs room for bits(k) + 1 entries.
+size_t ec_wnaf(int8_t *digits, const limb_t *k, size_t kn, unsigned width)
+{
+    limb_t d[BN_MAX_LIMBS + 1];
+    size_t len = 0;
+    long full = 1L << width, half = 1L << (width - 1);
+
+    bn_copy(d, k, kn);
+    d[kn] = 0;
+    while (!bn_is_zero(d, kn + 1))
+    {
+        long digit = 0;
+        if (d[0] & 1)
+        {
+            digit = (long)(d[0] & (full - 1));
+            if (digit >= half)
+            {
+                digit -= full;
+            }
+            if (digit > 0)
+            {
+                bn_sub_word(d, d, kn + 1, (limb_t)digit);
+            }
+            else
+            {
+                bn_add_word(d, d, kn + 1, (limb_t)-digit);
+            }
+        }
+        digits[len++] = (int8_t)digit;
+        bn_shr(d, d, kn + 1, 1);
+    }
+    return len;
+}
+
+// Left-to-right wNAF over the odd multiples a, 3a, ..., (2^(w-1) - 1) a.
+void ec_mul(const ec_curve *curve, ec_jacobian *r, const ec_affine *a, const limb_t *k, size_t kn)
+{
+    ec_jacobian table[EC_WNAF_TABLE], twice, acc, neg;
+    int8_t digits[BN_MAX_LIMBS * 64 + 1];
+
+    ec_from_affine(curve, &table[0], a);
+    ec_double(curve, &twice, &table[0]);
+    for (int i = 1; i < EC_WNAF_TABLE; i++)
+    {
+        ec_add(curve, &table[i], &table[i - 1], &twice);
+    }
+
+    size_t len = ec_wnaf(digits, k, kn, EC_WNAF_WIDTH);
+    ec_set_infinity(curve, &acc);
+    for (size_t i = len; i-- > 0;)
+    {
+        ec_double(curve, &acc, &acc);
+        if (digits[i] > 0)
+        {
+            ec_add(curve, &acc, &acc, &table[digits[i] / 2]);
+        }
+        else if (digits[i] < 0)
+        {
+            ec_neg(curve, &neg, &table[-digits[i] / 2]);
+            ec_add(curve, &acc, &acc, &neg);
+        }
+    }
+    *r = acc;
+}
+
+// Straus-Shamir: k1 a + k2 b with one run of doublings, the two wNAF
+// expansions interleaved. Both tables of odd multiples share one
+// normalization, so every addition is a mixed one.
+void ec_mul_double(const ec_curve *curve, ec_jacobian *r, const ec_affine *a, const limb_t *k1, const ec_affine *b,
+                   const limb_t *k2, size_t kn)
+{
+    ec_jacobian multiples[2 * EC_WNAF_TABLE], twice, acc;
+    ec_affine table[2 * EC_WNAF_TABLE], neg;
+    int8_t digits[2][BN_MAX_LIMBS * 64 + 1];
+    const ec_affine *points[2] = {a, b};
+    const limb_t *scalars[2] = {k1, k2};
+    size_t len[2], top = 0;
+
+    for (int s = 0; s < 2; s++)
+    {
+        ec_jacobian *m = multiples + s * EC_WNAF_TABLE;
+        ec_from_affine(curve, &m[0], points[s]);
+        ec_double(curve, &twice, &m[0]);
+        for (int i = 1; i < EC_WNAF_TABLE; i++)
+        {
+            ec_add(curve, &m[i], &m[i - 1], &twice);
+        }
+        len[s] = ec_wnaf(digits[s], scalars[s], kn, EC_WNAF_WIDTH);
+        top = len[s] > top ? len[s] : top;
+    }
+    ec_to_affine_batch(curve, table, multiples, 2 * EC_WNAF_TABLE);
+
+    ec_set_infinity(curve, &acc);
+    for (size_t i = top; i-- > 0;)
+    {
+        ec_double(curve, &acc, &acc);
+        for (int s = 0; s < 2; s++)
+        {
+            int digit = i < len[s] ? digits[s][i] : 0;
+            if (digit > 0)
+            {
+                ec_add_mixed(curve, &acc, &acc, &table[s * EC_WNAF_TABLE + digit / 2]);
+            }
+            else if (digit < 0)
+            {
+                ec_affine_neg(curve, &neg, &table[s * EC_WNAF_TABLE - digit / 2]);
+                ec_add_mixed(curve, &acc, &acc, &neg);
+            }
+        }
+    }
+    *r = acc;
+}
+
+static void mul_range(size_t begin, size_t end, void *ctx)
+{
+    mul_batch_job *job = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        ec_mul(job->curve, &job->out[i], &job->points[i], job->scalars + i * BN_MAX_LIMBS, job->kn);
+    }
+}
+
+// r[i] = k[i] a[i] (scalars spaced BN_MAX_LIMBS apart), multiplied on the
+// shared pool and normalized together.
+void ec_mul_batch(const ec_curve *curve, ec_affine *r, const ec_affine *a, const limb_t *k, size_t kn, size_t count)
+{
+    mul_batch_job job = {curve, malloc(sizeof(ec_jacobian) * count), a, k, kn};
+    parallel_for(NULL, 0, count, EC_MUL_GRAIN, mul_range, &job, NULL);
+    ec_to_affine_batch(curve, r, job.out, count);
+    free(job.out);
+}
+
+// secret is uniform in [1, order); pub = secret * base.
+void ec_keypair(const ec_curve *curve, limb_t *secret, ec_affine *pub)
+{
+    limb_t bound[BN_MAX_LIMBS];
+    ec_jacobian p;
+    bn_sub_word(bound, curve->order, curve->order_n, 1);
+    bn_random_below(secret, bound, curve->order_n);
+    bn_add_word(secret, secret, curve->order_n, 1);
+    ec_mul(curve, &p, &curve->base, secret, curve->order_n);
+    ec_to_affine(curve, pub, &p);
+}
+
+// shared_x is the plain x-coordinate of secret * peer, with a single
+// inversion at the end. Returns 0 if the product is the point at infinity.
+int ec_ecdh(const ec_curve *curve, limb_t *shared_x, const ec_affine *peer, const limb_t *secret)
+{
+    ec_jacobian p;
+    ec_affine q;
+    ec_mul(curve, &p, peer, secret, curve->order_n);
+    if (ec_is_infinity(curve, &p))
+    {
+        return 0;
+    }
+    ec_to_affine(curve, &q, &p);
+    ec_affine_get(curve, shared_x, NULL, &q);
+    return 1;
+}
+
+// HMAC key: x || y of the shared point, each big-endian in `bytes` bytes,
+// so k and -k give different tags.
+void ec_mac(const ec_curve *curve, unsigned char *tag, const ec_affine *shared, const unsigned char *msg, size_t len)
+{
+    unsigned char key[2 * BN_MAX_LIMBS * sizeof(limb_t)];
+    limb_t x[BN_MAX_LIMBS], y[BN_MAX_LIMBS];
+    ec_affine_get(curve, x, y, shared);
+    bn_to_bytes(key, curve->bytes, x, curve->n);
+    bn_to_bytes(key + curve->bytes, curve->bytes, y, curve->n);
+    hmac_sha256(tag, key, 2 * curve->bytes, msg, len);
+}
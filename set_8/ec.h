@@ -0,0 +1,107 @@
+#ifndef EC_ /* Include guard */
+#define EC_
+
+#include <stdint.h>
+#include "bignum.h"
+#include "modinv.h"
+#include "modsqrt.h"
+#include "sha256.h"
+
+// Short Weierstrass curves y^2 = x^3 + a x + b over GF(p). Coordinates
+// are kept in Montgomery form; Jacobian points (X : Y : Z) stand for
+// (X / Z^2, Y / Z^3) and Z = 0 is the point at infinity, so the group
+// law needs no inversions until a result is converted back to affine.
+// Nothing here reads b, so points of a different curve with the same a
+// (invalid-curve attacks) go through the same code.
+
+#define EC_WNAF_WIDTH 5
+#define EC_WNAF_TABLE (1 << (EC_WNAF_WIDTH - 2))
+
+typedef struct
+{
+    limb_t x[BN_MAX_LIMBS];
+    limb_t y[BN_MAX_LIMBS];
+    int infinity;
+} ec_affine;
+
+typedef struct
+{
+    limb_t x[BN_MAX_LIMBS];
+    limb_t y[BN_MAX_LIMBS];
+    limb_t z[BN_MAX_LIMBS];
+} ec_jacobian;
+
+typedef struct
+{
+    size_t n;
+    size_t bytes;
+    size_t order_n;
+    mont_ctx ctx;
+    mont_inv_ctx inv;
+    mont_sqrt_ctx sqrt;
+    limb_t p[BN_MAX_LIMBS];
+    limb_t a[BN_MAX_LIMBS]; // Montgomery form
+    limb_t b[BN_MAX_LIMBS]; // Montgomery form
+    limb_t order[BN_MAX_LIMBS];
+    ec_affine base;
+} ec_curve;
+
+int ec_curve_init(ec_curve *curve, const char *p, const char *a, const char *b, const char *gx, const char *gy,
+                  const char *order);
+
+int ec_curve_with_b(ec_curve *r, const ec_curve *curve, const char *b, const char *order);
+
+int ec_field_from_dec(const ec_curve *curve, limb_t *r, const char *str);
+
+void ec_field_inv(const ec_curve *curve, limb_t *r, const limb_t *a);
+
+void ec_field_inv_batch(const ec_curve *curve, limb_t *r, const limb_t *a, size_t count);
+
+int ec_field_sqrt(const ec_curve *curve, limb_t *r, const limb_t *a);
+
+int ec_lift_x(const ec_curve *curve, ec_affine *r, const limb_t *x);
+
+void ec_affine_set(const ec_curve *curve, ec_affine *r, const limb_t *x, const limb_t *y);
+
+void ec_affine_get(const ec_curve *curve, limb_t *x, limb_t *y, const ec_affine *a);
+
+int ec_on_curve(const ec_curve *curve, const ec_affine *a);
+
+void ec_set_infinity(const ec_curve *curve, ec_jacobian *r);
+
+int ec_is_infinity(const ec_curve *curve, const ec_jacobian *a);
+
+void ec_from_affine(const ec_curve *curve, ec_jacobian *r, const ec_affine *a);
+
+void ec_to_affine(const ec_curve *curve, ec_affine *r, const ec_jacobian *a);
+
+void ec_to_affine_batch(const ec_curve *curve, ec_affine *r, const ec_jacobian *a, size_t count);
+
+int ec_equal(const ec_curve *curve, const ec_jacobian *a, const ec_jacobian *b);
+
+void ec_neg(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a);
+
+void ec_affine_neg(const ec_curve *curve, ec_affine *r, const ec_affine *a);
+
+void ec_double(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a);
+
+void ec_add(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a, const ec_jacobian *b);
+
+void ec_add_mixed(const ec_curve *curve, ec_jacobian *r, const ec_jacobian *a, const ec_affine *b);
+
+size_t ec_wnaf(int8_t *digits, const limb_t *k, size_t kn, unsigned width);
+
+void ec_mul(const ec_curve *curve, ec_jacobian *r, const ec_affine *a, const limb_t *k, size_t kn);
+
+void ec_mul_double(const ec_curve *curve, ec_jacobian *r, const ec_affine *a, const limb_t *k1, const ec_affine *b,
+                   const limb_t *k2, size_t kn);
+
+void ec_mul_batch(const ec_curve *curve, ec_affine *r, const ec_affine *a, const limb_t *k, size_t kn, size_t count);
+
+void ec_keypair(const ec_curve *curve, limb_t *secret, ec_affine *pub);
+
+int ec_ecdh(const ec_curve *curve, limb_t *shared_x, const ec_affine *peer, const limb_t *secret);
+
+void ec_mac(const ec_curve *curve, unsigned char *tag, const ec_affine *shared, const unsigned char *msg, size_t len);
+
+#endif // EC_
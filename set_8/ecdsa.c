@@ -0,0 +1,576 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/random.h>
+#include "ecdsa.h"
+#include "msm.h"
+#include "sha256.h"
+#include "../common/thread_pool.h"
+
+#define ECDSA_GRAIN 8
+
+typedef struct
+{
+    const ecdsa_ctx *ctx;
+    const ecdsa_msg *msgs;
+    const limb_t *k;
+    limb_t *h;
+    ec_jacobian *points;
+} sign_job;
+
+typedef struct
+{
+    const ecdsa_ctx *ctx;
+    const ec_affine *q;
+    const ecdsa_msg *msgs;
+    const ecdsa_sig *sigs;
+    const int *ok;
+    const limb_t *w; // s^-1, Montgomery form mod n
+    ec_jacobian *points;
+} verify_job;
+
+// One chunk of ecdsa_verify_batch_random. valid[i] is -1 while item i
+// still takes part in the combinations; items settled early (bad range,
+// no recovery hint) contribute nothing.
+typedef struct
+{
+    const ecdsa_ctx *ctx;
+    const ec_affine *q;
+    const ecdsa_msg *msgs;
+    const ecdsa_sig *sigs;
+    limb_t *w;       // s^-1, then u1 = h s^-1, Montgomery form mod n
+    limb_t *u2;      // r s^-1, plain
+    limb_t *z;       // one limb each
+    limb_t *zm;      // z in Montgomery form mod n
+    ec_affine *rs;   // recovered R, infinity for settled items
+    int *valid;
+} combine_job;
+
+void ecdsa_init(ecdsa_ctx *ctx, const ec_curve *curve)
+{
+    size_t entries = (size_t)1 << ECDSA_COMB_TEETH;
+    ec_jacobian *table = malloc(sizeof(ec_jacobian) * entries), g;
+
+    ctx->curve = curve;
+    ctx->n = curve->order_n;
+    mont_init(&ctx->scalar, curve->order, ctx->n);
+    mont_inv_init(&ctx->scalar_inv, &ctx->scalar);
+    ctx->spacing = (bn_bits(curve->order, ctx->n) + ECDSA_COMB_TEETH - 1) / ECDSA_COMB_TEETH;
+    ctx->comb = malloc(sizeof(ec_affine) * entries);
+
+    // table[2^j + i] = table[i] + 2^(j * spacing) G for i < 2^j.
+    ec_set_infinity(curve, &table[0]);
+    ec_from_affine(curve, &g, &curve->base);
+    for (unsigned j = 0; j < ECDSA_COMB_TEETH; j++)
+    {
+        size_t half = (size_t)1 << j;
+        for (size_t i = 0; i < half; i++)
+        {
+            ec_add(curve, &table[half + i], &table[i], &g);
+        }
+        for (size_t s = 0; s < ctx->spacing; s++)
+        {
+            ec_double(curve, &g, &g);
+        }
+    }
+    ec_to_affine_batch(curve, ctx->comb, table, entries);
+    free(table);
+}
+
+void ecdsa_free(ecdsa_ctx *ctx)
+{
+    free(ctx->comb);
+    ctx->comb = NULL;
+}
+
+// The leftmost bits(n) bits of SHA-256(msg), reduced mod n.
+void ecdsa_hash(const ecdsa_ctx *ctx, limb_t *h, const unsigned char *msg, size_t len)
+{
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    limb_t t[BN_MAX_LIMBS];
+    size_t bits = bn_bits(ctx->scalar.m, ctx->n);
+    size_t tn = ctx->n > BN_LIMBS(8 * SHA256_DIGEST_SIZE) ? ctx->n : BN_LIMBS(8 * SHA256_DIGEST_SIZE);
+
+    sha256(digest, msg, len);
+    bn_from_bytes(t, tn, digest, sizeof(digest));
+    if (bits < 8 * SHA256_DIGEST_SIZE)
+    {
+        bn_shr(t, t, tn, 8 * SHA256_DIGEST_SIZE - bits);
+    }
+    bn_mod(h, t, tn, ctx->scalar.m, ctx->n);
+}
+
+// k G for k < n: one doubling and at most one mixed addition per comb
+// column.
+void ecdsa_base_mul(const ecdsa_ctx *ctx, ec_jacobian *r, const limb_t *k)
+{
+    const ec_curve *curve = ctx->curve;
+    size_t limit = ctx->n * BN_LIMB_BITS;
+
+    ec_set_infinity(curve, r);
+    for (size_t s = ctx->spacing; s-- > 0;)
+    {
+        size_t index = 0;
+        for (unsigned j = ECDSA_COMB_TEETH; j-- > 0;)
+        {
+            size_t bit = j * ctx->spacing + s;
+            index = index << 1 | (bit < limit ? (size_t)bn_bit(k, bit) : 0);
+        }
+        ec_double(curve, r, r);
+        if (index != 0)
+        {
+            ec_add_mixed(curve, r, r, &ctx->comb[index]);
+        }
+    }
+}
+
+// Uniform in [1, n).
+static void random_scalar(const ecdsa_ctx *ctx, limb_t *k)
+{
+    limb_t bound[BN_MAX_LIMBS];
+    bn_sub_word(bound, ctx->scalar.m, ctx->n, 1);
+    bn_random_below(k, bound, ctx->n);
+    bn_add_word(k, k, ctx->n, 1);
+}
+
+static int scalar_in_range(const ecdsa_ctx *ctx, const limb_t *v)
+{
+    return !bn_is_zero(v, ctx->n) && bn_cmp(v, ctx->scalar.m, ctx->n) < 0;
+}
+
+// r = x(R) mod n, and the hint that takes r back to R when recovery is
+// not NULL.
+static void point_to_r(const ecdsa_ctx *ctx, limb_t *r, int *recovery, const ec_affine *point)
+{
+    size_t n = ctx->curve->n;
+    limb_t x[BN_MAX_LIMBS], y[BN_MAX_LIMBS], q[BN_MAX_LIMBS];
+
+    ec_affine_get(ctx->curve, x, y, point);
+    bn_divmod(q, r, x, n, ctx->scalar.m, ctx->n);
+    if (recovery != NULL)
+    {
+        *recovery = (int)(q[0] << 1 | (y[0] & 1));
+    }
+}
+
+// r = x(k G) mod n, s = k^-1 (h + d r) with kinv = k^-1 and dm = d in
+// Montgomery form. Returns 0 when r or s comes out zero and the nonce
+// has to be redrawn.
+static int finish_sig(const ecdsa_ctx *ctx, ecdsa_sig *sig, const limb_t *dm, const ec_affine *point,
+                      const limb_t *kinv, const limb_t *h)
+{
+    const mont_ctx *sc = &ctx->scalar;
+    limb_t t[BN_MAX_LIMBS];
+
+    point_to_r(ctx, sig->r, &sig->recovery, point);
+    if (bn_is_zero(sig->r, ctx->n))
+    {
+        return 0;
+    }
+    mont_mul(sc, t, dm, sig->r);
+    mont_add(sc, t, t, h);
+    mont_mul(sc, sig->s, kinv, t);
+    return !bn_is_zero(sig->s, ctx->n);
+}
+
+void ecdsa_keypair(const ecdsa_ctx *ctx, limb_t *d, ec_affine *q)
+{
+    ec_jacobian p;
+    random_scalar(ctx, d);
+    ecdsa_base_mul(ctx, &p, d);
+    ec_to_affine(ctx->curve, q, &p);
+}
+
+void ecdsa_sign(const ecdsa_ctx *ctx, ecdsa_sig *sig, const limb_t *d, const unsigned char *msg, size_t len)
+{
+    limb_t k[BN_MAX_LIMBS], kinv[BN_MAX_LIMBS], dm[BN_MAX_LIMBS], h[BN_MAX_LIMBS];
+    ec_jacobian p;
+    ec_affine point;
+
+    mont_to(&ctx->scalar, dm, d);
+    ecdsa_hash(ctx, h, msg, len);
+    do
+    {
+        random_scalar(ctx, k);
+        ecdsa_base_mul(ctx, &p, k);
+        ec_to_affine(ctx->curve, &point, &p);
+        mont_to(&ctx->scalar, kinv, k);
+        mont_inv(&ctx->scalar, &ctx->scalar_inv, kinv, kinv);
+    } while (!finish_sig(ctx, sig, dm, &point, kinv, h));
+}
+
+// u1 G + u2 Q with u1 = h s^-1 and u2 = r s^-1, w = s^-1 in Montgomery
+// form.
+static void verify_point(const ecdsa_ctx *ctx, ec_jacobian *r, const ec_affine *q, const ecdsa_sig *sig,
+                         const limb_t *w, const limb_t *h)
+{
+    limb_t u1[BN_MAX_LIMBS], u2[BN_MAX_LIMBS];
+    mont_mul(&ctx->scalar, u1, w, h);
+    mont_mul(&ctx->scalar, u2, w, sig->r);
+    ec_mul_double(ctx->curve, r, &ctx->curve->base, u1, q, u2, ctx->n);
+}
+
+static int check_r(const ecdsa_ctx *ctx, const ec_affine *point, const limb_t *r)
+{
+    limb_t x[BN_MAX_LIMBS];
+    if (point->infinity)
+    {
+        return 0;
+    }
+    point_to_r(ctx, x, NULL, point);
+    return bn_cmp(x, r, ctx->n) == 0;
+}
+
+int ecdsa_verify(const ecdsa_ctx *ctx, const ecdsa_sig *sig, const ec_affine *q, const unsigned char *msg, size_t len)
+{
+    limb_t w[BN_MAX_LIMBS], h[BN_MAX_LIMBS];
+    ec_jacobian p;
+    ec_affine point;
+
+    if (!scalar_in_range(ctx, sig->r) || !scalar_in_range(ctx, sig->s))
+    {
+        return 0;
+    }
+    mont_to(&ctx->scalar, w, sig->s);
+    mont_inv_vartime(&ctx->scalar, &ctx->scalar_inv, w, w);
+    ecdsa_hash(ctx, h, msg, len);
+    verify_point(ctx, &p, q, sig, w, h);
+    ec_to_affine(ctx->curve, &point, &p);
+    return check_r(ctx, &point, sig->r);
+}
+
+static void sign_range(size_t begin, size_t end, void *arg)
+{
+    sign_job *job = arg;
+    for (size_t i = begin; i < end; i++)
+    {
+        ecdsa_base_mul(job->ctx, &job->points[i], job->k + i * BN_MAX_LIMBS);
+        ecdsa_hash(job->ctx, job->h + i * BN_MAX_LIMBS, job->msgs[i].data, job->msgs[i].len);
+    }
+}
+
+// Each chunk draws its nonces, multiplies them on the pool, then shares
+// one field inversion (the normalization) and one inversion mod n (the
+// k^-1) across the chunk. A nonce that lands on r = 0 or s = 0 is
+// replaced through ecdsa_sign.
+void ecdsa_sign_batch(const ecdsa_ctx *ctx, const limb_t *d, const ecdsa_msg *msgs, size_t count,
+                      ecdsa_sign_sink sink, void *sink_ctx)
+{
+    limb_t *k = malloc(sizeof(limb_t) * BN_MAX_LIMBS * ECDSA_CHUNK);
+    limb_t *kinv = malloc(sizeof(limb_t) * BN_MAX_LIMBS * ECDSA_CHUNK);
+    limb_t *h = malloc(sizeof(limb_t) * BN_MAX_LIMBS * ECDSA_CHUNK);
+    ec_jacobian *points = malloc(sizeof(ec_jacobian) * ECDSA_CHUNK);
+    ec_affine *affine = malloc(sizeof(ec_affine) * ECDSA_CHUNK);
+    limb_t dm[BN_MAX_LIMBS];
+    ecdsa_sig sig;
+
+    mont_to(&ctx->scalar, dm, d);
+    for (size_t base = 0; base < count; base += ECDSA_CHUNK)
+    {
+        size_t chunk = count - base < ECDSA_CHUNK ? count - base : ECDSA_CHUNK;
+        sign_job job = {ctx, msgs + base, k, h, points};
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            random_scalar(ctx, k + i * BN_MAX_LIMBS);
+            mont_to(&ctx->scalar, kinv + i * BN_MAX_LIMBS, k + i * BN_MAX_LIMBS);
+        }
+        parallel_for(NULL, 0, chunk, ECDSA_GRAIN, sign_range, &job, NULL);
+        ec_to_affine_batch(ctx->curve, affine, points, chunk);
+        mont_inv_batch(&ctx->scalar, &ctx->scalar_inv, kinv, kinv, chunk);
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            if (!finish_sig(ctx, &sig, dm, &affine[i], kinv + i * BN_MAX_LIMBS, h + i * BN_MAX_LIMBS))
+            {
+                ecdsa_sign(ctx, &sig, d, msgs[base + i].data, msgs[base + i].len);
+            }
+            sink(base + i, &sig, sink_ctx);
+        }
+    }
+    free(affine);
+    free(points);
+    free(h);
+    free(kinv);
+    free(k);
+}
+
+static void verify_range(size_t begin, size_t end, void *arg)
+{
+    verify_job *job = arg;
+    limb_t h[BN_MAX_LIMBS];
+    for (size_t i = begin; i < end; i++)
+    {
+        if (!job->ok[i])
+        {
+            ec_set_infinity(job->ctx->curve, &job->points[i]);
+            continue;
+        }
+        ecdsa_hash(job->ctx, h, job->msgs[i].data, job->msgs[i].len);
+        verify_point(job->ctx, &job->points[i], job->q, &job->sigs[i], job->w + i * BN_MAX_LIMBS, h);
+    }
+}
+
+// Out-of-range r or s fails without touching the curve; the rest share
+// one inversion mod n for the s^-1 and one normalization per chunk.
+void ecdsa_verify_batch(const ecdsa_ctx *ctx, const ec_affine *q, const ecdsa_msg *msgs, const ecdsa_sig *sigs,
+                        size_t count, ecdsa_verify_sink sink, void *sink_ctx)
+{
+    limb_t *w = malloc(sizeof(limb_t) * BN_MAX_LIMBS * ECDSA_CHUNK);
+    int *ok = malloc(sizeof(int) * ECDSA_CHUNK);
+    ec_jacobian *points = malloc(sizeof(ec_jacobian) * ECDSA_CHUNK);
+    ec_affine *affine = malloc(sizeof(ec_affine) * ECDSA_CHUNK);
+
+    for (size_t base = 0; base < count; base += ECDSA_CHUNK)
+    {
+        size_t chunk = count - base < ECDSA_CHUNK ? count - base : ECDSA_CHUNK;
+        verify_job job = {ctx, q, msgs + base, sigs + base, ok, w, points};
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            const ecdsa_sig *sig = &sigs[base + i];
+            ok[i] = scalar_in_range(ctx, sig->r) && scalar_in_range(ctx, sig->s);
+            if (ok[i])
+            {
+                mont_to(&ctx->scalar, w + i * BN_MAX_LIMBS, sig->s);
+            }
+            else
+            {
+                bn_zero(w + i * BN_MAX_LIMBS, ctx->n);
+            }
+        }
+        mont_inv_batch(&ctx->scalar, &ctx->scalar_inv, w, w, chunk);
+        parallel_for(NULL, 0, chunk, ECDSA_GRAIN, verify_range, &job, NULL);
+        ec_to_affine_batch(ctx->curve, affine, points, chunk);
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            sink(base + i, ok[i] && check_r(ctx, &affine[i], sigs[base + i].r), sink_ctx);
+        }
+    }
+    free(affine);
+    free(points);
+    free(ok);
+    free(w);
+}
+
+// R from r and the hint; returns 0 when there is no hint or it names no
+// point of the order-n subgroup. The hint is the signer's word, and on a
+// curve with a cofactor it can name k G plus a torsion point, which
+// ecdsa_verify rejects but a combination accepts whenever the torsion
+// parts of the batch cancel.
+int ecdsa_recover_point(const ecdsa_ctx *ctx, ec_affine *r, const ecdsa_sig *sig)
+{
+    const ec_curve *curve = ctx->curve;
+    size_t n = curve->n;
+    limb_t x[BN_MAX_LIMBS], y[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+    ec_jacobian check;
+
+    if (sig->recovery < 0)
+    {
+        return 0;
+    }
+    bn_zero(t, n + 1);
+    bn_copy(t, ctx->scalar.m, ctx->n);
+    bn_mul_word(x, t, n + 1, (limb_t)(sig->recovery >> 1));
+    bn_zero(t, n + 1);
+    bn_copy(t, sig->r, ctx->n);
+    bn_add(x, x, t, n + 1);
+    if (x[n] != 0 || bn_cmp(x, curve->p, n) >= 0 || !ec_lift_x(curve, r, x))
+    {
+        return 0;
+    }
+    ec_affine_get(curve, NULL, y, r);
+    if ((int)(y[0] & 1) != (sig->recovery & 1))
+    {
+        ec_affine_neg(curve, r, r);
+    }
+    ec_mul(curve, &check, r, ctx->scalar.m, ctx->n);
+    return ec_is_infinity(curve, &check);
+}
+
+static void combine_prepare_range(size_t begin, size_t end, void *arg)
+{
+    combine_job *job = arg;
+    const ecdsa_ctx *ctx = job->ctx;
+    limb_t h[BN_MAX_LIMBS];
+    ec_jacobian p;
+    ec_affine point;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const ecdsa_sig *sig = &job->sigs[i];
+        limb_t *w = job->w + i * BN_MAX_LIMBS;
+        if (job->valid[i] >= 0)
+        {
+            job->rs[i].infinity = 1;
+            continue;
+        }
+        ecdsa_hash(ctx, h, job->msgs[i].data, job->msgs[i].len);
+        if (!ecdsa_recover_point(ctx, &job->rs[i], sig))
+        {
+            // Without R the signature cannot join a combination.
+            verify_point(ctx, &p, job->q, sig, w, h);
+            ec_to_affine(ctx->curve, &point, &p);
+            job->valid[i] = check_r(ctx, &point, sig->r);
+            job->rs[i].infinity = 1;
+            continue;
+        }
+        mont_mul(&ctx->scalar, job->u2 + i * BN_MAX_LIMBS, w, sig->r);
+        mont_mul(&ctx->scalar, w, w, h);
+        mont_to(&ctx->scalar, job->zm + i * BN_MAX_LIMBS, job->z + i * BN_MAX_LIMBS);
+    }
+}
+
+// Whether sum z_i (u1_i G + u2_i Q - R_i) = 0 over the pending items of
+// [begin, end).
+static int combination_holds(const combine_job *job, size_t begin, size_t end)
+{
+    const ecdsa_ctx *ctx = job->ctx;
+    const mont_ctx *sc = &ctx->scalar;
+    limb_t a[BN_MAX_LIMBS], b[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+    ec_jacobian lhs, rhs;
+
+    bn_zero(a, ctx->n);
+    bn_zero(b, ctx->n);
+    for (size_t i = begin; i < end; i++)
+    {
+        if (job->valid[i] < 0)
+        {
+            mont_mul(sc, t, job->zm + i * BN_MAX_LIMBS, job->w + i * BN_MAX_LIMBS);
+            mont_add(sc, a, a, t);
+            mont_mul(sc, t, job->zm + i * BN_MAX_LIMBS, job->u2 + i * BN_MAX_LIMBS);
+            mont_add(sc, b, b, t);
+        }
+    }
+    ec_mul_double(ctx->curve, &lhs, &ctx->curve->base, a, job->q, b, ctx->n);
+    ec_msm(ctx->curve, &rhs, job->rs + begin, job->z + begin * BN_MAX_LIMBS, 1, end - begin);
+    return ec_equal(ctx->curve, &lhs, &rhs);
+}
+
+static void settle(combine_job *job, size_t begin, size_t end, int valid)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        if (job->valid[i] < 0)
+        {
+            job->valid[i] = valid;
+        }
+    }
+}
+
+// known_bad skips the check when the caller already knows the range
+// fails: the right half of a failing range whose left half held.
+static void bisect(combine_job *job, size_t begin, size_t end, int known_bad)
+{
+    const ecdsa_ctx *ctx = job->ctx;
+
+    if (!known_bad && combination_holds(job, begin, end))
+    {
+        settle(job, begin, end, 1);
+        return;
+    }
+    if (end - begin <= ECDSA_BISECT_LEAF)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (job->valid[i] < 0)
+            {
+                ec_jacobian p;
+                ec_affine point;
+                const limb_t *u1 = job->w + i * BN_MAX_LIMBS, *u2 = job->u2 + i * BN_MAX_LIMBS;
+                ec_mul_double(ctx->curve, &p, &ctx->curve->base, u1, job->q, u2, ctx->n);
+                ec_to_affine(ctx->curve, &point, &p);
+                job->valid[i] = check_r(ctx, &point, job->sigs[i].r);
+            }
+        }
+        return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    int left = combination_holds(job, begin, mid);
+    if (left)
+    {
+        settle(job, begin, mid, 1);
+    }
+    else
+    {
+        bisect(job, begin, mid, 1);
+    }
+    bisect(job, mid, end, left);
+}
+
+// Retries only on EINTR; returns 0 if getrandom fails otherwise.
+static int random_words(uint64_t *words, size_t count)
+{
+    for (size_t got = 0; got < count * sizeof(uint64_t);)
+    {
+        ssize_t r = getrandom((unsigned char *)words + got, count * sizeof(uint64_t) - got, 0);
+        if (r < 0 && errno != EINTR)
+        {
+            return 0;
+        }
+        got += r > 0 ? (size_t)r : 0;
+    }
+    return 1;
+}
+
+// valid[i] gets 1 or 0 for each signature; returns the number valid, or
+// 0 with every valid[i] 0 when no random weights could be drawn.
+// Each chunk of ECDSA_COMBINE_CHUNK gets its own z and its own check, so
+// one bad signature costs a bisection of its chunk only.
+size_t ecdsa_verify_batch_random(const ecdsa_ctx *ctx, const ec_affine *q, const ecdsa_msg *msgs,
+                                 const ecdsa_sig *sigs, size_t count, int *valid)
+{
+    size_t slots = count < ECDSA_COMBINE_CHUNK ? count : ECDSA_COMBINE_CHUNK, total = 0;
+    uint64_t *random = malloc(sizeof(uint64_t) * slots);
+    combine_job job = {ctx, q, NULL, NULL, malloc(sizeof(limb_t) * BN_MAX_LIMBS * slots),
+                       malloc(sizeof(limb_t) * BN_MAX_LIMBS * slots), calloc(slots * BN_MAX_LIMBS, sizeof(limb_t)),
+                       malloc(sizeof(limb_t) * BN_MAX_LIMBS * slots), malloc(sizeof(ec_affine) * slots), NULL};
+
+    for (size_t base = 0; base < count; base += ECDSA_COMBINE_CHUNK)
+    {
+        size_t chunk = count - base < ECDSA_COMBINE_CHUNK ? count - base : ECDSA_COMBINE_CHUNK;
+        job.msgs = msgs + base;
+        job.sigs = sigs + base;
+        job.valid = valid + base;
+
+        if (!random_words(random, chunk))
+        {
+            // No randomness, no combination: nothing is accepted.
+            for (size_t i = 0; i < count; i++)
+            {
+                valid[i] = 0;
+            }
+            total = 0;
+            break;
+        }
+        for (size_t i = 0; i < chunk; i++)
+        {
+            const ecdsa_sig *sig = &job.sigs[i];
+            limb_t *w = job.w + i * BN_MAX_LIMBS;
+            job.z[i * BN_MAX_LIMBS] = (random[i] >> (64 - ECDSA_BATCH_Z_BITS)) | 1;
+            job.valid[i] = scalar_in_range(ctx, sig->r) && scalar_in_range(ctx, sig->s) ? -1 : 0;
+            if (job.valid[i] < 0)
+            {
+                mont_to(&ctx->scalar, w, sig->s);
+            }
+            else
+            {
+                bn_zero(w, ctx->n);
+            }
+        }
+        mont_inv_batch(&ctx->scalar, &ctx->scalar_inv, job.w, job.w, chunk);
+        parallel_for(NULL, 0, chunk, ECDSA_GRAIN, combine_prepare_range, &job, NULL);
+        bisect(&job, 0, chunk, 0);
+        for (size_t i = 0; i < chunk; i++)
+        {
+            total += (size_t)job.valid[i];
+        }
+    }
+    free(job.rs);
+    free(job.zm);
+    free(job.z);
+    free(job.u2);
+    free(job.w);
+    free(random);
+    return total;
+}
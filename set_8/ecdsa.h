@@ -0,0 +1,95 @@
+#ifndef ECDSA_ /* Include guard */
+#define ECDSA_
+
+#include "ec.h"
+#include "modinv.h"
+
+// ECDSA over the base point of an ec_curve, whose order n must be prime.
+// Scalars mod n are plain limb arrays of order_n limbs, and H(m) is
+// SHA-256 truncated to the bit length of n. Signing takes k G from a
+// Lim-Lee comb of affine multiples of G, spacing doublings and as many
+// mixed additions; verification gets u1 G + u2 Q from one Straus-Shamir
+// pass. A context belongs to one base point, so a key with its own
+// generator (as in duplicate-signature key selection) gets its own
+// curve copy and context.
+//
+// The batch forms go through their input ECDSA_CHUNK items at a time:
+// the scalar multiplications of a chunk run on the shared pool, the
+// inversions mod n and the point normalizations are batched across it,
+// and the results reach the sink in input order, on the calling thread,
+// before the next chunk starts.
+//
+// ecdsa_verify_batch_random checks a whole chunk at once: with R_i
+// recovered from r_i and the recovery hint, and random odd z_i,
+//
+//     (sum z_i u1_i) G + (sum z_i u2_i) Q = sum z_i R_i
+//
+// holds for every valid batch and for an invalid one only with
+// probability about 2^-ECDSA_BATCH_Z_BITS, provided every R_i lies in
+// the subgroup of order n: torsion parts would cancel whenever the
+// weights on them sum to a multiple of their order. A hint that names a
+// point outside it sends its signature to individual verification. The
+// left side is one Straus-Shamir pass and the right one multi-scalar
+// multiplication with short scalars. A failing range is halved until
+// the culprits are isolated, and ranges of ECDSA_BISECT_LEAF or fewer
+// are verified one by one.
+
+#define ECDSA_COMB_TEETH 8
+#define ECDSA_CHUNK 256
+#define ECDSA_COMBINE_CHUNK 4096
+#define ECDSA_BATCH_Z_BITS 64
+#define ECDSA_BISECT_LEAF 4
+
+typedef struct
+{
+    limb_t r[BN_MAX_LIMBS];
+    limb_t s[BN_MAX_LIMBS];
+    int recovery; // x(R) = r + (recovery >> 1) n, y(R) odd iff recovery & 1; -1 if unknown
+} ecdsa_sig;
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t len;
+} ecdsa_msg;
+
+typedef struct
+{
+    const ec_curve *curve;
+    size_t n; // limbs of a scalar
+    mont_ctx scalar;
+    mont_inv_ctx scalar_inv;
+    size_t spacing;
+    ec_affine *comb; // 2^ECDSA_COMB_TEETH sums of 2^(j * spacing) G
+} ecdsa_ctx;
+
+typedef void (*ecdsa_sign_sink)(size_t index, const ecdsa_sig *sig, void *ctx);
+
+typedef void (*ecdsa_verify_sink)(size_t index, int valid, void *ctx);
+
+void ecdsa_init(ecdsa_ctx *ctx, const ec_curve *curve);
+
+void ecdsa_free(ecdsa_ctx *ctx);
+
+void ecdsa_hash(const ecdsa_ctx *ctx, limb_t *h, const unsigned char *msg, size_t len);
+
+void ecdsa_base_mul(const ecdsa_ctx *ctx, ec_jacobian *r, const limb_t *k);
+
+void ecdsa_keypair(const ecdsa_ctx *ctx, limb_t *d, ec_affine *q);
+
+void ecdsa_sign(const ecdsa_ctx *ctx, ecdsa_sig *sig, const limb_t *d, const unsigned char *msg, size_t len);
+
+int ecdsa_verify(const ecdsa_ctx *ctx, const ecdsa_sig *sig, const ec_affine *q, const unsigned char *msg, size_t len);
+
+void ecdsa_sign_batch(const ecdsa_ctx *ctx, const limb_t *d, const ecdsa_msg *msgs, size_t count,
+                      ecdsa_sign_sink sink, void *sink_ctx);
+
+void ecdsa_verify_batch(const ecdsa_ctx *ctx, const ec_affine *q, const ecdsa_msg *msgs, const ecdsa_sig *sigs,
+                        size_t count, ecdsa_verify_sink sink, void *sink_ctx);
+
+int ecdsa_recover_point(const ecdsa_ctx *ctx, ec_affine *r, const ecdsa_sig *sig);
+
+size_t ecdsa_verify_batch_random(const ecdsa_ctx *ctx, const ec_affine *q, const ecdsa_msg *msgs,
+                                 const ecdsa_sig *sigs, size_t count, int *valid);
+
+#endif // ECDSA_
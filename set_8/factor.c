@@ -0,0 +1,606 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "factor.h"
+#include "modexp.h"
+
+#define WHEEL 30
+#define WHEEL_SLOTS 8
+#define MILLER_RABIN_ROUNDS 24
+#define RHO_BATCH 128
+#define ECM_POLL 256
+#define ECM_STAGE2_WIDTH 2310 // 2*3*5*7*11
+
+typedef struct
+{
+    limb_t x[BN_MAX_LIMBS];
+    limb_t z[BN_MAX_LIMBS];
+} xz_point;
+
+typedef struct
+{
+    const mont_ctx *ctx;
+    limb_t a24n[BN_MAX_LIMBS];
+    limb_t a24d[BN_MAX_LIMBS];
+} ecm_curve;
+
+typedef struct
+{
+    const limb_t *N;
+    size_t n;
+    const factor_params *params;
+    pthread_mutex_t lock;
+    int found;
+    limb_t divisor[BN_MAX_LIMBS];
+    cancel_token cancel;
+} split_job;
+
+static const uint32_t wheel[WHEEL_SLOTS] = {1, 7, 11, 13, 17, 19, 23, 29};
+static const int8_t wheel_slot[WHEEL] = {-1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1,
+                                         -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7};
+static const limb_t small_primes[MILLER_RABIN_ROUNDS] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37,
+                                                         41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89};
+
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t *table;
+static size_t table_count;
+static uint32_t table_limit;
+
+static uint64_t wheel_value(size_t slot)
+{
+    return (uint64_t)WHEEL * (slot / WHEEL_SLOTS) + wheel[slot % WHEEL_SLOTS];
+}
+
+// Sieve over the mod-30 wheel, which only stores the 8 residues coprime to
+// 30. Tables only grow, and superseded ones are kept so pointers handed
+// out earlier stay valid.
+const uint32_t *prime_table(uint32_t limit, size_t *count)
+{
+    pthread_mutex_lock(&table_lock);
+    if (limit > table_limit)
+    {
+        size_t slots = ((size_t)limit / WHEEL + 1) * WHEEL_SLOTS;
+        unsigned char *composite = calloc(slots, 1);
+        uint32_t *primes = malloc(sizeof(uint32_t) * (slots + 3));
+        size_t found = 0;
+
+        for (size_t i = 1; i < slots; i++)
+        {
+            uint64_t p = wheel_value(i);
+            if (p * p > limit)
+            {
+                break;
+            }
+            if (composite[i])
+            {
+                continue;
+            }
+            for (size_t j = i; j < slots; j++)
+            {
+                uint64_t m = p * wheel_value(j);
+                if (m > limit)
+                {
+                    break;
+                }
+                composite[m / WHEEL * WHEEL_SLOTS + wheel_slot[m % WHEEL]] = 1;
+            }
+        }
+
+        const uint32_t base[3] = {2, 3, 5};
+        for (int i = 0; i < 3; i++)
+        {
+            if (base[i] <= limit)
+            {
+                primes[found++] = base[i];
+            }
+        }
+        for (size_t i = 1; i < slots && wheel_value(i) <= limit; i++)
+        {
+            if (!composite[i])
+            {
+                primes[found++] = (uint32_t)wheel_value(i);
+            }
+        }
+        free(composite);
+
+        table = primes;
+        table_count = found;
+        table_limit = limit;
+    }
+
+    const uint32_t *primes = table;
+    size_t upto = table_count;
+    while (upto > 0 && primes[upto - 1] > limit)
+    {
+        upto--;
+    }
+    pthread_mutex_unlock(&table_lock);
+    *count = upto;
+    return primes;
+}
+
+// Miller-Rabin with the first `rounds` primes as bases.
+int bn_is_probable_prime(const limb_t *a, size_t n, int rounds)
+{
+    if (bn_cmp_word(a, n, 3) <= 0)
+    {
+        return bn_cmp_word(a, n, 1) > 0;
+    }
+    if ((a[0] & 1) == 0)
+    {
+        return 0;
+    }
+    for (int i = 1; i < MILLER_RABIN_ROUNDS; i++)
+    {
+        if (bn_cmp_word(a, n, small_primes[i]) == 0)
+        {
+            return 1;
+        }
+        if (bn_mod_word(a, n, small_primes[i]) == 0)
+        {
+            return 0;
+        }
+    }
+
+    mont_ctx ctx;
+    limb_t d[BN_MAX_LIMBS], minus_one[BN_MAX_LIMBS], x[BN_MAX_LIMBS];
+    size_t s = 0;
+    mont_init(&ctx, a, n);
+    bn_sub_word(d, a, n, 1);
+    while (!bn_bit(d, s))
+    {
+        s++;
+    }
+    bn_shr(d, d, n, s);
+    mont_neg(&ctx, minus_one, ctx.one);
+
+    rounds = rounds < MILLER_RABIN_ROUNDS ? rounds : MILLER_RABIN_ROUNDS;
+    for (int i = 0; i < rounds; i++)
+    {
+        limb_t base[BN_MAX_LIMBS];
+        bn_set_word(base, n, small_primes[i]);
+        mont_to(&ctx, base, base);
+        mont_exp(&ctx, x, base, d, n);
+        if (bn_cmp(x, ctx.one, n) == 0 || bn_cmp(x, minus_one, n) == 0)
+        {
+            continue;
+        }
+        size_t r = 1;
+        for (; r < s; r++)
+        {
+            mont_sqr(&ctx, x, x);
+            if (bn_cmp(x, minus_one, n) == 0)
+            {
+                break;
+            }
+        }
+        if (r == s)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int nontrivial_gcd(limb_t *d, const limb_t *a, const limb_t *N, size_t n)
+{
+    bn_gcd(d, a, N, n);
+    return bn_cmp_word(d, n, 1) != 0 && bn_cmp(d, N, n) != 0;
+}
+
+// Pollard rho with Brent's cycle detection; the |x - y| terms are
+// multiplied together RHO_BATCH at a time so only one gcd is paid per
+// batch. Arithmetic stays in Montgomery form: R is a unit mod N, so the
+// gcds are unaffected.
+int factor_pollard_brent(limb_t *d, const limb_t *N, size_t n, limb_t c, uint64_t iterations,
+                         const cancel_token *cancel)
+{
+    mont_ctx ctx;
+    limb_t y[BN_MAX_LIMBS], x[BN_MAX_LIMBS], ys[BN_MAX_LIMBS], q[BN_MAX_LIMBS];
+    limb_t cm[BN_MAX_LIMBS], diff[BN_MAX_LIMBS], g[BN_MAX_LIMBS];
+
+    mont_init(&ctx, N, n);
+    bn_set_word(cm, n, c);
+    mont_to(&ctx, cm, cm);
+    bn_set_word(y, n, 2);
+    mont_to(&ctx, y, y);
+    bn_copy(q, ctx.one, n);
+    bn_set_word(g, n, 1);
+
+    uint64_t done = 0;
+    for (uint64_t r = 1; bn_cmp_word(g, n, 1) == 0; r *= 2)
+    {
+        bn_copy(x, y, n);
+        for (uint64_t i = 0; i < r; i++)
+        {
+            mont_sqr(&ctx, y, y);
+            mont_add(&ctx, y, y, cm);
+        }
+        for (uint64_t k = 0; k < r && bn_cmp_word(g, n, 1) == 0; k += RHO_BATCH)
+        {
+            if (done > iterations || cancel_requested(cancel))
+            {
+                return 0;
+            }
+            bn_copy(ys, y, n);
+            for (uint64_t i = 0; i < RHO_BATCH && i < r - k; i++)
+            {
+                mont_sqr(&ctx, y, y);
+                mont_add(&ctx, y, y, cm);
+                mont_sub(&ctx, diff, x, y);
+                mont_mul(&ctx, q, q, diff);
+            }
+            done += RHO_BATCH;
+            bn_gcd(g, q, N, n);
+        }
+    }
+
+    // The batch overshot into a product that is 0 mod N: replay it one
+    // step at a time from the saved point.
+    if (bn_cmp(g, N, n) == 0)
+    {
+        do
+        {
+            mont_sqr(&ctx, ys, ys);
+            mont_add(&ctx, ys, ys, cm);
+            mont_sub(&ctx, diff, x, ys);
+            bn_gcd(g, diff, N, n);
+        } while (bn_cmp_word(g, n, 1) == 0);
+    }
+    if (bn_cmp(g, N, n) == 0)
+    {
+        return 0;
+    }
+    bn_copy(d, g, n);
+    return 1;
+}
+
+static void mont_word(const mont_ctx *ctx, limb_t *r, limb_t w)
+{
+    bn_set_word(r, ctx->n, w);
+    mont_to(ctx, r, r);
+}
+
+// x-only doubling with (A + 2) / 4 kept as the fraction a24n / a24d, so
+// building a curve needs no inversion mod N.
+static void xz_dbl(const ecm_curve *curve, xz_point *r, const xz_point *p)
+{
+    const mont_ctx *ctx = curve->ctx;
+    limb_t t1[BN_MAX_LIMBS], t2[BN_MAX_LIMBS], t3[BN_MAX_LIMBS], t4[BN_MAX_LIMBS];
+    mont_add(ctx, t1, p->x, p->z);
+    mont_sqr(ctx, t1, t1);
+    mont_sub(ctx, t2, p->x, p->z);
+    mont_sqr(ctx, t2, t2);
+    mont_sub(ctx, t3, t1, t2);
+    mont_mul(ctx, r->x, t1, t2);
+    mont_mul(ctx, r->x, r->x, curve->a24d);
+    mont_mul(ctx, t4, curve->a24d, t2);
+    mont_mul(ctx, t1, curve->a24n, t3);
+    mont_add(ctx, t4, t4, t1);
+    mont_mul(ctx, r->z, t3, t4);
+}
+
+// r = p + q given d = p - q.
+static void xz_add(const mont_ctx *ctx, xz_point *r, const xz_point *p, const xz_point *q, const xz_point *d)
+{
+    limb_t u[BN_MAX_LIMBS], v[BN_MAX_LIMBS], t[BN_MAX_LIMBS], dx[BN_MAX_LIMBS];
+    bn_copy(dx, d->x, ctx->n);
+    mont_sub(ctx, u, p->x, p->z);
+    mont_add(ctx, t, q->x, q->z);
+    mont_mul(ctx, u, u, t);
+    mont_add(ctx, v, p->x, p->z);
+    mont_sub(ctx, t, q->x, q->z);
+    mont_mul(ctx, v, v, t);
+    mont_add(ctx, t, u, v);
+    mont_sqr(ctx, t, t);
+    mont_sub(ctx, u, u, v);
+    mont_sqr(ctx, u, u);
+    mont_mul(ctx, r->x, d->z, t);
+    mont_mul(ctx, r->z, dx, u);
+}
+
+static void xz_ladder(const ecm_curve *curve, xz_point *r, const xz_point *p, uint64_t k)
+{
+    xz_point r0 = *p, r1, base = *p;
+    xz_dbl(curve, &r1, p);
+    for (int i = 62 - __builtin_clzll(k); i >= 0; i--)
+    {
+        if ((k >> i) & 1)
+        {
+            xz_add(curve->ctx, &r0, &r1, &r0, &base);
+            xz_dbl(curve, &r1, &r1);
+        }
+        else
+        {
+            xz_add(curve->ctx, &r1, &r1, &r0, &base);
+            xz_dbl(curve, &r0, &r0);
+        }
+    }
+    *r = r0;
+}
+
+// Lenstra ECM on a Suyama-parametrized Montgomery curve. Stage 1 multiplies
+// by every prime power up to b1; stage 2 covers one more prime up to b2 with
+// a baby-step giant-step pairing: p = m*w +- j, and x([m w]Q) = x([j]Q)
+// exactly when the order divides one of m*w +- j.
+int factor_ecm_curve(limb_t *d, const limb_t *N, size_t n, limb_t sigma, uint64_t b1, uint64_t b2,
+                     const cancel_token *cancel)
+{
+    mont_ctx ctx;
+    ecm_curve curve;
+    xz_point q;
+    limb_t s[BN_MAX_LIMBS], u[BN_MAX_LIMBS], v[BN_MAX_LIMBS], t[BN_MAX_LIMBS], w[BN_MAX_LIMBS];
+    limb_t acc[BN_MAX_LIMBS];
+
+    mont_init(&ctx, N, n);
+    curve.ctx = &ctx;
+
+    // u = sigma^2 - 5, v = 4 sigma, Q = (u^3 : v^3),
+    // (A + 2) / 4 = (v - u)^3 (3u + v) / (16 u^3 v).
+    mont_word(&ctx, s, sigma);
+    mont_word(&ctx, t, 5);
+    mont_sqr(&ctx, u, s);
+    mont_sub(&ctx, u, u, t);
+    mont_word(&ctx, t, 4);
+    mont_mul(&ctx, v, s, t);
+    mont_sqr(&ctx, q.x, u);
+    mont_mul(&ctx, q.x, q.x, u);
+    mont_sqr(&ctx, q.z, v);
+    mont_mul(&ctx, q.z, q.z, v);
+    mont_sub(&ctx, t, v, u);
+    mont_sqr(&ctx, curve.a24n, t);
+    mont_mul(&ctx, curve.a24n, curve.a24n, t);
+    mont_word(&ctx, w, 3);
+    mont_mul(&ctx, t, w, u);
+    mont_add(&ctx, t, t, v);
+    mont_mul(&ctx, curve.a24n, curve.a24n, t);
+    mont_word(&ctx, w, 16);
+    mont_mul(&ctx, curve.a24d, q.x, v);
+    mont_mul(&ctx, curve.a24d, curve.a24d, w);
+
+    size_t count;
+    const uint32_t *primes = prime_table((uint32_t)(b2 > b1 ? b2 : b1), &count);
+    size_t i = 0;
+    for (; i < count && primes[i] <= b1; i++)
+    {
+        if (i % ECM_POLL == 0 && cancel_requested(cancel))
+        {
+            return 0;
+        }
+        uint64_t pe = primes[i];
+        while (pe * primes[i] <= b1)
+        {
+            pe *= primes[i];
+        }
+        xz_ladder(&curve, &q, &q, pe);
+    }
+    if (nontrivial_gcd(d, q.z, N, n))
+    {
+        return 1;
+    }
+    if (b2 <= b1 || bn_is_zero(q.z, n))
+    {
+        return 0;
+    }
+
+    // Baby steps: x([j]Q) for odd j <= w/2, via [j + 2]Q = [j]Q + [2]Q.
+    const uint64_t width = ECM_STAGE2_WIDTH;
+    size_t babies = width / 4 + 1;
+    xz_point *baby = malloc(sizeof(xz_point) * babies);
+    xz_point q2;
+    baby[0] = q;
+    xz_dbl(&curve, &q2, &q);
+    xz_add(&ctx, &baby[1], &q2, &q, &q);
+    for (size_t j = 2; j < babies; j++)
+    {
+        xz_add(&ctx, &baby[j], &baby[j - 1], &q2, &baby[j - 2]);
+    }
+
+    // Giant steps: [m w]Q, with [(m + 1) w]Q = [m w]Q + [w]Q.
+    uint64_t m = b1 / width > 2 ? b1 / width : 2;
+    xz_point step, giant, prev, next;
+    xz_ladder(&curve, &step, &q, width);
+    xz_ladder(&curve, &giant, &q, m * width);
+    xz_ladder(&curve, &prev, &q, (m - 1) * width);
+    bn_copy(acc, ctx.one, n);
+
+    while (i < count && primes[i] <= b2)
+    {
+        if (cancel_requested(cancel))
+        {
+            free(baby);
+            return 0;
+        }
+        uint64_t centre = m * width;
+        for (; i < count && primes[i] <= b2 && primes[i] <= centre + width / 2; i++)
+        {
+            uint64_t p = primes[i];
+            uint64_t j = p > centre ? p - centre : centre - p;
+            const xz_point *b = &baby[j / 2];
+            mont_mul(&ctx, u, giant.x, b->z);
+            mont_mul(&ctx, v, b->x, giant.z);
+            mont_sub(&ctx, u, u, v);
+            mont_mul(&ctx, acc, acc, u);
+        }
+        xz_add(&ctx, &next, &giant, &step, &prev);
+        prev = giant;
+        giant = next;
+        m++;
+    }
+    free(baby);
+    return nontrivial_gcd(d, acc, N, n);
+}
+
+void factor_params_default(factor_params *params)
+{
+    params->trial_bound = 1 << 16;
+    params->smooth_bound = 0;
+    params->rho_iterations = 1 << 22;
+    params->ecm_curves = 64;
+    params->ecm_b1 = 11000;
+    params->ecm_b2 = 1100000;
+}
+
+// Attempt 0 runs rho, the rest run one ECM curve each, all on the pool;
+// the first nontrivial divisor wins and cancels the others.
+static void run_split_attempts(size_t begin, size_t end, void *ctx)
+{
+    split_job *job = ctx;
+    for (size_t a = begin; a < end; a++)
+    {
+        limb_t d[BN_MAX_LIMBS];
+        int ok = a == 0 ? factor_pollard_brent(d, job->N, job->n, 1, job->params->rho_iterations, &job->cancel)
+                        : factor_ecm_curve(d, job->N, job->n, 6 + a, job->params->ecm_b1, job->params->ecm_b2,
+                                           &job->cancel);
+        if (ok)
+        {
+            pthread_mutex_lock(&job->lock);
+            if (!job->found)
+            {
+                job->found = 1;
+                bn_copy(job->divisor, d, job->n);
+            }
+            pthread_mutex_unlock(&job->lock);
+            cancel_request(&job->cancel);
+            return;
+        }
+    }
+}
+
+static size_t significant_limbs(const limb_t *a, size_t n)
+{
+    while (n > 1 && a[n - 1] == 0)
+    {
+        n--;
+    }
+    return n;
+}
+
+// Splitting runs at the divisor's own width rather than the caller's, so
+// small composites left after a split get correspondingly cheap arithmetic.
+static int split(limb_t *d, const limb_t *N, size_t n, const factor_params *params)
+{
+    split_job job;
+    job.N = N;
+    job.n = significant_limbs(N, n);
+    job.params = params;
+    job.found = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    cancel_token_init(&job.cancel);
+
+    parallel_for(thread_pool_shared(), 0, 1 + (size_t)params->ecm_curves, 1, run_split_attempts, &job, &job.cancel);
+    pthread_mutex_destroy(&job.lock);
+    if (job.found)
+    {
+        bn_zero(d, n);
+        bn_copy(d, job.divisor, job.n);
+    }
+    return job.found;
+}
+
+// Divides every copy of p out of remaining and records it.
+static void record_prime(factor_list *out, limb_t *remaining, const limb_t *p, const factor_params *params)
+{
+    size_t n = out->n;
+    if (params->smooth_bound != 0 && bn_cmp_word(p, n, params->smooth_bound) > 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < out->count; i++)
+    {
+        if (bn_cmp(out->factors[i].value, p, n) == 0)
+        {
+            return;
+        }
+    }
+    if (out->count == FACTOR_MAX)
+    {
+        return;
+    }
+
+    prime_factor *f = &out->factors[out->count++];
+    limb_t q[BN_MAX_LIMBS], r[BN_MAX_LIMBS];
+    bn_zero(f->value, BN_MAX_LIMBS);
+    bn_copy(f->value, p, n);
+    f->multiplicity = 0;
+    for (;;)
+    {
+        bn_divmod(q, r, remaining, n, p, n);
+        if (!bn_is_zero(r, n))
+        {
+            break;
+        }
+        bn_copy(remaining, q, n);
+        f->multiplicity++;
+    }
+}
+
+static void collect(factor_list *out, limb_t *remaining, const limb_t *x, const factor_params *params)
+{
+    size_t n = out->n;
+    limb_t d[BN_MAX_LIMBS], q[BN_MAX_LIMBS];
+    if (bn_cmp_word(x, n, 1) <= 0)
+    {
+        return;
+    }
+    if (bn_is_probable_prime(x, significant_limbs(x, n), MILLER_RABIN_ROUNDS))
+    {
+        record_prime(out, remaining, x, params);
+        return;
+    }
+    if (split(d, x, n, params))
+    {
+        bn_divmod(q, NULL, x, n, d, n);
+        collect(out, remaining, d, params);
+        collect(out, remaining, q, params);
+    }
+}
+
+void factor(factor_list *out, const limb_t *N, size_t n, const factor_params *params)
+{
+    factor_params defaults;
+    if (params == NULL)
+    {
+        factor_params_default(&defaults);
+        params = &defaults;
+    }
+
+    limb_t remaining[BN_MAX_LIMBS];
+    out->n = n;
+    out->count = 0;
+    bn_copy(remaining, N, n);
+
+    // Batched trial division: one multi-limb division by a product of
+    // primes that fits in a limb, then cheap word remainders per prime.
+    size_t count;
+    const uint32_t *primes = prime_table(params->trial_bound, &count);
+    for (size_t i = 0; i < count && bn_cmp_word(remaining, n, 1) > 0;)
+    {
+        limb_t product = 1;
+        size_t first = i;
+        while (i < count && product <= UINT64_MAX / primes[i])
+        {
+            product *= primes[i++];
+        }
+        limb_t rem = bn_mod_word(remaining, n, product);
+        for (size_t k = first; k < i; k++)
+        {
+            if (rem % primes[k] == 0)
+            {
+                limb_t p[BN_MAX_LIMBS];
+                bn_set_word(p, n, primes[k]);
+                record_prime(out, remaining, p, params);
+            }
+        }
+    }
+
+    int trial_covers_bound = params->smooth_bound != 0 && params->trial_bound >= params->smooth_bound;
+    if (!trial_covers_bound && bn_cmp_word(remaining, n, 1) > 0)
+    {
+        limb_t rest[BN_MAX_LIMBS];
+        bn_copy(rest, remaining, n);
+        collect(out, remaining, rest, params);
+    }
+
+    bn_zero(out->cofactor, BN_MAX_LIMBS);
+    bn_copy(out->cofactor, remaining, n);
+}
@@ -0,0 +1,54 @@
+#ifndef FACTOR_ /* Include guard */
+#define FACTOR_
+
+#include <stdint.h>
+#include "bignum.h"
+#include "../common/thread_pool.h"
+
+#define FACTOR_MAX 64
+
+typedef struct
+{
+    limb_t value[BN_MAX_LIMBS];
+    unsigned multiplicity;
+} prime_factor;
+
+// Prime factors in the order found, and whatever could not be split (or
+// lies above the smoothness bound) left in cofactor; cofactor is 1 when
+// the factorization is complete.
+typedef struct
+{
+    size_t n;
+    size_t count;
+    prime_factor factors[FACTOR_MAX];
+    limb_t cofactor[BN_MAX_LIMBS];
+} factor_list;
+
+// Trial division covers primes below trial_bound. If smooth_bound is
+// nonzero, larger primes are not reported, and rho/ECM are skipped
+// entirely when trial division already reaches the bound.
+typedef struct
+{
+    uint32_t trial_bound;
+    limb_t smooth_bound;
+    uint64_t rho_iterations;
+    unsigned ecm_curves;
+    uint64_t ecm_b1;
+    uint64_t ecm_b2;
+} factor_params;
+
+const uint32_t *prime_table(uint32_t limit, size_t *count);
+
+int bn_is_probable_prime(const limb_t *a, size_t n, int rounds);
+
+int factor_pollard_brent(limb_t *d, const limb_t *N, size_t n, limb_t c, uint64_t iterations,
+                         const cancel_token *cancel);
+
+int factor_ecm_curve(limb_t *d, const limb_t *N, size_t n, limb_t sigma, uint64_t b1, uint64_t b2,
+                     const cancel_token *cancel);
+
+void factor_params_default(factor_params *params);
+
+void factor(factor_list *out, const limb_t *N, size_t n, const factor_params *params);
+
+#endif // FACTOR_
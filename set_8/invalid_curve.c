@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <string.h>
+#include "factor.h"
+#include "invalid_curve.h"
+#include "../common/thread_pool.h"
+
+typedef struct
+{
+    size_t curve;
+    limb_t order;
+} harvest_task;
+
+typedef struct
+{
+    const ec_curve *curves;
+    const harvest_task *tasks;
+    const limb_t *target_order;
+    ec_mac_oracle oracle;
+    void *oracle_ctx;
+    const unsigned char *msg;
+    size_t len;
+    point_cache *cache;
+    crt_ctx *crt;
+} attack_job;
+
+void point_cache_init(point_cache *cache)
+{
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+}
+
+void point_cache_free(point_cache *cache)
+{
+    free(cache->entries);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+static void point_cache_insert(point_cache *cache, size_t curve, limb_t r, const ec_affine *point)
+{
+    pthread_mutex_lock(&cache->lock);
+    if (cache->count == cache->capacity)
+    {
+        cache->capacity = cache->capacity ? 2 * cache->capacity : 16;
+        cache->entries = realloc(cache->entries, sizeof(small_order_point) * cache->capacity);
+    }
+    small_order_point *entry = &cache->entries[cache->count++];
+    entry->curve = curve;
+    entry->order = r;
+    entry->point = *point;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int point_cache_find(point_cache *cache, size_t curve, limb_t r, ec_affine *point)
+{
+    int found = 0;
+    pthread_mutex_lock(&cache->lock);
+    for (size_t i = 0; i < cache->count && !found; i++)
+    {
+        if (cache->entries[i].curve == curve && cache->entries[i].order == r)
+        {
+            *point = cache->entries[i].point;
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return found;
+}
+
+// Random x until x^3 + a x + b is a square, then multiply by the part of
+// the curve order prime to r. A batch of candidates shares one
+// residuosity screen and one normalization; a survivor has order r^j and
+// is multiplied by r until one more step would reach the identity, which
+// also copes with a non-cyclic r-part. Returns 0 if r does not divide the curve order.
+int ec_small_order_point(const ec_curve *curve, ec_affine *point, limb_t r)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t cofactor[BN_MAX_LIMBS], x[BN_MAX_LIMBS], rr[BN_MAX_LIMBS];
+    limb_t xs[INVALID_CURVE_BATCH][BN_MAX_LIMBS], rhs[INVALID_CURVE_BATCH][BN_MAX_LIMBS];
+    int square[INVALID_CURVE_BATCH];
+    ec_affine candidates[INVALID_CURVE_BATCH];
+    ec_jacobian multiples[INVALID_CURVE_BATCH], next;
+
+    if (bn_mod_word(curve->order, curve->order_n, r) != 0)
+    {
+        return 0;
+    }
+    bn_copy(cofactor, curve->order, curve->order_n);
+    while (bn_mod_word(cofactor, curve->order_n, r) == 0)
+    {
+        bn_div_word(cofactor, cofactor, curve->order_n, r);
+    }
+    bn_set_word(rr, 1, r);
+
+    for (;;)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < INVALID_CURVE_BATCH; i++)
+        {
+            bn_random_below(x, curve->p, n);
+            mont_to(ctx, xs[i], x);
+            mont_sqr(ctx, rhs[i], xs[i]);
+            mont_add(ctx, rhs[i], rhs[i], curve->a);
+            mont_mul(ctx, rhs[i], rhs[i], xs[i]);
+            mont_add(ctx, rhs[i], rhs[i], curve->b);
+        }
+        mont_sqrt_batch(ctx, &curve->sqrt, rhs[0], square, rhs[0], INVALID_CURVE_BATCH);
+        for (size_t i = 0; i < INVALID_CURVE_BATCH; i++)
+        {
+            if (square[i])
+            {
+                bn_copy(candidates[count].x, xs[i], n);
+                bn_copy(candidates[count].y, rhs[i], n);
+                candidates[count].infinity = 0;
+                ec_mul(curve, &multiples[count], &candidates[count], cofactor, curve->order_n);
+                count++;
+            }
+        }
+        ec_to_affine_batch(curve, candidates, multiples, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (candidates[i].infinity)
+            {
+                continue;
+            }
+            for (;;)
+            {
+                ec_mul(curve, &next, &candidates[i], rr, 1);
+                if (ec_is_infinity(curve, &next))
+                {
+                    break;
+                }
+                ec_to_affine(curve, &candidates[i], &next);
+            }
+            *point = candidates[i];
+            return 1;
+        }
+    }
+}
+
+// Finds k in [0, r) with MAC(k h) = tag by walking h, 2h, 3h, ... with
+// mixed additions and normalizing INVALID_CURVE_SEARCH multiples per
+// inversion. Returns -1 if no k matches.
+long ec_residue_search(const ec_curve *curve, const ec_affine *h, limb_t r, const unsigned char *tag,
+                       const unsigned char *msg, size_t len)
+{
+    hmac_sha256_fixed mac;
+    ec_jacobian acc, walk[INVALID_CURVE_SEARCH];
+    ec_affine normal[INVALID_CURVE_SEARCH];
+    unsigned char key[2 * BN_MAX_LIMBS * sizeof(limb_t)], candidate[SHA256_DIGEST_SIZE];
+    limb_t x[BN_MAX_LIMBS], y[BN_MAX_LIMBS];
+
+    if (!hmac_sha256_fixed_init(&mac, msg, len))
+    {
+        return -1;
+    }
+    ec_set_infinity(curve, &acc);
+    for (limb_t base = 0; base < r; base += INVALID_CURVE_SEARCH)
+    {
+        size_t count = r - base < INVALID_CURVE_SEARCH ? (size_t)(r - base) : INVALID_CURVE_SEARCH;
+        for (size_t i = 0; i < count; i++)
+        {
+            walk[i] = acc;
+            ec_add_mixed(curve, &acc, &acc, h);
+        }
+        ec_to_affine_batch(curve, normal, walk, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            // k = 0 leaves the victim at the identity, whose coordinates
+            // normalize to zero and are MACed like any other point.
+            ec_affine_get(curve, x, y, &normal[i]);
+            bn_to_bytes(key, curve->bytes, x, curve->n);
+            bn_to_bytes(key + curve->bytes, curve->bytes, y, curve->n);
+            hmac_sha256_fixed_mac(&mac, candidate, key, 2 * curve->bytes);
+            if (memcmp(candidate, tag, SHA256_DIGEST_SIZE) == 0)
+            {
+                return (long)(base + i);
+            }
+        }
+    }
+    return -1;
+}
+
+// Harvest, query and search for one (curve, r) end to end, so a residue
+// reaches the CRT as soon as its own point is ready.
+static void attack_range(size_t begin, size_t end, void *ctx)
+{
+    attack_job *job = ctx;
+    for (size_t t = begin; t < end; t++)
+    {
+        const harvest_task *task = &job->tasks[t];
+        const ec_curve *curve = &job->curves[task->curve];
+        ec_affine h;
+        unsigned char tag[SHA256_DIGEST_SIZE];
+
+        if (crt_exceeds(job->crt, job->target_order))
+        {
+            return;
+        }
+        if (!point_cache_find(job->cache, task->curve, task->order, &h))
+        {
+            ec_small_order_point(curve, &h, task->order);
+            point_cache_insert(job->cache, task->curve, task->order, &h);
+        }
+        job->oracle(tag, &h, job->oracle_ctx);
+        long k = ec_residue_search(curve, &h, task->order, tag, job->msg, job->len);
+        if (k >= 0)
+        {
+            crt_add(job->crt, (limb_t)k, task->order);
+        }
+    }
+}
+
+static int by_order(const void *a, const void *b)
+{
+    limb_t x = ((const harvest_task *)a)->order, y = ((const harvest_task *)b)->order;
+    return (x > y) - (x < y);
+}
+
+// Uses every prime r below bound that divides one of the curve orders
+// (each r once, from the first curve that has it), cheapest first, until
+// the CRT modulus passes target_order. Returns the number of (curve, r)
+// pairs scheduled.
+size_t invalid_curve_attack(const ec_curve *curves, size_t curve_count, limb_t bound, const limb_t *target_order,
+                            ec_mac_oracle oracle, void *oracle_ctx, const unsigned char *msg, size_t len,
+                            point_cache *cache, crt_ctx *crt)
+{
+    harvest_task *tasks = NULL;
+    size_t count = 0, capacity = 0;
+    factor_params params;
+    factor_list factors;
+
+    factor_params_default(&params);
+    params.trial_bound = (uint32_t)bound;
+    params.smooth_bound = bound;
+    for (size_t c = 0; c < curve_count; c++)
+    {
+        factor(&factors, curves[c].order, curves[c].order_n, &params);
+        for (size_t i = 0; i < factors.count; i++)
+        {
+            limb_t r = factors.factors[i].value[0];
+            int seen = 0;
+            for (size_t k = 0; k < count && !seen; k++)
+            {
+                seen = tasks[k].order == r;
+            }
+            if (seen)
+            {
+                continue;
+            }
+            if (count == capacity)
+            {
+                capacity = capacity ? 2 * capacity : 32;
+                tasks = realloc(tasks, sizeof(harvest_task) * capacity);
+            }
+            tasks[count].curve = c;
+            tasks[count].order = r;
+            count++;
+        }
+    }
+    qsort(tasks, count, sizeof(harvest_task), by_order);
+
+    attack_job job = {curves, tasks, target_order, oracle, oracle_ctx, msg, len, cache, crt};
+    parallel_for(NULL, 0, count, 1, attack_range, &job, NULL);
+    free(tasks);
+    return count;
+}
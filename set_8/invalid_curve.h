@@ -0,0 +1,49 @@
+#ifndef INVALID_CURVE_ /* Include guard */
+#define INVALID_CURVE_
+
+#include <pthread.h>
+#include "crt.h"
+#include "ec.h"
+
+// Invalid-curve key recovery: harvest points of small prime order r from
+// curves that share the victim's a but not b, hand each to the victim's
+// MAC oracle, and search k*h for the matching tag to learn the secret mod
+// r. Residues stream into a CRT context as they are found.
+
+#define INVALID_CURVE_BATCH 8      // candidate points per cofactor round
+#define INVALID_CURVE_SEARCH 256   // multiples of h normalized per inversion
+
+typedef void (*ec_mac_oracle)(unsigned char *tag, const ec_affine *point, void *ctx);
+
+typedef struct
+{
+    size_t curve;
+    limb_t order;
+    ec_affine point;
+} small_order_point;
+
+// Harvested points keyed by (curve index, r).
+typedef struct
+{
+    small_order_point *entries;
+    size_t count;
+    size_t capacity;
+    pthread_mutex_t lock;
+} point_cache;
+
+void point_cache_init(point_cache *cache);
+
+void point_cache_free(point_cache *cache);
+
+int point_cache_find(point_cache *cache, size_t curve, limb_t r, ec_affine *point);
+
+int ec_small_order_point(const ec_curve *curve, ec_affine *point, limb_t r);
+
+long ec_residue_search(const ec_curve *curve, const ec_affine *h, limb_t r, const unsigned char *tag,
+                       const unsigned char *msg, size_t len);
+
+size_t invalid_curve_attack(const ec_curve *curves, size_t curve_count, limb_t bound, const limb_t *target_order,
+                            ec_mac_oracle oracle, void *oracle_ctx, const unsigned char *msg, size_t len,
+                            point_cache *cache, crt_ctx *crt);
+
+#endif // INVALID_CURVE_
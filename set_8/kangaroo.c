@@ -0,0 +1,596 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include "dp_store.h"
+#include "kangaroo.h"
+#include "modexp.h"
+#include "../common/thread_pool.h"
+
+#define KANGAROO_FLUSH 4096 // jumps between updates of the shared counter
+#define DP_TABLE_LOAD 4     // table slots per expected distinguished point
+#define KANGAROO_ID_MASK (DP_TAG_WILD - 1)
+
+typedef struct
+{
+    const dh_group *grp;
+    uint64_t lower;
+    uint64_t width;
+    uint64_t mean_jump;
+    uint64_t dp_mask;
+    uint64_t budget;
+    size_t jump_count;
+    uint64_t jump[KANGAROO_MAX_JUMPS];
+    limb_t jump_mont[KANGAROO_MAX_JUMPS][BN_MAX_LIMBS];
+    limb_t base_mont[BN_MAX_LIMBS];
+    limb_t y_mont[BN_MAX_LIMBS];
+    dp_store store;
+    atomic_uint_fast64_t jumps;
+    atomic_uint_fast64_t distinguished;
+    atomic_uint_fast64_t useless;
+    atomic_int found;
+    uint64_t index;
+    cancel_token cancel;
+} kangaroo_job;
+
+typedef struct
+{
+    limb_t pos[BN_MAX_LIMBS]; // Montgomery form
+    uint64_t start;           // tame: exponent of the start; wild: offset from y
+    uint64_t distance;
+    uint32_t tag;
+} kangaroo;
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// The jump index and the distinguished test look at disjoint bits of the
+// low limb, so being distinguished says nothing about the next jump.
+static size_t jump_index(const kangaroo_job *job, const limb_t *pos)
+{
+    return (size_t)(pos[0] % job->jump_count);
+}
+
+// Every limb below n goes in, and only those: the rest are undefined.
+static uint64_t fingerprint(const limb_t *pos, size_t n)
+{
+    uint64_t h = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        h = (h ^ pos[i]) * 0x9e3779b97f4a7c15ull;
+    }
+    return h | 1;
+}
+
+static void place(const kangaroo_job *job, kangaroo *k, uint64_t *rng)
+{
+    const mont_ctx *ctx = &job->grp->ctx;
+    size_t n = job->grp->n;
+    limb_t e[BN_MAX_LIMBS];
+    int wild = (k->tag & DP_TAG_WILD) != 0;
+
+    // Tame kangaroos start around the middle of the interval, wild ones a
+    // short random hop past y; both are spread over one mean jump.
+    uint64_t offset = splitmix64(rng) % job->mean_jump;
+    k->start = wild ? offset : job->lower + job->width / 2 + offset;
+    k->distance = 0;
+    bn_set_word(e, n, k->start);
+    mont_exp(ctx, k->pos, job->base_mont, e, n);
+    if (wild)
+    {
+        mont_mul(ctx, k->pos, k->pos, job->y_mont);
+    }
+}
+
+static int check_index(const kangaroo_job *job, uint64_t x)
+{
+    size_t n = job->grp->n;
+    limb_t e[BN_MAX_LIMBS], r[BN_MAX_LIMBS];
+    bn_set_word(e, n, x);
+    mont_exp(&job->grp->ctx, r, job->base_mont, e, n);
+    return bn_cmp(r, job->y_mont, n) == 0;
+}
+
+// Stores a distinguished point, or resolves a collision with the one
+// already there. Returns 1 when the kangaroo should be restarted because
+// it merged with another of its own kind.
+static int record(kangaroo_job *job, const kangaroo *k)
+{
+    uint64_t fp = fingerprint(k->pos, job->grp->n);
+    uint64_t total = k->start + k->distance;
+    atomic_fetch_add(&job->distinguished, 1);
+
+    dp_hit hit;
+    if (dp_store_insert(&job->store, fp, total, k->tag, &hit) != DP_COLLISION)
+    {
+        return 0;
+    }
+    if ((hit.tag & DP_TAG_WILD) == (k->tag & DP_TAG_WILD))
+    {
+        atomic_fetch_add(&job->useless, 1);
+        return 1;
+    }
+
+    // g^tame = y g^wild, so log y = tame - wild. Fingerprints are
+    // truncated, so the candidate is checked before it is believed.
+    uint64_t tame = k->tag & DP_TAG_WILD ? hit.distance : total;
+    uint64_t wild = k->tag & DP_TAG_WILD ? total : hit.distance;
+    if (tame >= wild && check_index(job, tame - wild))
+    {
+        int expected_found = 0;
+        if (atomic_compare_exchange_strong(&job->found, &expected_found, 1))
+        {
+            job->index = tame - wild;
+        }
+        cancel_request(&job->cancel);
+    }
+    return 1;
+}
+
+// One tame and one wild kangaroo per worker, jumping alternately.
+static void run_herd(size_t begin, size_t end, void *ctx)
+{
+    kangaroo_job *job = ctx;
+    const mont_ctx *ctx_p = &job->grp->ctx;
+    uint64_t rng;
+    kangaroo herd[2];
+    uint64_t pending = 0;
+
+    if (getrandom(&rng, sizeof(rng), 0) != sizeof(rng))
+    {
+        rng = (uint64_t)time(NULL);
+    }
+    rng ^= begin * 0xd1b54a32d192ed03ull;
+
+    for (size_t w = begin; w < end; w++)
+    {
+        herd[0].tag = (uint32_t)w & KANGAROO_ID_MASK;
+        herd[1].tag = ((uint32_t)w & KANGAROO_ID_MASK) | DP_TAG_WILD;
+        place(job, &herd[0], &rng);
+        place(job, &herd[1], &rng);
+
+        while (!cancel_requested(&job->cancel))
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                kangaroo *k = &herd[i];
+                size_t s = jump_index(job, k->pos);
+                mont_mul(ctx_p, k->pos, k->pos, job->jump_mont[s]);
+                k->distance += job->jump[s];
+                if ((k->pos[0] >> 32 & job->dp_mask) == 0 && record(job, k))
+                {
+                    place(job, k, &rng);
+                }
+            }
+            if ((pending += 2) >= KANGAROO_FLUSH)
+            {
+                if (atomic_fetch_add(&job->jumps, pending) + pending > job->budget)
+                {
+                    cancel_request(&job->cancel);
+                }
+                pending = 0;
+            }
+        }
+        atomic_fetch_add(&job->jumps, pending);
+        pending = 0;
+    }
+}
+
+// Identifies the search in a checkpoint file: the modulus, both elements
+// and the interval, each element bytes long.
+static uint64_t problem_id(const limb_t *p, const limb_t *base, const limb_t *y, size_t n, size_t bytes,
+                           uint64_t lower, uint64_t upper)
+{
+    sha256_ctx sha;
+    unsigned char buf[BN_MAX_LIMBS * sizeof(limb_t)], digest[SHA256_DIGEST_SIZE];
+    uint64_t range[2] = {lower, upper}, id;
+
+    sha256_init(&sha);
+    bn_to_bytes(buf, bytes, p, n);
+    sha256_update(&sha, buf, bytes);
+    bn_to_bytes(buf, bytes, base, n);
+    sha256_update(&sha, buf, bytes);
+    bn_to_bytes(buf, bytes, y, n);
+    sha256_update(&sha, buf, bytes);
+    sha256_update(&sha, (const unsigned char *)range, sizeof(range));
+    sha256_final(&sha, digest);
+    memcpy(&id, digest, sizeof(id));
+    return id;
+}
+
+// Jumps of 2^i with enough entries to reach a mean of N sqrt(w) / 4 for N
+// kangaroos in all, half tame and half wild (one pair gives the serial
+// optimum sqrt(w) / 2), and about one distinguished point per
+// sqrt(w) / (16 N) jumps, which keeps the 2N / theta tail small next to
+// the collision work.
+static void plan_walk(uint64_t width, size_t kangaroos, size_t *jump_count, uint64_t *mean_jump, unsigned *dp_bits)
+{
+    double root = sqrt((double)width);
+    double mean = kangaroos * root / 4;
+    mean = mean > 1 ? mean : 1;
+    size_t count = 1;
+    while (count < KANGAROO_MAX_JUMPS - 1 && ((double)((uint64_t)1 << count) - 1) / count < mean)
+    {
+        count++;
+    }
+    *jump_count = count;
+    *mean_jump = (((uint64_t)1 << count) - 1) / count;
+
+    unsigned bits = 0;
+    while (bits < 30 && (double)((uint64_t)1 << (bits + 1)) * 16 * kangaroos < root)
+    {
+        bits++;
+    }
+    *dp_bits = bits;
+}
+
+// Finds x in [lower, upper] with base^x = y (plain elements mod p).
+// Distinguished points go to the file at checkpoint when it is not NULL,
+// so an interrupted search resumes with everything found so far, and
+// processes sharing the file cooperate. Returns 0 if no collision turned
+// up within the work limit.
+int dh_kangaroo(const dh_group *grp, uint64_t *index, const limb_t *base, const limb_t *y, uint64_t lower,
+                uint64_t upper, const char *checkpoint, kangaroo_stats *stats)
+{
+    thread_pool *pool = thread_pool_shared();
+    size_t n = grp->n;
+    size_t workers = thread_pool_size(pool);
+    struct timespec start, stop;
+    kangaroo_job *job = calloc(1, sizeof(kangaroo_job));
+
+    job->grp = grp;
+    job->lower = lower;
+    job->width = upper - lower + 1;
+    mont_to(&grp->ctx, job->base_mont, base);
+    mont_to(&grp->ctx, job->y_mont, y);
+
+    double root = sqrt((double)job->width);
+    unsigned dp_bits;
+    plan_walk(job->width, 2 * workers, &job->jump_count, &job->mean_jump, &dp_bits);
+    bn_copy(job->jump_mont[0], job->base_mont, n);
+    job->jump[0] = 1;
+    for (size_t i = 1; i < job->jump_count; i++)
+    {
+        mont_sqr(&grp->ctx, job->jump_mont[i], job->jump_mont[i - 1]);
+        job->jump[i] = job->jump[i - 1] << 1;
+    }
+    job->dp_mask = ((uint64_t)1 << dp_bits) - 1;
+
+    uint64_t expected = (uint64_t)(2 * root) + 2 * workers * ((uint64_t)1 << dp_bits);
+    job->budget = expected * KANGAROO_WORK_LIMIT;
+    size_t slots = DP_TABLE_LOAD * (job->budget >> dp_bits);
+    if (!dp_store_open(&job->store, checkpoint, slots, problem_id(grp->p, base, y, n, grp->bytes, lower, upper)))
+    {
+        free(job);
+        return 0;
+    }
+    atomic_init(&job->found, 0);
+    cancel_token_init(&job->cancel);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parallel_for(pool, 0, workers, 1, run_herd, job, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    int found = atomic_load(&job->found);
+    if (found)
+    {
+        *index = job->index;
+    }
+    if (stats != NULL)
+    {
+        stats->threads = (unsigned)workers;
+        stats->dp_bits = dp_bits;
+        stats->mean_jump = job->mean_jump;
+        stats->jumps = atomic_load(&job->jumps);
+        stats->expected_jumps = expected;
+        stats->distinguished = atomic_load(&job->distinguished);
+        stats->useless_collisions = atomic_load(&job->useless);
+        stats->resumed = job->store.resumed;
+        stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        stats->rate = stats->jumps / stats->seconds / workers;
+    }
+    dp_store_close(&job->store);
+    free(job);
+    return found;
+}
+
+typedef struct
+{
+    const ec_curve *curve;
+    uint64_t lower;
+    uint64_t width;
+    uint64_t mean_jump;
+    uint64_t dp_mask;
+    uint64_t budget;
+    size_t jump_count;
+    uint64_t jump[KANGAROO_MAX_JUMPS];
+    ec_affine jump_point[KANGAROO_MAX_JUMPS];
+    ec_affine base;
+    size_t target_count;
+    ec_affine target[2 * EC_KANGAROO_MAX_TARGETS]; // each y, then -y
+    dp_store store;
+    atomic_uint_fast64_t jumps;
+    atomic_uint_fast64_t distinguished;
+    atomic_uint_fast64_t useless;
+    atomic_int found;
+    uint64_t index;
+    cancel_token cancel;
+} ec_kangaroo_job;
+
+typedef struct
+{
+    ec_affine pos;
+    uint64_t start;
+    uint64_t distance;
+    uint32_t tag;
+    size_t target; // wild walks: the +-y they started from
+} ec_walk;
+
+// Only the limbs below n are defined, so a one-limb field hashes x alone.
+// The parity of y keeps P and -P apart: the walks are on points, not on
+// +-classes (see kangaroo.h).
+static uint64_t ec_fingerprint(const ec_curve *curve, const ec_affine *pos)
+{
+    uint64_t high = curve->n > 1 ? pos->x[1] : 0;
+    return (high ^ pos->x[0] * 0x9e3779b97f4a7c15ull ^ (pos->y[0] & 1) << 1) | 1;
+}
+
+static void ec_place(const ec_kangaroo_job *job, ec_walk *w, uint64_t *rng)
+{
+    const ec_curve *curve = job->curve;
+    ec_jacobian j;
+    int wild = (w->tag & DP_TAG_WILD) != 0;
+    uint64_t offset = splitmix64(rng) % job->mean_jump;
+
+    do
+    {
+        w->start = wild ? offset : job->lower + job->width / 2 + offset;
+        ec_mul(curve, &j, &job->base, &w->start, 1);
+        if (wild)
+        {
+            ec_add_mixed(curve, &j, &j, &job->target[w->target]);
+        }
+        offset++;
+    } while (ec_is_infinity(curve, &j));
+    ec_to_affine(curve, &w->pos, &j);
+    w->distance = 0;
+}
+
+static int ec_check_index(const ec_kangaroo_job *job, uint64_t x)
+{
+    ec_jacobian j;
+    ec_affine r;
+    ec_mul(job->curve, &j, &job->base, &x, 1);
+    ec_to_affine(job->curve, &r, &j);
+    for (size_t t = 0; t < job->target_count && !r.infinity; t += 2)
+    {
+        if (bn_cmp(r.x, job->target[t].x, job->curve->n) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// As record() for the multiplicative group: tame = x * base and wild = +-y
+// + x' * base give +-y = (tame - wild) * base.
+static int ec_record(ec_kangaroo_job *job, const ec_walk *w)
+{
+    uint64_t total = w->start + w->distance;
+    atomic_fetch_add(&job->distinguished, 1);
+
+    dp_hit hit;
+    if (dp_store_insert(&job->store, ec_fingerprint(job->curve, &w->pos), total, w->tag, &hit) != DP_COLLISION)
+    {
+        return 0;
+    }
+    if ((hit.tag & DP_TAG_WILD) == (w->tag & DP_TAG_WILD))
+    {
+        atomic_fetch_add(&job->useless, 1);
+        return 1;
+    }
+
+    uint64_t tame = w->tag & DP_TAG_WILD ? hit.distance : total;
+    uint64_t wild = w->tag & DP_TAG_WILD ? total : hit.distance;
+    if (tame >= wild && ec_check_index(job, tame - wild))
+    {
+        int expected_found = 0;
+        if (atomic_compare_exchange_strong(&job->found, &expected_found, 1))
+        {
+            job->index = tame - wild;
+        }
+        cancel_request(&job->cancel);
+    }
+    else
+    {
+        atomic_fetch_add(&job->useless, 1);
+    }
+    return 1;
+}
+
+// Every walk takes one affine addition per round: the x differences of
+// all walks are inverted together (3M each plus one inversion per round),
+// then lambda = dy / dx gives the sum in 1S + 2M more.
+static void run_ec_herd(size_t begin, size_t end, void *ctx)
+{
+    ec_kangaroo_job *job = ctx;
+    const ec_curve *curve = job->curve;
+    const mont_ctx *mc = &curve->ctx;
+    size_t n = curve->n;
+    uint64_t rng;
+    ec_walk *walks = malloc(sizeof(ec_walk) * EC_KANGAROO_WALKS);
+    limb_t *dx = malloc(sizeof(limb_t) * BN_MAX_LIMBS * EC_KANGAROO_WALKS);
+    size_t step[EC_KANGAROO_WALKS];
+    uint64_t pending = 0;
+
+    if (getrandom(&rng, sizeof(rng), 0) != sizeof(rng))
+    {
+        rng = (uint64_t)time(NULL);
+    }
+    rng ^= begin * 0xd1b54a32d192ed03ull;
+
+    for (size_t worker = begin; worker < end; worker++)
+    {
+        for (size_t i = 0; i < EC_KANGAROO_WALKS; i++)
+        {
+            uint32_t id = (uint32_t)(worker * EC_KANGAROO_WALKS + i / 2) & KANGAROO_ID_MASK;
+            walks[i].tag = i % 2 ? id | DP_TAG_WILD : id;
+            walks[i].target = i / 2 % job->target_count;
+            ec_place(job, &walks[i], &rng);
+        }
+
+        while (!cancel_requested(&job->cancel))
+        {
+            for (size_t i = 0; i < EC_KANGAROO_WALKS; i++)
+            {
+                step[i] = (size_t)(walks[i].pos.x[0] % job->jump_count);
+                mont_sub(mc, dx + i * BN_MAX_LIMBS, job->jump_point[step[i]].x, walks[i].pos.x);
+            }
+            ec_field_inv_batch(curve, dx, dx, EC_KANGAROO_WALKS);
+
+            for (size_t i = 0; i < EC_KANGAROO_WALKS; i++)
+            {
+                ec_walk *w = &walks[i];
+                const ec_affine *jp = &job->jump_point[step[i]];
+                limb_t *inv = dx + i * BN_MAX_LIMBS;
+                limb_t lambda[BN_MAX_LIMBS], x3[BN_MAX_LIMBS];
+
+                // Same x as the jump point: the sum is a doubling or
+                // infinity, which a fresh start is cheaper than handling.
+                if (bn_is_zero(inv, n))
+                {
+                    ec_place(job, w, &rng);
+                    continue;
+                }
+                mont_sub(mc, lambda, jp->y, w->pos.y);
+                mont_mul(mc, lambda, lambda, inv);
+                mont_sqr(mc, x3, lambda);
+                mont_sub(mc, x3, x3, w->pos.x);
+                mont_sub(mc, x3, x3, jp->x);
+                mont_sub(mc, w->pos.x, w->pos.x, x3);
+                mont_mul(mc, w->pos.x, w->pos.x, lambda);
+                mont_sub(mc, w->pos.y, w->pos.x, w->pos.y);
+                bn_copy(w->pos.x, x3, n);
+                w->distance += job->jump[step[i]];
+
+                if ((w->pos.x[0] >> 32 & job->dp_mask) == 0 && ec_record(job, w))
+                {
+                    ec_place(job, w, &rng);
+                }
+            }
+            if ((pending += EC_KANGAROO_WALKS) >= KANGAROO_FLUSH)
+            {
+                if (atomic_fetch_add(&job->jumps, pending) + pending > job->budget)
+                {
+                    cancel_request(&job->cancel);
+                }
+                pending = 0;
+            }
+        }
+        atomic_fetch_add(&job->jumps, pending);
+        pending = 0;
+    }
+    free(dx);
+    free(walks);
+}
+
+// Finds x in [lower, upper] with x * base = +-y[i] for some i < count;
+// all points must be finite points of the curve. Checkpointing and the
+// return value are as for dh_kangaroo. stats->rate is point additions per
+// second per thread.
+int ec_kangaroo(const ec_curve *curve, uint64_t *index, const ec_affine *base, const ec_affine *y, size_t count,
+                uint64_t lower, uint64_t upper, const char *checkpoint, kangaroo_stats *stats)
+{
+    thread_pool *pool = thread_pool_shared();
+    size_t n = curve->n;
+    size_t workers = thread_pool_size(pool);
+    size_t walks = workers * EC_KANGAROO_WALKS;
+    struct timespec start, stop;
+    ec_kangaroo_job *job;
+
+    if (count == 0 || count > EC_KANGAROO_MAX_TARGETS)
+    {
+        return 0;
+    }
+    job = calloc(1, sizeof(ec_kangaroo_job));
+    job->curve = curve;
+    job->lower = lower;
+    job->width = upper - lower + 1;
+    job->base = *base;
+    job->target_count = 2 * count;
+    for (size_t i = 0; i < count; i++)
+    {
+        job->target[2 * i] = y[i];
+        ec_affine_neg(curve, &job->target[2 * i + 1], &y[i]);
+    }
+
+    double root = sqrt((double)job->width);
+    unsigned dp_bits;
+    plan_walk(job->width, walks, &job->jump_count, &job->mean_jump, &dp_bits);
+    job->jump_point[0] = *base;
+    job->jump[0] = 1;
+    for (size_t i = 1; i < job->jump_count; i++)
+    {
+        ec_jacobian j;
+        ec_from_affine(curve, &j, &job->jump_point[i - 1]);
+        ec_double(curve, &j, &j);
+        ec_to_affine(curve, &job->jump_point[i], &j);
+        job->jump[i] = job->jump[i - 1] << 1;
+    }
+    job->dp_mask = ((uint64_t)1 << dp_bits) - 1;
+
+    // Only the wild walks that started from the right +-y can meet a tame
+    // one; each further candidate costs about as much again as the
+    // tame herd's share.
+    uint64_t expected = (uint64_t)((1 + 2 * count) * root) + 2 * walks * ((uint64_t)1 << dp_bits);
+    job->budget = expected * KANGAROO_WORK_LIMIT;
+    size_t slots = DP_TABLE_LOAD * (job->budget >> dp_bits);
+    limb_t base_x[BN_MAX_LIMBS], y_x[BN_MAX_LIMBS];
+    uint64_t id = 0;
+    ec_affine_get(curve, base_x, NULL, base);
+    for (size_t i = 0; i < count; i++)
+    {
+        ec_affine_get(curve, y_x, NULL, &y[i]);
+        id = id * 0x9e3779b97f4a7c15ull + problem_id(curve->p, base_x, y_x, n, curve->bytes, lower, upper);
+    }
+    if (!dp_store_open(&job->store, checkpoint, slots, id))
+    {
+        free(job);
+        return 0;
+    }
+    atomic_init(&job->found, 0);
+    cancel_token_init(&job->cancel);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parallel_for(pool, 0, workers, 1, run_ec_herd, job, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    int found = atomic_load(&job->found);
+    if (found)
+    {
+        *index = job->index;
+    }
+    if (stats != NULL)
+    {
+        stats->threads = (unsigned)workers;
+        stats->dp_bits = dp_bits;
+        stats->mean_jump = job->mean_jump;
+        stats->jumps = atomic_load(&job->jumps);
+        stats->expected_jumps = expected;
+        stats->distinguished = atomic_load(&job->distinguished);
+        stats->useless_collisions = atomic_load(&job->useless);
+        stats->resumed = job->store.resumed;
+        stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        stats->rate = stats->jumps / stats->seconds / workers;
+    }
+    dp_store_close(&job->store);
+    free(job);
+    return found;
+}
@@ -0,0 +1,56 @@
+#ifndef KANGAROO_ /* Include guard */
+#define KANGAROO_
+
+#include <stdint.h>
+#include "dh.h"
+#include "ec.h"
+
+// Parallel-collision kangaroo (van Oorschot-Wiener): every worker drives
+// one tame and one wild kangaroo, and only distinguished points are
+// shared, through a lock-free table. With the mean jump scaled by the
+// number of kangaroos, the expected work per thread falls linearly with
+// the thread count. Given a checkpoint path, the distinguished points
+// live in a file mapping and a rerun resumes from them.
+//
+// ec_kangaroo is the same search on an elliptic curve, x-only: it finds x
+// with x * base = +-y for one of a few targets y, as when a target is
+// only known by its x (or Montgomery u) coordinate or up to a sign of
+// the known part of the logarithm. Each worker steps EC_KANGAROO_WALKS
+// walks in affine coordinates together, so one batched inversion serves
+// all of them; the wild walks are spread over every +-y.
+//
+// The sign is not folded away by walking on classes {P, -P}: with
+// additive jumps a canonical representative turns the distance into a
+// +-distance, which needs an interval centred on zero and fruitless-cycle
+// escapes (Galbraith-Ruprai) to stay correct. Instead P and -P stay apart
+// and each sign is a target of its own. Only the wild walks on the right
+// sign can meet the tame herd, so the expected work is about
+// (1 + 2 * count) sqrt(w) group operations for an interval of width w,
+// against sqrt(w) for a single known point.
+
+#define KANGAROO_MAX_JUMPS 64
+#define KANGAROO_WORK_LIMIT 8 // give up after this many times the expected work
+#define EC_KANGAROO_WALKS 64  // walks per worker, half tame and half wild
+#define EC_KANGAROO_MAX_TARGETS (EC_KANGAROO_WALKS / 4)
+
+typedef struct
+{
+    unsigned threads;
+    unsigned dp_bits;
+    uint64_t mean_jump;
+    uint64_t jumps;
+    uint64_t expected_jumps;
+    uint64_t distinguished;
+    uint64_t useless_collisions;
+    int resumed;
+    double seconds;
+    double rate; // jumps (group operations) per second per thread
+} kangaroo_stats;
+
+int dh_kangaroo(const dh_group *grp, uint64_t *index, const limb_t *base, const limb_t *y, uint64_t lower,
+                uint64_t upper, const char *checkpoint, kangaroo_stats *stats);
+
+int ec_kangaroo(const ec_curve *curve, uint64_t *index, const ec_affine *base, const ec_affine *y, size_t count,
+                uint64_t lower, uint64_t upper, const char *checkpoint, kangaroo_stats *stats);
+
+#endif // KANGAROO_
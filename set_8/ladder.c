@@ -0,0 +1,170 @@
+#include "ladder.h"
+
+int mcurve_init(mcurve *curve, const char *p, const char *a, const char *u, const char *order,
+                const char *curve_order)
+{
+    limb_t t[BN_MAX_LIMBS], four[BN_MAX_LIMBS];
+    if (!bn_from_dec(curve->p, BN_MAX_LIMBS, p) || !bn_from_dec(t, BN_MAX_LIMBS, a) ||
+        !bn_from_dec(curve->base_u, BN_MAX_LIMBS, u) || !bn_from_dec(curve->order, BN_MAX_LIMBS, order) ||
+        !bn_from_dec(curve->curve_order, BN_MAX_LIMBS, curve_order))
+    {
+        return 0;
+    }
+    size_t field_bits = bn_bits(curve->p, BN_MAX_LIMBS);
+    curve->n = BN_LIMBS(field_bits);
+    curve->bytes = (field_bits + 7) / 8;
+    curve->scalar_bits = field_bits + 1; // covers both orders, which can exceed p
+    curve->order_n = curve->n + 1; // Hasse: both orders are below p + 1 + 2 sqrt(p)
+    mont_init(&curve->ctx, curve->p, curve->n);
+    mont_inv_init(&curve->inv, &curve->ctx);
+
+    mont_to(&curve->ctx, curve->a, t);
+    bn_add_word(t, t, curve->n, 2);
+    mont_to(&curve->ctx, curve->a24, t);
+    bn_set_word(four, curve->n, 4);
+    mont_to(&curve->ctx, four, four);
+    mcurve_field_inv(curve, four, four);
+    mont_mul(&curve->ctx, curve->a24, curve->a24, four);
+
+    bn_set_word(t, curve->n, 3);
+    mont_to(&curve->ctx, t, t);
+    mcurve_field_inv(curve, t, t);
+    mont_mul(&curve->ctx, curve->shift, curve->a, t);
+    mont_from(&curve->ctx, curve->shift, curve->shift);
+
+    bn_zero(curve->twist_order, BN_MAX_LIMBS);
+    bn_add(curve->twist_order, curve->p, curve->p, curve->order_n);
+    bn_add_word(curve->twist_order, curve->twist_order, curve->order_n, 2);
+    bn_sub(curve->twist_order, curve->twist_order, curve->curve_order, curve->order_n);
+    return 1;
+}
+
+// Montgomery form in and out; zero maps to zero, matching the ladder's
+// convention that u = 0 stands for both (0, 0) and infinity.
+void mcurve_field_inv(const mcurve *curve, limb_t *r, const limb_t *a)
+{
+#if LADDER_CONSTANT_TIME
+    mont_inv(&curve->ctx, &curve->inv, r, a);
+#else
+    mont_inv_vartime(&curve->ctx, &curve->inv, r, a);
+#endif
+}
+
+// The isomorphic short Weierstrass curve (B = 1): u = x - A / 3 takes it
+// to y^2 = x^3 + (1 - A^2 / 3) x + (2 A^3 / 27 - A / 3). Both share p and
+// the Montgomery constants, so field elements move between them as is.
+// The base point gets the canonical lift of its u.
+int mcurve_to_weierstrass(const mcurve *curve, ec_curve *r)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t third[BN_MAX_LIMBS], a2[BN_MAX_LIMBS], t[BN_MAX_LIMBS], x[BN_MAX_LIMBS];
+
+    r->n = n;
+    r->bytes = curve->bytes;
+    r->ctx = *ctx;
+    r->inv = curve->inv;
+    mont_sqrt_init(&r->sqrt, ctx);
+    bn_copy(r->p, curve->p, n);
+    bn_copy(r->order, curve->order, BN_MAX_LIMBS);
+    r->order_n = BN_LIMBS(bn_bits(curve->order, BN_MAX_LIMBS));
+
+    bn_set_word(third, n, 3);
+    mont_to(ctx, third, third);
+    mcurve_field_inv(curve, third, third);
+    mont_sqr(ctx, a2, curve->a);
+
+    // a = 1 - A^2 / 3
+    mont_mul(ctx, t, a2, third);
+    mont_sub(ctx, r->a, ctx->one, t);
+
+    // b = A (2 A^2 / 9 - 1) / 3
+    mont_add(ctx, t, a2, a2);
+    mont_mul(ctx, t, t, third);
+    mont_mul(ctx, t, t, third);
+    mont_sub(ctx, t, t, ctx->one);
+    mont_mul(ctx, t, t, curve->a);
+    mont_mul(ctx, r->b, t, third);
+
+    mcurve_u_to_x(curve, x, curve->base_u);
+    return ec_lift_x(r, &r->base, x);
+}
+
+// Plain in and out.
+void mcurve_u_to_x(const mcurve *curve, limb_t *x, const limb_t *u)
+{
+    mont_add(&curve->ctx, x, u, curve->shift);
+}
+
+void mcurve_x_to_u(const mcurve *curve, limb_t *u, const limb_t *x)
+{
+    mont_sub(&curve->ctx, u, x, curve->shift);
+}
+
+// k * (u : 1) as (x : z), Montgomery form in and out. Each step is one
+// differential addition and one doubling with (A + 2) / 4 (5M + 4S + 1
+// multiplication by a24); consecutive swaps are merged so each bit costs
+// one pair of cswaps.
+void ladder_projective(const mcurve *curve, limb_t *x, limb_t *z, const limb_t *u, const limb_t *k, size_t kn)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t x2[BN_MAX_LIMBS], z2[BN_MAX_LIMBS], x3[BN_MAX_LIMBS], z3[BN_MAX_LIMBS];
+    limb_t a[BN_MAX_LIMBS], aa[BN_MAX_LIMBS], b[BN_MAX_LIMBS], bb[BN_MAX_LIMBS], e[BN_MAX_LIMBS];
+    limb_t c[BN_MAX_LIMBS], d[BN_MAX_LIMBS], da[BN_MAX_LIMBS], cb[BN_MAX_LIMBS];
+    limb_t swap = 0;
+
+    bn_copy(x2, ctx->one, n);
+    bn_zero(z2, n);
+    bn_copy(x3, u, n);
+    bn_copy(z3, ctx->one, n);
+
+#if LADDER_CONSTANT_TIME
+    size_t bits = curve->scalar_bits;
+#else
+    size_t bits = bn_bits(k, kn);
+#endif
+    for (size_t i = bits; i-- > 0;)
+    {
+        limb_t bit = i / 64 < kn ? (k[i / 64] >> (i % 64)) & 1 : 0;
+        swap ^= bit;
+        bn_cswap(x2, x3, n, swap);
+        bn_cswap(z2, z3, n, swap);
+        swap = bit;
+
+        mont_add(ctx, a, x2, z2);
+        mont_sqr(ctx, aa, a);
+        mont_sub(ctx, b, x2, z2);
+        mont_sqr(ctx, bb, b);
+        mont_sub(ctx, e, aa, bb);
+        mont_add(ctx, c, x3, z3);
+        mont_sub(ctx, d, x3, z3);
+        mont_mul(ctx, da, d, a);
+        mont_mul(ctx, cb, c, b);
+
+        mont_add(ctx, x3, da, cb);
+        mont_sqr(ctx, x3, x3);
+        mont_sub(ctx, z3, da, cb);
+        mont_sqr(ctx, z3, z3);
+        mont_mul(ctx, z3, z3, u);
+        mont_mul(ctx, x2, aa, bb);
+        mont_mul(ctx, z2, curve->a24, e);
+        mont_add(ctx, z2, z2, bb);
+        mont_mul(ctx, z2, z2, e);
+    }
+    bn_cswap(x2, x3, n, swap);
+    bn_cswap(z2, z3, n, swap);
+    bn_copy(x, x2, n);
+    bn_copy(z, z2, n);
+}
+
+// u-coordinate of k * u, plain in and out; 0 for the identity.
+void ladder(const mcurve *curve, limb_t *r, const limb_t *u, const limb_t *k, size_t kn)
+{
+    limb_t um[BN_MAX_LIMBS], x[BN_MAX_LIMBS], z[BN_MAX_LIMBS];
+    mont_to(&curve->ctx, um, u);
+    ladder_projective(curve, x, z, um, k, kn);
+    mcurve_field_inv(curve, z, z);
+    mont_mul(&curve->ctx, x, x, z);
+    mont_from(&curve->ctx, r, x);
+}
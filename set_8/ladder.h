@@ -0,0 +1,54 @@
+#ifndef LADDER_ /* Include guard */
+#define LADDER_
+
+#include "bignum.h"
+#include "ec.h"
+
+// x-only arithmetic on Montgomery curves v^2 = u^3 + A u^2 + u. The
+// ladder takes and returns plain u-coordinates and works the same for
+// points on the twist, since it never looks at v.
+//
+// LADDER_CONSTANT_TIME selects the build: 1 runs every ladder for
+// scalar_bits, one more than the bit length of p since the curve and
+// twist orders can exceed p, with mask-based swaps and the constant-time
+// safegcd inversion; 0 stops at the top bit of the scalar and uses the
+// variable-time safegcd, for attack code working on public data.
+
+#ifndef LADDER_CONSTANT_TIME
+#define LADDER_CONSTANT_TIME 1
+#endif
+
+typedef struct
+{
+    size_t n;
+    size_t bytes;
+    size_t order_n;
+    size_t scalar_bits;
+    mont_ctx ctx;
+    mont_inv_ctx inv;
+    limb_t p[BN_MAX_LIMBS];
+    limb_t a[BN_MAX_LIMBS];     // Montgomery form
+    limb_t a24[BN_MAX_LIMBS];   // (A + 2) / 4, Montgomery form
+    limb_t shift[BN_MAX_LIMBS]; // A / 3, plain: the Weierstrass x is u + A / 3
+    limb_t base_u[BN_MAX_LIMBS];
+    limb_t order[BN_MAX_LIMBS];       // order of the base point
+    limb_t curve_order[BN_MAX_LIMBS]; // number of points on the curve
+    limb_t twist_order[BN_MAX_LIMBS]; // 2p + 2 - curve_order
+} mcurve;
+
+int mcurve_init(mcurve *curve, const char *p, const char *a, const char *u, const char *order,
+                const char *curve_order);
+
+void mcurve_field_inv(const mcurve *curve, limb_t *r, const limb_t *a);
+
+int mcurve_to_weierstrass(const mcurve *curve, ec_curve *r);
+
+void mcurve_u_to_x(const mcurve *curve, limb_t *x, const limb_t *u);
+
+void mcurve_x_to_u(const mcurve *curve, limb_t *u, const limb_t *x);
+
+void ladder_projective(const mcurve *curve, limb_t *x, limb_t *z, const limb_t *u, const limb_t *k, size_t kn);
+
+void ladder(const mcurve *curve, limb_t *r, const limb_t *u, const limb_t *k, size_t kn);
+
+#endif // LADDER_
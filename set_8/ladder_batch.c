@@ -0,0 +1,440 @@
+#include <string.h>
+#include "ladder_batch.h"
+#include "modexp.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define LADDER_MAX_LANES 8
+
+// Field parameters for one radix. Elements are kept below 2p between
+// operations; differences go through bias, a multiple K p whose limbs are
+// each at least as large as any normalized limb, so a - b + bias never
+// borrows and needs only unsigned carries. R = 2^(radix limbs) is large
+// enough that the widest product of two operands, (K + 2)^2 p^2, still
+// reduces below 2p without a final subtraction.
+typedef struct
+{
+    size_t limbs;
+    unsigned radix;
+    uint64_t mask;
+    uint64_t m0inv; // -p^-1 mod 2^radix
+    uint64_t p[LADDER_VEC_MAX_LIMBS];
+    uint64_t bias[LADDER_VEC_MAX_LIMBS];
+    uint64_t one[LADDER_VEC_MAX_LIMBS]; // R mod p
+    uint64_t a24[LADDER_VEC_MAX_LIMBS]; // (A + 2) / 4 * R mod p
+} vec_field;
+
+typedef void (*ladder_kernel)(const vec_field *f, uint64_t *x, uint64_t *z, const uint64_t *u, const limb_t *k,
+                              size_t kn, size_t bits);
+
+// Normalized radix limbs; the top one keeps whatever is left (up to 64 bits).
+static void to_radix(uint64_t *r, const limb_t *a, size_t n, unsigned radix, size_t limbs)
+{
+    for (size_t j = 0; j < limbs; j++)
+    {
+        size_t pos = j * radix, w = pos / 64, s = pos % 64;
+        uint64_t v = 0;
+        if (w < n)
+        {
+            v = a[w] >> s;
+            if (s != 0 && w + 1 < n)
+            {
+                v |= a[w + 1] << (64 - s);
+            }
+        }
+        r[j] = j + 1 < limbs ? v & (((uint64_t)1 << radix) - 1) : v;
+    }
+}
+
+// Normalized limbs to n + 1 machine limbs.
+static void from_radix(limb_t *r, size_t n, const uint64_t *a, unsigned radix, size_t limbs)
+{
+    bn_zero(r, n + 1);
+    for (size_t j = 0; j < limbs; j++)
+    {
+        size_t pos = j * radix, w = pos / 64, s = pos % 64;
+        if (w <= n)
+        {
+            r[w] |= a[j] << s;
+        }
+        if (s + radix > 64 && w + 1 <= n)
+        {
+            r[w + 1] |= a[j] >> (64 - s);
+        }
+    }
+}
+
+// a R mod p for plain a < p, in radix limbs.
+static void to_vec_mont(const vec_field *f, const mcurve *curve, uint64_t *r, const limb_t *a)
+{
+    size_t n = curve->n, shift = f->limbs * f->radix;
+    size_t w = n + shift / 64 + 1;
+    limb_t t[2 * BN_MAX_LIMBS], m[BN_MAX_LIMBS];
+    bn_zero(t, w);
+    bn_copy(t, a, n);
+    bn_shl(t, t, w, shift);
+    bn_mod(m, t, w, curve->p, n);
+    to_radix(r, m, n, f->radix, f->limbs);
+}
+
+static int vec_field_init(vec_field *f, const mcurve *curve, unsigned radix)
+{
+    size_t n = curve->n, bits = bn_bits(curve->p, n);
+    limb_t t[BN_MAX_LIMBS + 2], a24[BN_MAX_LIMBS];
+    uint64_t k = 4;
+
+    f->radix = radix;
+    f->mask = ((uint64_t)1 << radix) - 1;
+    f->m0inv = curve->ctx.m0inv & f->mask;
+    for (f->limbs = (bits + 7 + radix - 1) / radix;; f->limbs++)
+    {
+        if (f->limbs > LADDER_VEC_MAX_LIMBS)
+        {
+            return 0;
+        }
+        // Smallest K with (K - 2) p >= 2^(radix (limbs - 1)): the top limb of
+        // the bias then exceeds the top limb of anything below 2p.
+        size_t top = radix * (f->limbs - 1);
+        for (k = 4;; k <<= 1)
+        {
+            t[n] = bn_mul_word(t, curve->p, n, k - 2);
+            if (bn_bits(t, n + 1) > top)
+            {
+                break;
+            }
+        }
+        t[n] = bn_mul_word(t, curve->p, n, (k + 2) * (k + 2));
+        if (bn_bits(t, n + 1) <= radix * f->limbs)
+        {
+            break;
+        }
+    }
+
+    to_radix(f->p, curve->p, n, radix, f->limbs);
+    t[n] = bn_mul_word(t, curve->p, n, k);
+    to_radix(f->bias, t, n + 1, radix, f->limbs);
+    f->bias[0] += (uint64_t)1 << radix;
+    for (size_t j = 1; j + 1 < f->limbs; j++)
+    {
+        f->bias[j] += ((uint64_t)1 << radix) - 1;
+    }
+    f->bias[f->limbs - 1] -= 1;
+
+    bn_set_word(t, n, 1);
+    to_vec_mont(f, curve, f->one, t);
+    mont_from(&curve->ctx, a24, curve->a24);
+    to_vec_mont(f, curve, f->a24, a24);
+    return 1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+typedef uint64_t v4u64 __attribute__((vector_size(32)));
+typedef uint64_t v8u64 __attribute__((vector_size(64)));
+
+// Low 32 bits of each lane times low 32 bits of each lane, 64-bit result.
+__attribute__((target("avx2"))) static inline v4u64 mul32_avx2(v4u64 a, v4u64 b)
+{
+    return (v4u64)_mm256_mul_epu32((__m256i)a, (__m256i)b);
+}
+
+__attribute__((target("avx512f"))) static inline v8u64 mul32_avx512(v8u64 a, v8u64 b)
+{
+    return (v8u64)_mm512_mul_epu32((__m512i)a, (__m512i)b);
+}
+
+// One ladder per lane over the vector type VEC. Montgomery multiplication
+// is operand scanning on radix limbs held in 64-bit lanes: each step adds
+// one limb of a times b and one multiple of p, then shifts down one limb,
+// leaving carries unpropagated until the end. Inputs are lane-interleaved
+// (limb j of lane i at [j * LANES + i]); outputs are plain and below 2p.
+#define LADDER_KERNEL(NAME, TARGET, VEC, LANES, MUL32)                                                          \
+    typedef struct                                                                                              \
+    {                                                                                                           \
+        VEC l[LADDER_VEC_MAX_LIMBS];                                                                            \
+    } NAME##_fe;                                                                                                \
+                                                                                                                \
+    __attribute__((target(TARGET))) static inline void NAME##_splat(NAME##_fe *r, const uint64_t *a, size_t n)  \
+    {                                                                                                           \
+        for (size_t j = 0; j < n; j++)                                                                          \
+        {                                                                                                       \
+            r->l[j] = (VEC){0} + a[j];                                                                          \
+        }                                                                                                       \
+    }                                                                                                           \
+                                                                                                                \
+    __attribute__((target(TARGET))) static inline void NAME##_norm(NAME##_fe *r, const vec_field *f)            \
+    {                                                                                                           \
+        for (size_t j = 0; j + 1 < f->limbs; j++)                                                               \
+        {                                                                                                       \
+            r->l[j + 1] += r->l[j] >> f->radix;                                                                 \
+            r->l[j] &= f->mask;                                                                                 \
+        }                                                                                                       \
+    }                                                                                                           \
+                                                                                                                \
+    __attribute__((target(TARGET))) static inline void NAME##_add(NAME##_fe *r, const NAME##_fe *a,             \
+                                                                  const NAME##_fe *b, const vec_field *f)       \
+    {                                                                                                           \
+        for (size_t j = 0; j < f->limbs; j++)                                                                   \
+        {                                                                                                       \
+            r->l[j] = a->l[j] + b->l[j];                                                                        \
+        }                                                                                                       \
+        NAME##_norm(r, f);                                                                                      \
+    }                                                                                                           \
+                                                                                                                \
+    __attribute__((target(TARGET))) static inline void NAME##_sub(NAME##_fe *r, const NAME##_fe *a,             \
+                                                                  const NAME##_fe *b, const vec_field *f)       \
+    {                                                                                                           \
+        for (size_t j = 0; j < f->limbs; j++)                                                                   \
+        {                                                                                                       \
+            r->l[j] = a->l[j] + f->bias[j] - b->l[j];                                                           \
+        }                                                                                                       \
+        NAME##_norm(r, f);                                                                                      \
+    }                                                                                                           \
+                                                                                                                \
+    __attribute__((target(TARGET))) static void NAME##_mul(NAME##_fe *r, const NAME##_fe *a, const NAME##_fe *b, \
+                                                           const vec_field *f)                                  \
+    {                                                                                                           \
+        size_t n = f->limbs;                                                                                    \
+        VEC t[LADDER_VEC_MAX_LIMBS];                                                                            \
+        VEC mask = (VEC){0} + f->mask, m0inv = (VEC){0} + f->m0inv;                                             \
+        for (size_t j = 0; j < n; j++)                                                                          \
+        {                                                                                                       \
+            t[j] = (VEC){0};                                                                                    \
+        }                                                                                                       \
+        for (size_t i = 0; i < n; i++)                                                                          \
+        {                                                                                                       \
+            VEC ai = a->l[i];                                                                                   \
+            for (size_t j = 0; j < n; j++)                                                                      \
+            {                                                                                                   \
+                t[j] += MUL32(ai, b->l[j]);                                                                     \
+            }                                                                                                   \
+            VEC m = MUL32(t[0] & mask, m0inv) & mask;                                                           \
+            for (size_t j = 0; j < n; j++)                                                                      \
+            {                                                                                                   \
+                t[j] += MUL32(m, (VEC){0} + f->p[j]);                                                           \
+            }                                                                                                   \
+            VEC carry = t[0] >> f->radix;                                                                       \
+            for (size_t j = 0; j + 1 < n; j++)                                                                  \
+            {                                                                                                   \
+                t[j] = t[j + 1];                                                                                \
+            }                                                                                                   \
+            t[n - 1] = (VEC){0};                                                                                \
+            t[0] += carry;                                                                                      \
+        }                                                                                                       \
+        for (size_t j = 0; j < n; j++)                                                                          \
+        {                                                                                                       \
+            r->l[j] = t[j];                                                                                     \
+        }                                                                                                       \
+        NAME##_norm(r, f);                                                                                      \
+    }                                                                                                           \
+                                                                                                                \
+    __attribute__((target(TARGET))) static inline void NAME##_cswap(NAME##_fe *a, NAME##_fe *b, VEC mask,       \
+                                                                    size_t n)                                   \
+    {                                                                                                           \
+        for (size_t j = 0; j < n; j++)                                                                          \
+        {                                                                                                       \
+            VEC t = mask & (a->l[j] ^ b->l[j]);                                                                 \
+            a->l[j] ^= t;                                                                                       \
+            b->l[j] ^= t;                                                                                       \
+        }                                                                                                       \
+    }                                                                                                           \
+                                                                                                                \
+    __attribute__((target(TARGET))) static void NAME(const vec_field *f, uint64_t *x, uint64_t *z,              \
+                                                     const uint64_t *u, const limb_t *k, size_t kn, size_t bits) \
+    {                                                                                                           \
+        size_t n = f->limbs;                                                                                    \
+        NAME##_fe uu = {0}, x2 = {0}, z2 = {0}, x3 = {0}, z3 = {0}, a24 = {0}, one = {0};                       \
+        NAME##_fe a, aa, b, bb, e, c, d, da, cb;                                                                \
+        uint64_t swap = 0;                                                                                      \
+                                                                                                                \
+        for (size_t j = 0; j < n; j++)                                                                          \
+        {                                                                                                       \
+            memcpy(&uu.l[j], u + j * LANES, sizeof(VEC));                                                       \
+            x3.l[j] = uu.l[j];                                                                                  \
+            z2.l[j] = (VEC){0};                                                                                 \
+            one.l[j] = (VEC){0} + (uint64_t)(j == 0);                                                           \
+        }                                                                                                       \
+        NAME##_splat(&x2, f->one, n);                                                                           \
+        NAME##_splat(&z3, f->one, n);                                                                           \
+        NAME##_splat(&a24, f->a24, n);                                                                          \
+                                                                                                                \
+        for (size_t i = bits; i-- > 0;)                                                                         \
+        {                                                                                                       \
+            uint64_t bit = i / 64 < kn ? (k[i / 64] >> (i % 64)) & 1 : 0;                                       \
+            VEC mask = (VEC){0} + ((uint64_t)0 - (swap ^ bit));                                                 \
+            NAME##_cswap(&x2, &x3, mask, n);                                                                    \
+            NAME##_cswap(&z2, &z3, mask, n);                                                                    \
+            swap = bit;                                                                                         \
+                                                                                                                \
+            NAME##_add(&a, &x2, &z2, f);                                                                        \
+            NAME##_mul(&aa, &a, &a, f);                                                                         \
+            NAME##_sub(&b, &x2, &z2, f);                                                                        \
+            NAME##_mul(&bb, &b, &b, f);                                                                         \
+            NAME##_sub(&e, &aa, &bb, f);                                                                        \
+            NAME##_add(&c, &x3, &z3, f);                                                                        \
+            NAME##_sub(&d, &x3, &z3, f);                                                                        \
+            NAME##_mul(&da, &d, &a, f);                                                                         \
+            NAME##_mul(&cb, &c, &b, f);                                                                         \
+                                                                                                                \
+            NAME##_add(&x3, &da, &cb, f);                                                                       \
+            NAME##_mul(&x3, &x3, &x3, f);                                                                       \
+            NAME##_sub(&z3, &da, &cb, f);                                                                       \
+            NAME##_mul(&z3, &z3, &z3, f);                                                                       \
+            NAME##_mul(&z3, &z3, &uu, f);                                                                       \
+            NAME##_mul(&x2, &aa, &bb, f);                                                                       \
+            NAME##_mul(&z2, &a24, &e, f);                                                                       \
+            NAME##_add(&z2, &z2, &bb, f);                                                                       \
+            NAME##_mul(&z2, &z2, &e, f);                                                                        \
+        }                                                                                                       \
+        VEC mask = (VEC){0} + ((uint64_t)0 - swap);                                                             \
+        NAME##_cswap(&x2, &x3, mask, n);                                                                        \
+        NAME##_cswap(&z2, &z3, mask, n);                                                                        \
+                                                                                                                \
+        NAME##_mul(&x2, &x2, &one, f);                                                                          \
+        NAME##_mul(&z2, &z2, &one, f);                                                                          \
+        for (size_t j = 0; j < n; j++)                                                                          \
+        {                                                                                                       \
+            memcpy(x + j * LANES, &x2.l[j], sizeof(VEC));                                                       \
+            memcpy(z + j * LANES, &z2.l[j], sizeof(VEC));                                                       \
+        }                                                                                                       \
+    }
+
+LADDER_KERNEL(ladder_avx2, "avx2", v4u64, 4, mul32_avx2)
+LADDER_KERNEL(ladder_avx512, "avx512f", v8u64, 8, mul32_avx512)
+#endif
+
+static ladder_kernel select_ladder_kernel(size_t *lanes, unsigned *radix)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        *lanes = 8;
+        *radix = 29;
+        return ladder_avx512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *lanes = 4;
+        *radix = 26;
+        return ladder_avx2;
+    }
+#endif
+    *lanes = 1;
+    *radix = 0;
+    return NULL;
+}
+
+// Points processed per kernel call: the vector width, or 1 on the scalar path.
+size_t ladder_batch_lanes(const mcurve *curve)
+{
+    size_t lanes;
+    unsigned radix;
+    vec_field f;
+    if (select_ladder_kernel(&lanes, &radix) == NULL || !vec_field_init(&f, curve, radix))
+    {
+        return 1;
+    }
+    return lanes;
+}
+
+// x / z for each lane (plain, below 2p on input) with one inversion:
+// prefix products, invert the last, walk back. Zero z gives 0.
+static void divide_lanes(const mcurve *curve, limb_t *r, limb_t (*x)[BN_MAX_LIMBS + 1],
+                         limb_t (*z)[BN_MAX_LIMBS + 1], size_t count)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    limb_t prefix[LADDER_MAX_LANES][BN_MAX_LIMBS], acc[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+    bn_copy(acc, ctx->one, n);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (x[i][n] != 0 || bn_cmp(x[i], curve->p, n) >= 0)
+        {
+            bn_sub(x[i], x[i], curve->p, n);
+        }
+        if (z[i][n] != 0 || bn_cmp(z[i], curve->p, n) >= 0)
+        {
+            bn_sub(z[i], z[i], curve->p, n);
+        }
+        mont_to(ctx, x[i], x[i]);
+        mont_to(ctx, z[i], z[i]);
+        bn_copy(prefix[i], acc, n);
+        if (!bn_is_zero(z[i], n))
+        {
+            mont_mul(ctx, acc, acc, z[i]);
+        }
+    }
+    mcurve_field_inv(curve, acc, acc);
+    for (size_t i = count; i-- > 0;)
+    {
+        limb_t *ri = r + i * BN_MAX_LIMBS;
+        if (bn_is_zero(z[i], n))
+        {
+            bn_zero(ri, n);
+            continue;
+        }
+        mont_mul(ctx, t, acc, prefix[i]);
+        mont_mul(ctx, acc, acc, z[i]);
+        mont_mul(ctx, t, t, x[i]);
+        mont_from(ctx, ri, t);
+    }
+}
+
+// u-coordinates of k * u[i] for count points, plain in and out, spaced
+// BN_MAX_LIMBS apart; r may alias u. The tail of a partial group is padded
+// with copies of its last point.
+void ladder_batch(const mcurve *curve, limb_t *r, const limb_t *u, size_t count, const limb_t *k, size_t kn)
+{
+    size_t lanes, n = curve->n;
+    unsigned radix;
+    vec_field f;
+    ladder_kernel kernel = select_ladder_kernel(&lanes, &radix);
+    if (kernel == NULL || !vec_field_init(&f, curve, radix))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            ladder(curve, r + i * BN_MAX_LIMBS, u + i * BN_MAX_LIMBS, k, kn);
+        }
+        return;
+    }
+
+#if LADDER_CONSTANT_TIME
+    size_t bits = curve->scalar_bits;
+#else
+    size_t bits = bn_bits(k, kn);
+#endif
+    uint64_t in[LADDER_VEC_MAX_LIMBS * LADDER_MAX_LANES], xs[LADDER_VEC_MAX_LIMBS * LADDER_MAX_LANES],
+        zs[LADDER_VEC_MAX_LIMBS * LADDER_MAX_LANES], limbs[LADDER_VEC_MAX_LIMBS];
+    limb_t x[LADDER_MAX_LANES][BN_MAX_LIMBS + 1], z[LADDER_MAX_LANES][BN_MAX_LIMBS + 1];
+
+    for (size_t base = 0; base < count; base += lanes)
+    {
+        size_t used = count - base < lanes ? count - base : lanes;
+        for (size_t i = 0; i < lanes; i++)
+        {
+            size_t src = base + (i < used ? i : used - 1);
+            to_vec_mont(&f, curve, limbs, u + src * BN_MAX_LIMBS);
+            for (size_t j = 0; j < f.limbs; j++)
+            {
+                in[j * lanes + i] = limbs[j];
+            }
+        }
+        kernel(&f, xs, zs, in, k, kn, bits);
+        for (size_t i = 0; i < used; i++)
+        {
+            for (size_t j = 0; j < f.limbs; j++)
+            {
+                limbs[j] = xs[j * lanes + i];
+            }
+            from_radix(x[i], n, limbs, radix, f.limbs);
+            for (size_t j = 0; j < f.limbs; j++)
+            {
+                limbs[j] = zs[j * lanes + i];
+            }
+            from_radix(z[i], n, limbs, radix, f.limbs);
+        }
+        divide_lanes(curve, r + base * BN_MAX_LIMBS, x, z, used);
+    }
+}
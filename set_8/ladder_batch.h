@@ -0,0 +1,18 @@
+#ifndef LADDER_BATCH_ /* Include guard */
+#define LADDER_BATCH_
+
+#include "ladder.h"
+
+// Many ladders with one scalar, run in lockstep across the lanes of a
+// vector register: 8 with AVX-512 (radix 2^29 limbs), 4 with AVX2 (radix
+// 2^26), all sharing the bit schedule and swaps of k. Fields wider than
+// LADDER_VEC_MAX_LIMBS limbs of the radix, or CPUs without either
+// extension, fall back to one scalar ladder per point.
+
+#define LADDER_VEC_MAX_LIMBS 12
+
+size_t ladder_batch_lanes(const mcurve *curve);
+
+void ladder_batch(const mcurve *curve, limb_t *r, const limb_t *u, size_t count, const limb_t *k, size_t kn);
+
+#endif // LADDER_BATCH_
@@ -0,0 +1,237 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "modexp.h"
+#include "../common/thread_pool.h"
+
+#define SLIDING_MAX_WINDOW 6
+
+typedef struct fixed_base_entry
+{
+    fixed_base fb;
+    mont_ctx ctx;
+    limb_t base[BN_MAX_LIMBS];
+    struct fixed_base_entry *next;
+} fixed_base_entry;
+
+typedef struct
+{
+    const fixed_base *fb;
+    limb_t *results;
+    const limb_t *exps;
+    size_t en;
+} exp_batch_job;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static fixed_base_entry *cache;
+
+static unsigned sliding_window_size(size_t bits)
+{
+    if (bits <= 24)
+    {
+        return 1;
+    }
+    if (bits <= 80)
+    {
+        return 3;
+    }
+    if (bits <= 240)
+    {
+        return 4;
+    }
+    if (bits <= 672)
+    {
+        return 5;
+    }
+    return SLIDING_MAX_WINDOW;
+}
+
+// Left-to-right sliding window over odd powers base^1, base^3, ...,
+// base^(2^w - 1). r may alias base.
+void mont_exp(const mont_ctx *ctx, limb_t *r, const limb_t *base, const limb_t *e, size_t en)
+{
+    size_t n = ctx->n;
+    size_t bits = bn_bits(e, en);
+    unsigned w = sliding_window_size(bits);
+    limb_t odd[1 << (SLIDING_MAX_WINDOW - 1)][BN_MAX_LIMBS];
+    limb_t acc[BN_MAX_LIMBS];
+
+    if (bits == 0)
+    {
+        bn_copy(r, ctx->one, n);
+        return;
+    }
+
+    bn_copy(odd[0], base, n);
+    if (w > 1)
+    {
+        limb_t sq[BN_MAX_LIMBS];
+        mont_sqr(ctx, sq, base);
+        for (size_t i = 1; i < ((size_t)1 << (w - 1)); i++)
+        {
+            mont_mul(ctx, odd[i], odd[i - 1], sq);
+        }
+    }
+
+    bn_copy(acc, ctx->one, n);
+    int started = 0;
+    for (size_t i = bits; i-- > 0;)
+    {
+        if (!bn_bit(e, i))
+        {
+            if (started)
+            {
+                mont_sqr(ctx, acc, acc);
+            }
+            continue;
+        }
+
+        size_t low = i + 1 >= w ? i + 1 - w : 0;
+        while (!bn_bit(e, low))
+        {
+            low++;
+        }
+        size_t value = 0;
+        for (size_t k = i + 1; k-- > low;)
+        {
+            value = value << 1 | (size_t)bn_bit(e, k);
+            if (started)
+            {
+                mont_sqr(ctx, acc, acc);
+            }
+        }
+        if (started)
+        {
+            mont_mul(ctx, acc, acc, odd[value >> 1]);
+        }
+        else
+        {
+            bn_copy(acc, odd[value >> 1], n);
+            started = 1;
+        }
+        i = low;
+    }
+    bn_copy(r, acc, n);
+}
+
+void mod_exp(const mont_ctx *ctx, limb_t *r, const limb_t *base, const limb_t *e, size_t en)
+{
+    limb_t b[BN_MAX_LIMBS];
+    mont_to(ctx, b, base);
+    mont_exp(ctx, b, b, e, en);
+    mont_from(ctx, r, b);
+}
+
+void fixed_base_init(fixed_base *fb, const mont_ctx *ctx, const limb_t *base, size_t exp_bits, unsigned teeth)
+{
+    size_t n = ctx->n;
+    size_t entries = (size_t)1 << teeth;
+    limb_t g[BN_MAX_LIMBS];
+
+    fb->ctx = ctx;
+    fb->exp_bits = exp_bits;
+    fb->teeth = teeth;
+    fb->spacing = (exp_bits + teeth - 1) / teeth;
+    fb->table = malloc(sizeof(limb_t) * n * entries);
+
+    // table[2^j + i] = table[i] * g^(2^(j * spacing)) for i < 2^j.
+    bn_copy(fb->table, ctx->one, n);
+    bn_copy(g, base, n);
+    for (unsigned j = 0; j < teeth; j++)
+    {
+        size_t half = (size_t)1 << j;
+        for (size_t i = 0; i < half; i++)
+        {
+            mont_mul(ctx, fb->table + (half + i) * n, fb->table + i * n, g);
+        }
+        for (size_t s = 0; s < fb->spacing; s++)
+        {
+            mont_sqr(ctx, g, g);
+        }
+    }
+}
+
+void fixed_base_free(fixed_base *fb)
+{
+    free(fb->table);
+    fb->table = NULL;
+}
+
+// Exponents wider than the table fall back to the sliding window.
+void fixed_base_exp(const fixed_base *fb, limb_t *r, const limb_t *e, size_t en)
+{
+    const mont_ctx *ctx = fb->ctx;
+    size_t n = ctx->n;
+    size_t bits = bn_bits(e, en);
+    limb_t acc[BN_MAX_LIMBS];
+
+    if (bits > fb->exp_bits)
+    {
+        mont_exp(ctx, r, fb->table + n, e, en);
+        return;
+    }
+
+    bn_copy(acc, ctx->one, n);
+    for (size_t k = fb->spacing; k-- > 0;)
+    {
+        size_t index = 0;
+        for (unsigned j = fb->teeth; j-- > 0;)
+        {
+            size_t bit = j * fb->spacing + k;
+            index = index << 1 | (bit < bits ? (size_t)bn_bit(e, bit) : 0);
+        }
+        mont_sqr(ctx, acc, acc);
+        mont_mul(ctx, acc, acc, fb->table + index * n);
+    }
+    bn_copy(r, acc, n);
+}
+
+// One table per (modulus, base, exp_bits), built on first use and kept for
+// the life of the process, so every key generation in a group shares it.
+const fixed_base *fixed_base_cached(const mont_ctx *ctx, const limb_t *base, size_t exp_bits)
+{
+    size_t n = ctx->n;
+    pthread_mutex_lock(&cache_lock);
+    for (fixed_base_entry *entry = cache; entry != NULL; entry = entry->next)
+    {
+        if (entry->ctx.n == n && entry->fb.exp_bits >= exp_bits &&
+            bn_cmp(entry->ctx.m, ctx->m, n) == 0 && bn_cmp(entry->base, base, n) == 0)
+        {
+            pthread_mutex_unlock(&cache_lock);
+            return &entry->fb;
+        }
+    }
+
+    fixed_base_entry *entry = malloc(sizeof(fixed_base_entry));
+    entry->ctx = *ctx;
+    bn_copy(entry->base, base, n);
+    fixed_base_init(&entry->fb, &entry->ctx, base, exp_bits, COMB_DEFAULT_TEETH);
+    entry->next = cache;
+    cache = entry;
+    pthread_mutex_unlock(&cache_lock);
+    return &entry->fb;
+}
+
+static void run_exp_batch(size_t begin, size_t end, void *ctx)
+{
+    exp_batch_job *job = ctx;
+    size_t n = job->fb->ctx->n;
+    for (size_t i = begin; i < end; i++)
+    {
+        fixed_base_exp(job->fb, job->results + i * n, job->exps + i * job->en, job->en);
+    }
+}
+
+// results[i] = base^exps[i] for count exponents of en limbs each, with the
+// comb table shared across the batch and the batch spread over the pool.
+void mont_exp_batch(const mont_ctx *ctx, limb_t *results, const limb_t *base, const limb_t *exps, size_t en, size_t count)
+{
+    size_t bits = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t b = bn_bits(exps + i * en, en);
+        bits = b > bits ? b : bits;
+    }
+
+    exp_batch_job job = {fixed_base_cached(ctx, base, bits > 0 ? bits : 1), results, exps, en};
+    parallel_for(thread_pool_shared(), 0, count, 0, run_exp_batch, &job, NULL);
+}
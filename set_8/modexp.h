@@ -0,0 +1,38 @@
+#ifndef MODEXP_ /* Include guard */
+#define MODEXP_
+
+#include "bignum.h"
+
+// Exponentiation in (Z/mZ)^*. Bases and results of the mont_* functions
+// are in Montgomery form, exponents are plain limb arrays. mod_exp is the
+// plain-domain convenience wrapper.
+
+#define COMB_DEFAULT_TEETH 8
+
+// Lim-Lee comb for a fixed base: 2^teeth precomputed products of
+// g^(2^(j * spacing)), so an exponent of up to exp_bits bits costs
+// `spacing` squarings and `spacing` multiplications.
+typedef struct
+{
+    const mont_ctx *ctx;
+    size_t exp_bits;
+    unsigned teeth;
+    size_t spacing;
+    limb_t *table;
+} fixed_base;
+
+void mont_exp(const mont_ctx *ctx, limb_t *r, const limb_t *base, const limb_t *e, size_t en);
+
+void mod_exp(const mont_ctx *ctx, limb_t *r, const limb_t *base, const limb_t *e, size_t en);
+
+void fixed_base_init(fixed_base *fb, const mont_ctx *ctx, const limb_t *base, size_t exp_bits, unsigned teeth);
+
+void fixed_base_free(fixed_base *fb);
+
+void fixed_base_exp(const fixed_base *fb, limb_t *r, const limb_t *e, size_t en);
+
+const fixed_base *fixed_base_cached(const mont_ctx *ctx, const limb_t *base, size_t exp_bits);
+
+void mont_exp_batch(const mont_ctx *ctx, limb_t *results, const limb_t *base, const limb_t *exps, size_t en, size_t count);
+
+#endif // MODEXP_
@@ -0,0 +1,405 @@
+#include <stdlib.h>
+#include "modinv.h"
+
+#define M62 (UINT64_MAX >> 2)
+
+// f 2^62 = u f0 + v g0 and g 2^62 = q f0 + r g0 after one round. Every
+// divstep at most doubles a row, so |u| + |v| and |q| + |r| stay within
+// 2^62.
+typedef struct
+{
+    int64_t u, v, q, r;
+} divstep_matrix;
+
+static void to_signed62(int64_t *s, size_t len, const limb_t *a, size_t n)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        size_t bit = i * MODINV_LIMB_BITS, limb = bit / BN_LIMB_BITS, off = bit % BN_LIMB_BITS;
+        uint64_t v = 0;
+        if (limb < n)
+        {
+            v = a[limb] >> off;
+            if (off > 2 && limb + 1 < n)
+            {
+                v |= a[limb + 1] << (BN_LIMB_BITS - off);
+            }
+        }
+        s[i] = (int64_t)(v & M62);
+    }
+}
+
+// s must be normalized: limbs in [0, 2^62), value below 2^(64 n).
+static void from_signed62(limb_t *r, size_t n, const int64_t *s, size_t len)
+{
+    bn_zero(r, n);
+    for (size_t i = 0; i < len; i++)
+    {
+        size_t bit = i * MODINV_LIMB_BITS, limb = bit / BN_LIMB_BITS, off = bit % BN_LIMB_BITS;
+        uint64_t v = (uint64_t)s[i];
+        if (limb < n)
+        {
+            r[limb] |= v << off;
+        }
+        if (off > 2 && limb + 1 < n)
+        {
+            r[limb + 1] |= v >> (BN_LIMB_BITS - off);
+        }
+    }
+}
+
+void mont_inv_init(mont_inv_ctx *ic, const mont_ctx *ctx)
+{
+    size_t bits = bn_bits(ctx->m, ctx->n);
+
+    ic->n = ctx->n;
+    ic->len = bits / MODINV_LIMB_BITS + 1;
+    to_signed62(ic->m, ic->len, ctx->m, ctx->n);
+    ic->m_inv = (0 - ctx->m0inv) & M62;
+    mont_mul(ctx, ic->r3, ctx->r2, ctx->r2);
+
+    // Bernstein-Yang, Theorem 11.2: this many divsteps take any
+    // 0 <= g <= f < 2^bits to g = 0.
+    size_t steps = bits < 46 ? (49 * bits + 80) / 17 : (49 * bits + 57) / 17;
+    ic->rounds = (steps + MODINV_LIMB_BITS - 1) / MODINV_LIMB_BITS;
+}
+
+// 62 divsteps on the low words, delta starting where the caller left it.
+// The swap, the conditional add and the halving are all done on masks.
+static int64_t divsteps_62(int64_t delta, uint64_t f, uint64_t g, divstep_matrix *t)
+{
+    uint64_t u = 1, v = 0, q = 0, r = 1;
+
+    for (int i = 0; i < MODINV_LIMB_BITS; i++)
+    {
+        uint64_t odd = 0 - (g & 1);
+        uint64_t swap = (uint64_t)((0 - delta) >> 63) & odd;
+        uint64_t x;
+
+        // delta > 0 and g odd: (f, g) = (g, -f), and the rows likewise.
+        delta = (int64_t)(((uint64_t)delta ^ swap) - swap);
+        x = (f ^ g) & swap;
+        f ^= x;
+        g ^= x;
+        g = (g ^ swap) - swap;
+        x = (u ^ q) & swap;
+        u ^= x;
+        q ^= x;
+        q = (q ^ swap) - swap;
+        x = (v ^ r) & swap;
+        v ^= x;
+        r ^= x;
+        r = (r ^ swap) - swap;
+
+        g += f & odd;
+        q += u & odd;
+        r += v & odd;
+        delta++;
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+    }
+    t->u = (int64_t)u;
+    t->v = (int64_t)v;
+    t->q = (int64_t)q;
+    t->r = (int64_t)r;
+    return delta;
+}
+
+// The same 62 divsteps with eta = -delta, for public inputs: runs of
+// even g are skipped with one count of trailing zeros, and an odd g has
+// up to 6 (after a swap) or 4 low bits cancelled at once by adding the
+// right multiple of f, capped so that eta cannot change sign midway.
+static int64_t divsteps_62_vartime(int64_t eta, uint64_t f, uint64_t g, divstep_matrix *t)
+{
+    uint64_t u = 1, v = 0, q = 0, r = 1, m, w;
+    int i = MODINV_LIMB_BITS;
+
+    for (;;)
+    {
+        int zeros = __builtin_ctzll(g | (UINT64_MAX << i));
+        g >>= zeros;
+        u <<= zeros;
+        v <<= zeros;
+        eta -= zeros;
+        i -= zeros;
+        if (i == 0)
+        {
+            break;
+        }
+        int limit;
+        if (eta < 0)
+        {
+            uint64_t x;
+            eta = -eta;
+            x = f;
+            f = g;
+            g = 0 - x;
+            x = u;
+            u = q;
+            q = 0 - x;
+            x = v;
+            v = r;
+            r = 0 - x;
+            limit = (int)eta + 1 > i ? i : (int)eta + 1;
+            m = (UINT64_MAX >> (64 - limit)) & 63;
+            w = (f * g * (f * f - 2)) & m; // -g / f mod 2^6
+        }
+        else
+        {
+            limit = (int)eta + 1 > i ? i : (int)eta + 1;
+            m = (UINT64_MAX >> (64 - limit)) & 15;
+            w = f + (((f + 1) & 4) << 1); // 1 / f mod 2^4
+            w = (0 - w * g) & m;
+        }
+        g += f * w;
+        q += u * w;
+        r += v * w;
+    }
+    t->u = (int64_t)u;
+    t->v = (int64_t)v;
+    t->q = (int64_t)q;
+    t->r = (int64_t)r;
+    return eta;
+}
+
+// (d, e) = t (d, e) / 2^62 mod m, keeping both in (-2m, m). Adding
+// u or v times m for each negative input keeps the result above -2m; the
+// multiple of m chosen for exactness then brings it below m.
+static void update_de(const mont_inv_ctx *ic, int64_t *d, int64_t *e, const divstep_matrix *t)
+{
+    size_t len = ic->len;
+    int64_t sd = d[len - 1] >> 63, se = e[len - 1] >> 63;
+    int64_t md = (t->u & sd) + (t->v & se);
+    int64_t me = (t->q & sd) + (t->r & se);
+    __int128 cd = (__int128)t->u * d[0] + (__int128)t->v * e[0];
+    __int128 ce = (__int128)t->q * d[0] + (__int128)t->r * e[0];
+
+    md -= (int64_t)((ic->m_inv * (uint64_t)cd + (uint64_t)md) & M62);
+    me -= (int64_t)((ic->m_inv * (uint64_t)ce + (uint64_t)me) & M62);
+    cd += (__int128)ic->m[0] * md;
+    ce += (__int128)ic->m[0] * me;
+    cd >>= MODINV_LIMB_BITS;
+    ce >>= MODINV_LIMB_BITS;
+    for (size_t i = 1; i < len; i++)
+    {
+        cd += (__int128)t->u * d[i] + (__int128)t->v * e[i] + (__int128)ic->m[i] * md;
+        ce += (__int128)t->q * d[i] + (__int128)t->r * e[i] + (__int128)ic->m[i] * me;
+        d[i - 1] = (int64_t)((uint64_t)cd & M62);
+        e[i - 1] = (int64_t)((uint64_t)ce & M62);
+        cd >>= MODINV_LIMB_BITS;
+        ce >>= MODINV_LIMB_BITS;
+    }
+    d[len - 1] = (int64_t)cd;
+    e[len - 1] = (int64_t)ce;
+}
+
+// (f, g) = t (f, g) / 2^62 over the low len limbs; the division is exact.
+static void update_fg(int64_t *f, int64_t *g, size_t len, const divstep_matrix *t)
+{
+    __int128 cf = (__int128)t->u * f[0] + (__int128)t->v * g[0];
+    __int128 cg = (__int128)t->q * f[0] + (__int128)t->r * g[0];
+
+    cf >>= MODINV_LIMB_BITS;
+    cg >>= MODINV_LIMB_BITS;
+    for (size_t i = 1; i < len; i++)
+    {
+        cf += (__int128)t->u * f[i] + (__int128)t->v * g[i];
+        cg += (__int128)t->q * f[i] + (__int128)t->r * g[i];
+        f[i - 1] = (int64_t)((uint64_t)cf & M62);
+        g[i - 1] = (int64_t)((uint64_t)cg & M62);
+        cf >>= MODINV_LIMB_BITS;
+        cg >>= MODINV_LIMB_BITS;
+    }
+    f[len - 1] = (int64_t)cf;
+    g[len - 1] = (int64_t)cg;
+}
+
+static void carry_signed62(int64_t *d, size_t len)
+{
+    for (size_t i = 0; i + 1 < len; i++)
+    {
+        d[i + 1] += d[i] >> MODINV_LIMB_BITS;
+        d[i] = (int64_t)((uint64_t)d[i] & M62);
+    }
+}
+
+// d in (-2m, m) and f = +-1 with sign the mask of f < 0: sign * d, in
+// [0, m), on masks alone.
+static void normalize(const mont_inv_ctx *ic, int64_t *d, int64_t sign)
+{
+    size_t len = ic->len;
+    int64_t neg = d[len - 1] >> 63;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        d[i] += ic->m[i] & neg;
+    }
+    carry_signed62(d, len);
+    for (size_t i = 0; i < len; i++)
+    {
+        d[i] = (d[i] ^ sign) - sign;
+    }
+    carry_signed62(d, len);
+    neg = d[len - 1] >> 63;
+    for (size_t i = 0; i < len; i++)
+    {
+        d[i] += ic->m[i] & neg;
+    }
+    carry_signed62(d, len);
+}
+
+// a^-1 mod m for a < m, in time that depends only on m.
+void bn_inv_safegcd(const mont_inv_ctx *ic, limb_t *r, const limb_t *a)
+{
+    size_t len = ic->len;
+    int64_t f[MODINV_MAX_LIMBS], g[MODINV_MAX_LIMBS], d[MODINV_MAX_LIMBS], e[MODINV_MAX_LIMBS];
+    int64_t delta = 1;
+    divstep_matrix t;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        f[i] = ic->m[i];
+        d[i] = 0;
+        e[i] = 0;
+    }
+    e[0] = 1;
+    to_signed62(g, len, a, ic->n);
+    for (size_t i = 0; i < ic->rounds; i++)
+    {
+        delta = divsteps_62(delta, (uint64_t)f[0], (uint64_t)g[0], &t);
+        update_de(ic, d, e, &t);
+        update_fg(f, g, len, &t);
+    }
+    normalize(ic, d, f[len - 1] >> 63);
+    from_signed62(r, ic->n, d, len);
+}
+
+// Returns 0, with r = 0, when gcd(a, m) != 1.
+int bn_inv_safegcd_vartime(const mont_inv_ctx *ic, limb_t *r, const limb_t *a)
+{
+    size_t len = ic->len, n = ic->n;
+    int64_t f[MODINV_MAX_LIMBS], g[MODINV_MAX_LIMBS], d[MODINV_MAX_LIMBS], e[MODINV_MAX_LIMBS];
+    limb_t m[BN_MAX_LIMBS], reduced[BN_MAX_LIMBS];
+    int64_t eta = -1;
+    divstep_matrix t;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        f[i] = ic->m[i];
+        d[i] = 0;
+        e[i] = 0;
+    }
+    e[0] = 1;
+    from_signed62(m, n, ic->m, len);
+    bn_mod(reduced, a, n, m, n);
+    to_signed62(g, len, reduced, n);
+
+    size_t active = len;
+    for (;;)
+    {
+        eta = divsteps_62_vartime(eta, (uint64_t)f[0], (uint64_t)g[0], &t);
+        update_de(ic, d, e, &t);
+        update_fg(f, g, active, &t);
+
+        int64_t any = 0;
+        for (size_t i = 0; i < active; i++)
+        {
+            any |= g[i];
+        }
+        if (any == 0)
+        {
+            break;
+        }
+
+        // Drop the top limb once both top limbs are only sign extension.
+        int64_t fn = f[active - 1], gn = g[active - 1];
+        if (active > 1 && (fn ^ (fn >> 63)) == 0 && (gn ^ (gn >> 63)) == 0)
+        {
+            f[active - 2] = (int64_t)((uint64_t)f[active - 2] | (uint64_t)fn << MODINV_LIMB_BITS);
+            g[active - 2] = (int64_t)((uint64_t)g[active - 2] | (uint64_t)gn << MODINV_LIMB_BITS);
+            active--;
+        }
+    }
+
+    // f = gcd up to sign; only +-1 means a was invertible.
+    int64_t sign = f[active - 1] >> 63;
+    for (size_t i = 0; i < active; i++)
+    {
+        f[i] = (f[i] ^ sign) - sign;
+    }
+    carry_signed62(f, active);
+    int one = f[0] == 1;
+    for (size_t i = 1; i < active; i++)
+    {
+        one &= f[i] == 0;
+    }
+    if (!one)
+    {
+        bn_zero(r, n);
+        return 0;
+    }
+    normalize(ic, d, sign);
+    from_signed62(r, n, d, len);
+    return 1;
+}
+
+// inv(a R) = a^-1 R^-1, and one Montgomery multiplication by R^3 takes
+// that to a^-1 R.
+void mont_inv(const mont_ctx *ctx, const mont_inv_ctx *ic, limb_t *r, const limb_t *a)
+{
+    bn_inv_safegcd(ic, r, a);
+    mont_mul(ctx, r, r, ic->r3);
+}
+
+int mont_inv_vartime(const mont_ctx *ctx, const mont_inv_ctx *ic, limb_t *r, const limb_t *a)
+{
+    if (!bn_inv_safegcd_vartime(ic, r, a))
+    {
+        return 0;
+    }
+    mont_mul(ctx, r, r, ic->r3);
+    return 1;
+}
+
+// Montgomery's simultaneous inversion over count elements spaced
+// BN_MAX_LIMBS apart: prefix products, one inversion of the total, then a
+// backward pass peeling one factor off at a time, about 3 multiplications
+// per element. Zeros are passed over and come back as zero; r may alias a.
+void mont_inv_batch(const mont_ctx *ctx, const mont_inv_ctx *ic, limb_t *r, const limb_t *a, size_t count)
+{
+    size_t n = ctx->n;
+    limb_t inv[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+    limb_t *prefix = malloc(sizeof(limb_t) * BN_MAX_LIMBS * (count + 1));
+
+    bn_copy(prefix, ctx->one, n);
+    for (size_t i = 0; i < count; i++)
+    {
+        const limb_t *ai = a + i * BN_MAX_LIMBS;
+        limb_t *next = prefix + (i + 1) * BN_MAX_LIMBS;
+        if (bn_is_zero(ai, n))
+        {
+            bn_copy(next, prefix + i * BN_MAX_LIMBS, n);
+        }
+        else
+        {
+            mont_mul(ctx, next, prefix + i * BN_MAX_LIMBS, ai);
+        }
+    }
+
+    mont_inv(ctx, ic, inv, prefix + count * BN_MAX_LIMBS);
+    for (size_t i = count; i-- > 0;)
+    {
+        const limb_t *ai = a + i * BN_MAX_LIMBS;
+        limb_t *ri = r + i * BN_MAX_LIMBS;
+        if (bn_is_zero(ai, n))
+        {
+            bn_zero(ri, n);
+            continue;
+        }
+        mont_mul(ctx, t, inv, ai);
+        mont_mul(ctx, ri, inv, prefix + i * BN_MAX_LIMBS);
+        bn_copy(inv, t, n);
+    }
+    free(prefix);
+}
@@ -0,0 +1,44 @@
+#ifndef MODINV_ /* Include guard */
+#define MODINV_
+
+#include "bignum.h"
+
+// Inversion mod an odd m by Bernstein-Yang safegcd. Values are carried
+// as signed 62-bit limbs; each round runs 62 divsteps on the low words
+// of f and g alone, then applies the resulting 2x2 matrix to the full
+// f, g and to the coefficients d, e, which are kept mod m by adding the
+// multiple of m that makes the division by 2^62 exact.
+//
+// bn_inv_safegcd runs the fixed number of rounds that Bernstein and Yang
+// prove sufficient for the bit length of m, on masks alone, so its time
+// does not depend on a. bn_inv_safegcd_vartime stops as soon as g is
+// zero, skips runs of zero bits in one step and trims leading limbs as
+// f and g shrink: for public values only. Both map zero to zero. The
+// mont_* forms take and return Montgomery form.
+
+#define MODINV_LIMB_BITS 62
+#define MODINV_MAX_LIMBS (BN_MAX_BITS / MODINV_LIMB_BITS + 2)
+
+typedef struct
+{
+    size_t n;      // limbs of the bignum form
+    size_t len;    // limbs of the signed 62-bit form
+    size_t rounds; // 62-divstep rounds the constant-time inverse runs
+    int64_t m[MODINV_MAX_LIMBS];
+    uint64_t m_inv;         // m^-1 mod 2^62
+    limb_t r3[BN_MAX_LIMBS]; // R^3 mod m
+} mont_inv_ctx;
+
+void mont_inv_init(mont_inv_ctx *ic, const mont_ctx *ctx);
+
+void bn_inv_safegcd(const mont_inv_ctx *ic, limb_t *r, const limb_t *a);
+
+int bn_inv_safegcd_vartime(const mont_inv_ctx *ic, limb_t *r, const limb_t *a);
+
+void mont_inv(const mont_ctx *ctx, const mont_inv_ctx *ic, limb_t *r, const limb_t *a);
+
+int mont_inv_vartime(const mont_ctx *ctx, const mont_inv_ctx *ic, limb_t *r, const limb_t *a);
+
+void mont_inv_batch(const mont_ctx *ctx, const mont_inv_ctx *ic, limb_t *r, const limb_t *a, size_t count);
+
+#endif // MODINV_
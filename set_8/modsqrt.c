@@ -0,0 +1,316 @@
+#include "modexp.h"
+#include "modsqrt.h"
+#include "../common/thread_pool.h"
+
+#define MODSQRT_GRAIN 16
+
+typedef struct
+{
+    const mont_ctx *ctx;
+    const mont_sqrt_ctx *sc;
+    limb_t *r;
+    int *ok;
+    const limb_t *a;
+} sqrt_batch_job;
+
+// Both odd from the first subtraction on; (2 / y) = -1 exactly when
+// y = 3 or 5 mod 8, and swapping two odd values flips the sign when both
+// are 3 mod 4.
+static int jacobi_word(limb_t x, limb_t y, int t)
+{
+    while (x != 0)
+    {
+        int z = __builtin_ctzll(x);
+        x >>= z;
+        if ((z & 1) && ((y & 7) == 3 || (y & 7) == 5))
+        {
+            t = -t;
+        }
+        if (x < y)
+        {
+            limb_t s = x;
+            x = y;
+            y = s;
+            if ((x & y & 3) == 3)
+            {
+                t = -t;
+            }
+        }
+        x -= y;
+    }
+    return y == 1 ? t : 0;
+}
+
+// (a / m) for odd m. The same binary steps as jacobi_word on the full
+// width, dropping to one limb as soon as both values fit.
+int bn_jacobi(const limb_t *a, const limb_t *m, size_t n)
+{
+    limb_t xs[BN_MAX_LIMBS], ys[BN_MAX_LIMBS];
+    limb_t *x = xs, *y = ys;
+    int t = 1;
+
+    bn_mod(x, a, n, m, n);
+    bn_copy(y, m, n);
+    for (;;)
+    {
+        while (n > 1 && x[n - 1] == 0 && y[n - 1] == 0)
+        {
+            n--;
+        }
+        if (n == 1)
+        {
+            return jacobi_word(x[0], y[0], t);
+        }
+
+        size_t z = 0;
+        while (z < n && x[z] == 0)
+        {
+            z++;
+        }
+        if (z == n)
+        {
+            return 0; // y > 1
+        }
+        size_t shift = z * BN_LIMB_BITS + (size_t)__builtin_ctzll(x[z]);
+        if (shift)
+        {
+            bn_shr(x, x, n, shift);
+            if ((shift & 1) && ((y[0] & 7) == 3 || (y[0] & 7) == 5))
+            {
+                t = -t;
+            }
+        }
+        if (bn_cmp(x, y, n) < 0)
+        {
+            limb_t *s = x;
+            x = y;
+            y = s;
+            if ((x[0] & y[0] & 3) == 3)
+            {
+                t = -t;
+            }
+        }
+        bn_sub_n(x, x, y, n);
+    }
+}
+
+// r[i] = (a[i] / m), values spaced BN_MAX_LIMBS apart.
+void bn_jacobi_batch(int *r, const limb_t *a, const limb_t *m, size_t n, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        r[i] = bn_jacobi(a + i * BN_MAX_LIMBS, m, n);
+    }
+}
+
+void mont_sqrt_init(mont_sqrt_ctx *sc, const mont_ctx *ctx)
+{
+    size_t n = ctx->n;
+    limb_t q[BN_MAX_LIMBS], z[BN_MAX_LIMBS];
+
+    bn_set_word(sc->two, n, 2);
+    mont_to(ctx, sc->two, sc->two);
+    sc->s = 1;
+    bn_sub_word(q, ctx->m, n, 1);
+    while (!bn_bit(q, sc->s))
+    {
+        sc->s++;
+    }
+    bn_shr(q, q, n, sc->s);
+
+    if (sc->s == 1)
+    {
+        sc->method = MODSQRT_3MOD4;
+        bn_add_word(sc->e, ctx->m, n, 1);
+        bn_shr(sc->e, sc->e, n, 2);
+    }
+    else if (sc->s == 2)
+    {
+        sc->method = MODSQRT_5MOD8;
+        bn_shr(sc->e, ctx->m, n, 3);
+    }
+    else if (sc->s <= MODSQRT_TABLE)
+    {
+        sc->method = MODSQRT_TONELLI;
+        limb_t candidate = 3;
+        do
+        {
+            bn_set_word(z, n, candidate);
+            candidate += 2;
+        } while (bn_jacobi(z, ctx->m, n) != -1);
+        mont_to(ctx, z, z);
+        mont_exp(ctx, sc->roots[0], z, q, n);
+        for (size_t i = 1; i < sc->s; i++)
+        {
+            mont_sqr(ctx, sc->roots[i], sc->roots[i - 1]);
+        }
+        bn_shr(sc->e, q, n, 1);
+    }
+    else
+    {
+        sc->method = MODSQRT_CIPOLLA;
+        bn_add_word(sc->e, ctx->m, n, 1);
+        bn_shr(sc->e, sc->e, n, 1);
+    }
+}
+
+// With w = a^((q - 1) / 2): x = a w is the first guess and b = x w = a^q
+// the error, of order 2^i. x g with g = z^(q 2^(s - i - 1)) squares the
+// error's order down, and since every later g is a power of z^q the
+// table lookup replaces the running c of the textbook loop. An error of
+// order 2^s means a was not a square.
+static int sqrt_tonelli(const mont_ctx *ctx, const mont_sqrt_ctx *sc, limb_t *r, const limb_t *a)
+{
+    size_t n = ctx->n, m = sc->s;
+    limb_t w[BN_MAX_LIMBS], x[BN_MAX_LIMBS], b[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+    mont_exp(ctx, w, a, sc->e, n);
+    mont_mul(ctx, x, a, w);
+    mont_mul(ctx, b, x, w);
+    while (bn_cmp(b, ctx->one, n) != 0)
+    {
+        size_t i = 0;
+        bn_copy(t, b, n);
+        do
+        {
+            mont_sqr(ctx, t, t);
+            i++;
+        } while (bn_cmp(t, ctx->one, n) != 0 && i < m);
+        if (i == m)
+        {
+            return 0;
+        }
+        mont_mul(ctx, x, x, sc->roots[sc->s - i - 1]);
+        mont_mul(ctx, b, b, sc->roots[sc->s - i]);
+        m = i;
+    }
+    bn_copy(r, x, n);
+    return 1;
+}
+
+// (t + w)^((p + 1) / 2) in GF(p^2) = GF(p)[w] / (w^2 - d), where
+// d = t^2 - a is a nonsquare; the w part vanishes when a is a square.
+static int sqrt_cipolla(const mont_ctx *ctx, const mont_sqrt_ctx *sc, limb_t *r, const limb_t *a)
+{
+    size_t n = ctx->n;
+    limb_t t[BN_MAX_LIMBS], d[BN_MAX_LIMBS], x0[BN_MAX_LIMBS], x1[BN_MAX_LIMBS];
+    limb_t u[BN_MAX_LIMBS], v[BN_MAX_LIMBS];
+
+    if (bn_jacobi(a, ctx->m, n) != 1)
+    {
+        return 0;
+    }
+    bn_copy(t, ctx->one, n);
+    for (;;)
+    {
+        mont_sqr(ctx, d, t);
+        mont_sub(ctx, d, d, a);
+        if (bn_jacobi(d, ctx->m, n) == -1)
+        {
+            break;
+        }
+        mont_add(ctx, t, t, ctx->one);
+    }
+
+    bn_copy(x0, t, n);
+    bn_copy(x1, ctx->one, n);
+    for (size_t i = bn_bits(sc->e, n) - 1; i-- > 0;)
+    {
+        // (x0 + x1 w)^2 = x0^2 + d x1^2 + 2 x0 x1 w
+        mont_mul(ctx, u, x0, x1);
+        mont_sqr(ctx, x0, x0);
+        mont_sqr(ctx, x1, x1);
+        mont_mul(ctx, x1, x1, d);
+        mont_add(ctx, x0, x0, x1);
+        mont_add(ctx, x1, u, u);
+        if (bn_bit(sc->e, i))
+        {
+            // (x0 + x1 w)(t + w) = t x0 + d x1 + (x0 + t x1) w
+            mont_mul(ctx, u, t, x0);
+            mont_mul(ctx, v, d, x1);
+            mont_mul(ctx, x1, t, x1);
+            mont_add(ctx, x1, x1, x0);
+            mont_add(ctx, x0, u, v);
+        }
+    }
+    bn_copy(r, x0, n);
+    return 1;
+}
+
+// Returns 0, leaving r unspecified, when a is not a square mod p.
+int mont_sqrt(const mont_ctx *ctx, const mont_sqrt_ctx *sc, limb_t *r, const limb_t *a)
+{
+    size_t n = ctx->n;
+    limb_t x[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+    if (bn_is_zero(a, n))
+    {
+        bn_zero(r, n);
+        return 1;
+    }
+    switch (sc->method)
+    {
+    case MODSQRT_3MOD4:
+        mont_exp(ctx, x, a, sc->e, n);
+        break;
+    case MODSQRT_5MOD8:
+        // Atkin: with b = (2a)^((p - 5) / 8), i = 2a b^2 is a square root
+        // of -1 and a b (i - 1) one of a.
+        mont_add(ctx, t, a, a);
+        mont_exp(ctx, x, t, sc->e, n);
+        mont_mul(ctx, t, t, x);
+        mont_mul(ctx, t, t, x);
+        mont_sub(ctx, t, t, ctx->one);
+        mont_mul(ctx, x, x, a);
+        mont_mul(ctx, x, x, t);
+        break;
+    case MODSQRT_TONELLI:
+        return sqrt_tonelli(ctx, sc, r, a);
+    default:
+        if (!sqrt_cipolla(ctx, sc, x, a))
+        {
+            return 0;
+        }
+        break;
+    }
+    mont_sqr(ctx, t, x);
+    if (bn_cmp(t, a, n) != 0)
+    {
+        return 0;
+    }
+    bn_copy(r, x, n);
+    return 1;
+}
+
+static void sqrt_range(size_t begin, size_t end, void *ctx)
+{
+    sqrt_batch_job *job = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (job->ok[i])
+        {
+            job->ok[i] = mont_sqrt(job->ctx, job->sc, job->r + i * BN_MAX_LIMBS, job->a + i * BN_MAX_LIMBS);
+        }
+    }
+}
+
+// Roots of many candidates (spaced BN_MAX_LIMBS apart, r may alias a);
+// ok[i] says whether a[i] was a square and the return value counts them.
+// The Jacobi screen costs far less than an exponentiation, so the
+// nonsquares, about half of random candidates, never reach one; the
+// squares are rooted on the shared pool.
+size_t mont_sqrt_batch(const mont_ctx *ctx, const mont_sqrt_ctx *sc, limb_t *r, int *ok, const limb_t *a,
+                       size_t count)
+{
+    sqrt_batch_job job = {ctx, sc, r, ok, a};
+    size_t squares = 0;
+
+    bn_jacobi_batch(ok, a, ctx->m, ctx->n, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        ok[i] = ok[i] >= 0;
+        squares += (size_t)ok[i];
+    }
+    parallel_for(NULL, 0, count, MODSQRT_GRAIN, sqrt_range, &job, NULL);
+    return squares;
+}
@@ -0,0 +1,49 @@
+#ifndef MODSQRT_ /* Include guard */
+#define MODSQRT_
+
+#include "bignum.h"
+
+// Square roots and quadratic residuosity mod an odd prime p. Everything
+// that depends only on p is worked out once by mont_sqrt_init, which also
+// picks the method: one exponentiation for p = 3 mod 4 and (Atkin) for
+// p = 5 mod 8, Tonelli-Shanks with the powers z^(q 2^i) of a cached
+// nonresidue otherwise, and Cipolla when the 2-adicity of p - 1 outgrows
+// that table. Roots are in Montgomery form in and out.
+//
+// bn_jacobi is a variable-time binary Jacobi symbol on plain integers; it
+// costs a few shifts and subtractions per bit rather than an
+// exponentiation, so it is the residuosity test for public values. Since
+// R is an even power of 2, a Montgomery-form value has the same symbol
+// as the plain one.
+
+#define MODSQRT_TABLE 32
+
+enum
+{
+    MODSQRT_3MOD4,
+    MODSQRT_5MOD8,
+    MODSQRT_TONELLI,
+    MODSQRT_CIPOLLA
+};
+
+typedef struct
+{
+    int method;
+    size_t s;                 // p - 1 = q 2^s with q odd
+    limb_t e[BN_MAX_LIMBS];   // (p + 1) / 4, (p - 5) / 8, (q - 1) / 2 or (p + 1) / 2 by method
+    limb_t two[BN_MAX_LIMBS]; // Montgomery form
+    limb_t roots[MODSQRT_TABLE][BN_MAX_LIMBS]; // z^(q 2^i), Montgomery form, Tonelli-Shanks only
+} mont_sqrt_ctx;
+
+int bn_jacobi(const limb_t *a, const limb_t *m, size_t n);
+
+void bn_jacobi_batch(int *r, const limb_t *a, const limb_t *m, size_t n, size_t count);
+
+void mont_sqrt_init(mont_sqrt_ctx *sc, const mont_ctx *ctx);
+
+int mont_sqrt(const mont_ctx *ctx, const mont_sqrt_ctx *sc, limb_t *r, const limb_t *a);
+
+size_t mont_sqrt_batch(const mont_ctx *ctx, const mont_sqrt_ctx *sc, limb_t *r, int *ok, const limb_t *a,
+                       size_t count);
+
+#endif // MODSQRT_
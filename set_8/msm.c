@@ -0,0 +1,337 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "msm.h"
+#include "../common/thread_pool.h"
+
+#define MSM_RECODE_GRAIN 1024
+
+typedef struct
+{
+    const ec_curve *curve;
+    const ec_affine *points;
+    const limb_t *k;
+    size_t kn;
+    size_t count;
+    unsigned c;
+    size_t windows;
+    int32_t *digits;   // digit of point i in window w at w * count + i
+    ec_jacobian *sums; // one per window
+} msm_job;
+
+// The c that minimizes windows times (point additions + bucket work).
+// A bucket costs two Jacobian additions in the running sum, each about
+// twice an affine point addition.
+unsigned msm_window(size_t count, size_t bits)
+{
+    unsigned best = 1;
+    size_t best_cost = SIZE_MAX;
+    for (unsigned c = 1; c <= MSM_MAX_WINDOW; c++)
+    {
+        size_t cost = (bits / c + 1) * (count + ((size_t)1 << (c + 1)));
+        if (cost < best_cost)
+        {
+            best = c;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+static size_t window_bits(const limb_t *k, size_t kn, size_t bit, unsigned c)
+{
+    size_t limb = bit / BN_LIMB_BITS, shift = bit % BN_LIMB_BITS;
+    if (limb >= kn)
+    {
+        return 0;
+    }
+    limb_t v = k[limb] >> shift;
+    if (shift + c > BN_LIMB_BITS && limb + 1 < kn)
+    {
+        v |= k[limb + 1] << (BN_LIMB_BITS - shift);
+    }
+    return (size_t)(v & (((limb_t)1 << c) - 1));
+}
+
+// A digit above 2^(c-1) becomes d - 2^c with a carry into the next
+// window. bits / c + 1 windows always absorb the last carry.
+static void recode_range(size_t begin, size_t end, void *arg)
+{
+    msm_job *job = arg;
+    int32_t half = (int32_t)1 << (job->c - 1);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const limb_t *k = job->k + i * BN_MAX_LIMBS;
+        int32_t carry = 0;
+        for (size_t w = 0; w < job->windows; w++)
+        {
+            int32_t d = (int32_t)window_bits(k, job->kn, w * job->c, job->c) + carry;
+            carry = d > half;
+            d -= carry << job->c;
+            job->digits[w * job->count + i] = job->points[i].infinity ? 0 : d;
+        }
+    }
+}
+
+// P or -P after the sign of d; returns the y to use.
+static const limb_t *signed_y(const ec_curve *curve, limb_t *neg, const ec_affine *p, int32_t d)
+{
+    if (d > 0)
+    {
+        return p->y;
+    }
+    mont_neg(&curve->ctx, neg, p->y);
+    return neg;
+}
+
+// sum_b b * bucket[b] for b = 1 .. half as the sum of the suffix sums,
+// from affine buckets, Jacobian ones or both.
+static void bucket_sum(const ec_curve *curve, ec_jacobian *r, const ec_affine *affine, const ec_jacobian *spill,
+                       size_t half)
+{
+    ec_jacobian sum;
+    ec_set_infinity(curve, &sum);
+    ec_set_infinity(curve, r);
+    for (size_t b = half; b > 0; b--)
+    {
+        if (affine != NULL)
+        {
+            ec_add_mixed(curve, &sum, &sum, &affine[b]);
+        }
+        if (spill != NULL)
+        {
+            ec_add(curve, &sum, &sum, &spill[b]);
+        }
+        ec_add(curve, r, r, &sum);
+    }
+}
+
+static ec_jacobian *jacobian_buckets(const ec_curve *curve, size_t half)
+{
+    ec_jacobian *bucket = malloc(sizeof(ec_jacobian) * (half + 1));
+    for (size_t b = 1; b <= half; b++)
+    {
+        ec_set_infinity(curve, &bucket[b]);
+    }
+    return bucket;
+}
+
+static void add_jacobian(const ec_curve *curve, ec_jacobian *bucket, const ec_affine *p, int32_t d)
+{
+    ec_affine q;
+    if (d > 0)
+    {
+        ec_add_mixed(curve, &bucket[d], &bucket[d], p);
+        return;
+    }
+    ec_affine_neg(curve, &q, p);
+    ec_add_mixed(curve, &bucket[-d], &bucket[-d], &q);
+}
+
+static void window_jacobian(const msm_job *job, ec_jacobian *r, const int32_t *digits)
+{
+    size_t half = (size_t)1 << (job->c - 1);
+    ec_jacobian *bucket = jacobian_buckets(job->curve, half);
+
+    for (size_t i = 0; i < job->count; i++)
+    {
+        if (digits[i] != 0)
+        {
+            add_jacobian(job->curve, bucket, &job->points[i], digits[i]);
+        }
+    }
+    bucket_sum(job->curve, r, NULL, bucket, half);
+    free(bucket);
+}
+
+// One round: at most one addition per bucket, and at most
+// MSM_AFFINE_BATCH of them. Empty buckets take the point as it is and
+// P + (-P) empties a bucket, neither needing a slope; the rest queue
+// their denominator, x_P - x_B or 2 y_B for a doubling, and are finished
+// after the shared inversion. Entries that could not be placed go to
+// deferred; returns how many.
+static size_t affine_round(const msm_job *job, ec_affine *bucket, size_t *stamp, size_t round, const int32_t *digits,
+                           const size_t *pending, size_t npending, size_t *deferred, limb_t *den, size_t *slot,
+                           size_t *nslots)
+{
+    const ec_curve *curve = job->curve;
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n, ndeferred = 0, slots = 0;
+    limb_t neg[BN_MAX_LIMBS], lambda[BN_MAX_LIMBS], t[BN_MAX_LIMBS], x3[BN_MAX_LIMBS];
+
+    for (size_t j = 0; j < npending; j++)
+    {
+        size_t i = pending[j];
+        int32_t d = digits[i];
+        size_t b = (size_t)(d > 0 ? d : -d);
+        const ec_affine *p = &job->points[i];
+        ec_affine *bk = &bucket[b];
+
+        if (slots == MSM_AFFINE_BATCH || stamp[b] == round)
+        {
+            deferred[ndeferred++] = i;
+            continue;
+        }
+        const limb_t *py = signed_y(curve, neg, p, d);
+        if (bk->infinity)
+        {
+            bn_copy(bk->x, p->x, n);
+            bn_copy(bk->y, py, n);
+            bk->infinity = 0;
+            continue;
+        }
+        limb_t *slot_den = den + slots * BN_MAX_LIMBS;
+        if (bn_cmp(bk->x, p->x, n) != 0)
+        {
+            mont_sub(ctx, slot_den, p->x, bk->x);
+        }
+        else if (bn_cmp(bk->y, py, n) == 0 && !bn_is_zero(py, n))
+        {
+            mont_add(ctx, slot_den, py, py);
+        }
+        else
+        {
+            bk->infinity = 1;
+            continue;
+        }
+        stamp[b] = round;
+        slot[slots++] = i;
+    }
+
+    ec_field_inv_batch(curve, den, den, slots);
+    for (size_t s = 0; s < slots; s++)
+    {
+        size_t i = slot[s];
+        int32_t d = digits[i];
+        const ec_affine *p = &job->points[i];
+        ec_affine *bk = &bucket[d > 0 ? d : -d];
+        const limb_t *py = signed_y(curve, neg, p, d);
+
+        if (bn_cmp(bk->x, p->x, n) != 0)
+        {
+            mont_sub(ctx, lambda, py, bk->y);
+        }
+        else
+        {
+            mont_sqr(ctx, lambda, bk->x);
+            mont_add(ctx, t, lambda, lambda);
+            mont_add(ctx, lambda, lambda, t);
+            mont_add(ctx, lambda, lambda, curve->a);
+        }
+        mont_mul(ctx, lambda, lambda, den + s * BN_MAX_LIMBS);
+        mont_sqr(ctx, x3, lambda);
+        mont_sub(ctx, x3, x3, bk->x);
+        mont_sub(ctx, x3, x3, p->x);
+        mont_sub(ctx, t, bk->x, x3);
+        mont_mul(ctx, t, t, lambda);
+        mont_sub(ctx, bk->y, t, bk->y);
+        bn_copy(bk->x, x3, n);
+    }
+    *nslots = slots;
+    return ndeferred;
+}
+
+// Rounds of affine_round until every point is in; once a round with
+// entries left over fills fewer than MSM_AFFINE_ROUND_MIN slots, as when
+// many digits repeat, the rest go into Jacobian buckets.
+static void window_affine(const msm_job *job, ec_jacobian *r, const int32_t *digits)
+{
+    const ec_curve *curve = job->curve;
+    size_t half = (size_t)1 << (job->c - 1), npending = 0, round = 0;
+    ec_affine *bucket = malloc(sizeof(ec_affine) * (half + 1));
+    size_t *stamp = calloc(half + 1, sizeof(size_t));
+    size_t *pending = malloc(sizeof(size_t) * job->count), *deferred = malloc(sizeof(size_t) * job->count);
+    size_t *slot = malloc(sizeof(size_t) * MSM_AFFINE_BATCH);
+    limb_t *den = malloc(sizeof(limb_t) * BN_MAX_LIMBS * MSM_AFFINE_BATCH);
+    ec_jacobian *spill = NULL;
+
+    for (size_t b = 1; b <= half; b++)
+    {
+        bucket[b].infinity = 1;
+    }
+    for (size_t i = 0; i < job->count; i++)
+    {
+        if (digits[i] != 0)
+        {
+            pending[npending++] = i;
+        }
+    }
+    while (npending > 0)
+    {
+        size_t slots, *swap;
+        npending = affine_round(job, bucket, stamp, ++round, digits, pending, npending, deferred, den, slot, &slots);
+        swap = pending;
+        pending = deferred;
+        deferred = swap;
+        if (npending > 0 && slots < MSM_AFFINE_ROUND_MIN)
+        {
+            spill = jacobian_buckets(curve, half);
+            for (size_t j = 0; j < npending; j++)
+            {
+                add_jacobian(curve, spill, &job->points[pending[j]], digits[pending[j]]);
+            }
+            npending = 0;
+        }
+    }
+    bucket_sum(curve, r, bucket, spill, half);
+
+    free(spill);
+    free(den);
+    free(slot);
+    free(deferred);
+    free(pending);
+    free(stamp);
+    free(bucket);
+}
+
+static void window_range(size_t begin, size_t end, void *arg)
+{
+    msm_job *job = arg;
+    for (size_t w = begin; w < end; w++)
+    {
+        const int32_t *digits = job->digits + w * job->count;
+        if (job->count < MSM_AFFINE_MIN)
+        {
+            window_jacobian(job, &job->sums[w], digits);
+        }
+        else
+        {
+            window_affine(job, &job->sums[w], digits);
+        }
+    }
+}
+
+// Scalars spaced BN_MAX_LIMBS apart; points at infinity contribute
+// nothing.
+void ec_msm(const ec_curve *curve, ec_jacobian *r, const ec_affine *points, const limb_t *k, size_t kn, size_t count)
+{
+    size_t bits = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t b = bn_bits(k + i * BN_MAX_LIMBS, kn);
+        bits = b > bits ? b : bits;
+    }
+    ec_set_infinity(curve, r);
+    if (bits == 0)
+    {
+        return;
+    }
+
+    unsigned c = msm_window(count, bits);
+    msm_job job = {curve, points, k, kn, count, c, bits / c + 1, NULL, NULL};
+    job.digits = malloc(sizeof(int32_t) * job.windows * count);
+    job.sums = malloc(sizeof(ec_jacobian) * job.windows);
+    parallel_for(NULL, 0, count, MSM_RECODE_GRAIN, recode_range, &job, NULL);
+    parallel_for(NULL, 0, job.windows, 1, window_range, &job, NULL);
+
+    for (size_t w = job.windows; w-- > 0;)
+    {
+        for (unsigned j = 0; j < c; j++)
+        {
+            ec_double(curve, r, r);
+        }
+        ec_add(curve, r, r, &job.sums[w]);
+    }
+    free(job.sums);
+    free(job.digits);
+}
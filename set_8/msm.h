@@ -0,0 +1,34 @@
+#ifndef MSM_ /* Include guard */
+#define MSM_
+
+#include "ec.h"
+
+// Multi-scalar multiplication sum k_i P_i by Pippenger's bucket method.
+// The scalars are recoded into signed c-bit digits in
+// [-2^(c-1) + 1, 2^(c-1)], so a window needs only 2^(c-1) buckets and a
+// negative digit adds -P_i, which is free in affine form. For each window
+// every point goes once into the bucket named by its digit; a running
+// sum then weighs the buckets by 1 .. 2^(c-1), and the windows are joined
+// by c doublings each. msm_window picks c from the point count and the
+// scalar length, trading bits / c windows of count additions each against
+// the 2^(c-1) buckets each window has to sum.
+//
+// From MSM_AFFINE_MIN points on, buckets are kept affine and filled in
+// rounds of up to MSM_AFFINE_BATCH additions, one per bucket, whose
+// slope denominators share a single inversion; an affine addition then
+// costs a handful of multiplications against the eleven of a mixed
+// Jacobian one. Additions that hit a bucket already busy in the round
+// wait for the next one, and when too few are left to pay for the
+// inversion they go into Jacobian buckets instead. The windows are
+// independent and run on the shared pool.
+
+#define MSM_MAX_WINDOW 16
+#define MSM_AFFINE_MIN 256
+#define MSM_AFFINE_BATCH 1024
+#define MSM_AFFINE_ROUND_MIN 32
+
+unsigned msm_window(size_t count, size_t bits);
+
+void ec_msm(const ec_curve *curve, ec_jacobian *r, const ec_affine *points, const limb_t *k, size_t kn, size_t count);
+
+#endif // MSM_
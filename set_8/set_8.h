@@ -0,0 +1,24 @@
+#ifndef SET_8_ /* Include guard */
+#define SET_8_
+
+#include "bignum.h"
+#include "crt.h"
+#include "dh.h"
+#include "dlog.h"
+#include "dp_store.h"
+#include "ec.h"
+#include "ecdsa.h"
+#include "factor.h"
+#include "invalid_curve.h"
+#include "kangaroo.h"
+#include "ladder.h"
+#include "ladder_batch.h"
+#include "modexp.h"
+#include "modinv.h"
+#include "modsqrt.h"
+#include "msm.h"
+#include "sha256.h"
+#include "subgroup.h"
+#include "twist.h"
+
+#endif // SET_8_
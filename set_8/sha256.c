@@ -0,0 +1,318 @@
+#include <pthread.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#include "sha256.h"
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+typedef void (*sha256_kernel)(uint32_t state[8], const unsigned char *blocks, size_t count);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                               0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+static void sha256_schedule(uint32_t w[64], const unsigned char *block)
+{
+    for (int t = 0; t < 16; t++)
+    {
+        w[t] = (uint32_t)block[4 * t] << 24 | (uint32_t)block[4 * t + 1] << 16 |
+               (uint32_t)block[4 * t + 2] << 8 | block[4 * t + 3];
+    }
+    for (int t = 16; t < 64; t++)
+    {
+        uint32_t s0 = ROTR(w[t - 15], 7) ^ ROTR(w[t - 15], 18) ^ (w[t - 15] >> 3);
+        uint32_t s1 = ROTR(w[t - 2], 17) ^ ROTR(w[t - 2], 19) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+}
+
+static void sha256_rounds(uint32_t state[8], const uint32_t w[64])
+{
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; t++)
+    {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static void sha256_compress_portable(uint32_t state[8], const unsigned char *blocks, size_t count)
+{
+    uint32_t w[64];
+    for (size_t i = 0; i < count; i++)
+    {
+        sha256_schedule(w, blocks + i * SHA256_BLOCK_SIZE);
+        sha256_rounds(state, w);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SHA extensions keep the state as ABEF/CDGH and run two rounds per
+// sha256rnds2; sha256msg1/msg2 extend the schedule four words at a time.
+__attribute__((target("sha,sse4.1"))) static void sha256_compress_shani(uint32_t state[8], const unsigned char *blocks,
+                                                                        size_t count)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const unsigned char *block = blocks + i * SHA256_BLOCK_SIZE;
+        __m128i abef = state0, cdgh = state1;
+        __m128i w[16];
+        for (int g = 0; g < 16; g++)
+        {
+            if (g < 4)
+            {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + 16 * g)), mask);
+            }
+            else
+            {
+                __m128i x = _mm_add_epi32(_mm_sha256msg1_epu32(w[g - 4], w[g - 3]), _mm_alignr_epi8(w[g - 1], w[g - 2], 4));
+                w[g] = _mm_sha256msg2_epu32(x, w[g - 1]);
+            }
+            __m128i msg = _mm_add_epi32(w[g], _mm_loadu_si128((const __m128i *)&K[4 * g]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+#endif
+
+static sha256_kernel kernel_selected;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void init_kernel(void)
+{
+    kernel_selected = sha256_compress_portable;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 29)) &&
+        __get_cpuid(1, &a, &b, &c, &d) && (c & (1u << 19)))
+    {
+        kernel_selected = sha256_compress_shani;
+    }
+#endif
+}
+
+// Reached from pool workers, so the one-time probe runs under
+// pthread_once.
+static sha256_kernel select_kernel(void)
+{
+    pthread_once(&kernel_once, init_kernel);
+    return kernel_selected;
+}
+
+void sha256_compress(uint32_t state[8], const unsigned char *blocks, size_t count)
+{
+    select_kernel()(state, blocks, count);
+}
+
+void sha256_init(sha256_ctx *ctx)
+{
+    memcpy(ctx->state, IV, sizeof(IV));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+void sha256_update(sha256_ctx *ctx, const unsigned char *data, size_t len)
+{
+    ctx->length += len;
+    if (ctx->used > 0)
+    {
+        size_t take = SHA256_BLOCK_SIZE - ctx->used < len ? SHA256_BLOCK_SIZE - ctx->used : len;
+        memcpy(ctx->buffer + ctx->used, data, take);
+        ctx->used += take;
+        data += take;
+        len -= take;
+        if (ctx->used < SHA256_BLOCK_SIZE)
+        {
+            return;
+        }
+        sha256_compress(ctx->state, ctx->buffer, 1);
+        ctx->used = 0;
+    }
+    if (len >= SHA256_BLOCK_SIZE)
+    {
+        sha256_compress(ctx->state, data, len / SHA256_BLOCK_SIZE);
+        data += len / SHA256_BLOCK_SIZE * SHA256_BLOCK_SIZE;
+        len %= SHA256_BLOCK_SIZE;
+    }
+    memcpy(ctx->buffer, data, len);
+    ctx->used = len;
+}
+
+static void put_be64(unsigned char *out, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (unsigned char)(v >> (56 - 8 * i));
+    }
+}
+
+static void put_state(unsigned char *digest, const uint32_t state[8])
+{
+    for (int i = 0; i < 8; i++)
+    {
+        digest[4 * i] = (unsigned char)(state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char)(state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char)(state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char)state[i];
+    }
+}
+
+void sha256_final(sha256_ctx *ctx, unsigned char *digest)
+{
+    unsigned char pad[2 * SHA256_BLOCK_SIZE] = {0x80};
+    size_t padlen = (ctx->used < 56 ? 56 : 120) - ctx->used;
+    uint64_t bits = ctx->length * 8;
+    sha256_update(ctx, pad, padlen);
+    put_be64(pad, bits);
+    sha256_update(ctx, pad, 8);
+    put_state(digest, ctx->state);
+}
+
+void sha256(unsigned char *digest, const unsigned char *data, size_t len)
+{
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+}
+
+static void hmac_key_block(unsigned char *block, const unsigned char *key, size_t key_len)
+{
+    memset(block, 0, SHA256_BLOCK_SIZE);
+    if (key_len > SHA256_BLOCK_SIZE)
+    {
+        sha256(block, key, key_len);
+    }
+    else
+    {
+        memcpy(block, key, key_len);
+    }
+}
+
+static void hmac_pad_state(uint32_t state[8], const unsigned char *key_block, unsigned char pad)
+{
+    unsigned char block[SHA256_BLOCK_SIZE];
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        block[i] = key_block[i] ^ pad;
+    }
+    memcpy(state, IV, sizeof(IV));
+    sha256_compress(state, block, 1);
+}
+
+void hmac_sha256(unsigned char *mac, const unsigned char *key, size_t key_len, const unsigned char *msg, size_t len)
+{
+    unsigned char key_block[SHA256_BLOCK_SIZE];
+    unsigned char inner[SHA256_DIGEST_SIZE];
+    sha256_ctx ctx;
+
+    hmac_key_block(key_block, key, key_len);
+    hmac_pad_state(ctx.state, key_block, 0x36);
+    ctx.length = SHA256_BLOCK_SIZE;
+    ctx.used = 0;
+    sha256_update(&ctx, msg, len);
+    sha256_final(&ctx, inner);
+
+    hmac_pad_state(ctx.state, key_block, 0x5c);
+    ctx.length = SHA256_BLOCK_SIZE;
+    ctx.used = 0;
+    sha256_update(&ctx, inner, sizeof(inner));
+    sha256_final(&ctx, mac);
+}
+
+// Returns 0 if the padded message needs more than HMAC_FIXED_MAX_BLOCKS.
+int hmac_sha256_fixed_init(hmac_sha256_fixed *fixed, const unsigned char *msg, size_t len)
+{
+    size_t blocks = (len + 9 + SHA256_BLOCK_SIZE - 1) / SHA256_BLOCK_SIZE;
+    if (blocks > HMAC_FIXED_MAX_BLOCKS)
+    {
+        return 0;
+    }
+
+    unsigned char *inner = fixed->block[0];
+    memset(fixed->block, 0, sizeof(fixed->block));
+    memcpy(inner, msg, len);
+    inner[len] = 0x80;
+    put_be64(inner + blocks * SHA256_BLOCK_SIZE - 8, (uint64_t)(SHA256_BLOCK_SIZE + len) * 8);
+    fixed->blocks = blocks;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        sha256_schedule(fixed->schedule[i], fixed->block[i]);
+    }
+
+    memset(fixed->outer_block, 0, sizeof(fixed->outer_block));
+    fixed->outer_block[SHA256_DIGEST_SIZE] = 0x80;
+    put_be64(fixed->outer_block + SHA256_BLOCK_SIZE - 8, (uint64_t)(SHA256_BLOCK_SIZE + SHA256_DIGEST_SIZE) * 8);
+    return 1;
+}
+
+void hmac_sha256_fixed_mac(const hmac_sha256_fixed *fixed, unsigned char *mac, const unsigned char *key, size_t key_len)
+{
+    unsigned char key_block[SHA256_BLOCK_SIZE];
+    unsigned char outer[SHA256_BLOCK_SIZE];
+    uint32_t state[8];
+    sha256_kernel kernel = select_kernel();
+
+    hmac_key_block(key_block, key, key_len);
+    hmac_pad_state(state, key_block, 0x36);
+    if (kernel == sha256_compress_portable)
+    {
+        for (size_t i = 0; i < fixed->blocks; i++)
+        {
+            sha256_rounds(state, fixed->schedule[i]);
+        }
+    }
+    else
+    {
+        kernel(state, fixed->block[0], fixed->blocks);
+    }
+
+    memcpy(outer, fixed->outer_block, SHA256_BLOCK_SIZE);
+    put_state(outer, state);
+    hmac_pad_state(state, key_block, 0x5c);
+    kernel(state, outer, 1);
+    put_state(mac, state);
+}
@@ -0,0 +1,47 @@
+#ifndef SHA256_ /* Include guard */
+#define SHA256_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_SIZE 32
+#define HMAC_FIXED_MAX_BLOCKS 4
+
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char buffer[SHA256_BLOCK_SIZE];
+    size_t used;
+} sha256_ctx;
+
+// HMAC over a message that stays fixed while the key changes, as in a
+// brute-force over candidate shared secrets: the padded inner message
+// blocks, their expanded message schedules and the padded outer block are
+// built once, so each MAC is just the four compressions.
+typedef struct
+{
+    size_t blocks;
+    unsigned char block[HMAC_FIXED_MAX_BLOCKS][SHA256_BLOCK_SIZE];
+    uint32_t schedule[HMAC_FIXED_MAX_BLOCKS][64];
+    unsigned char outer_block[SHA256_BLOCK_SIZE];
+} hmac_sha256_fixed;
+
+void sha256_compress(uint32_t state[8], const unsigned char *blocks, size_t count);
+
+void sha256_init(sha256_ctx *ctx);
+
+void sha256_update(sha256_ctx *ctx, const unsigned char *data, size_t len);
+
+void sha256_final(sha256_ctx *ctx, unsigned char *digest);
+
+void sha256(unsigned char *digest, const unsigned char *data, size_t len);
+
+void hmac_sha256(unsigned char *mac, const unsigned char *key, size_t key_len, const unsigned char *msg, size_t len);
+
+int hmac_sha256_fixed_init(hmac_sha256_fixed *fixed, const unsigned char *msg, size_t len);
+
+void hmac_sha256_fixed_mac(const hmac_sha256_fixed *fixed, unsigned char *mac, const unsigned char *key, size_t key_len);
+
+#endif // SHA256_
@@ -0,0 +1,95 @@
+#include <stdatomic.h>
+#include <string.h>
+#include "modexp.h"
+#include "subgroup.h"
+#include "../common/thread_pool.h"
+
+#define RESIDUE_MIN_GRAIN 256
+#define RESIDUE_CANCEL_POLL 1024
+
+typedef struct
+{
+    const dh_group *grp;
+    hmac_sha256_fixed mac;
+    const unsigned char *tag;
+    limb_t h[BN_MAX_LIMBS];      // plain
+    limb_t h_mont[BN_MAX_LIMBS]; // h * R, so mont_mul(x, h_mont) = x * h
+    atomic_long found;
+    cancel_token cancel;
+} residue_job;
+
+// h := rand(1, p)^((p-1)/r) until h != 1. Returns 0 if r does not divide p-1.
+int dh_subgroup_element(const dh_group *grp, limb_t *h, limb_t r)
+{
+    size_t n = grp->n;
+    limb_t pm1[BN_MAX_LIMBS], e[BN_MAX_LIMBS], a[BN_MAX_LIMBS];
+
+    bn_sub_word(pm1, grp->p, n, 1);
+    if (bn_div_word(e, pm1, n, r) != 0)
+    {
+        return 0;
+    }
+    do
+    {
+        bn_random_below(a, pm1, n);
+        bn_add_word(a, a, n, 1);
+        mod_exp(&grp->ctx, h, a, e, n);
+    } while (bn_cmp_word(h, n, 1) == 0);
+    return 1;
+}
+
+// Each leaf pays one exponentiation to reach h^begin, then walks h^k in
+// the plain domain with one Montgomery multiplication per candidate.
+static void search_range(size_t begin, size_t end, void *ctx)
+{
+    residue_job *job = ctx;
+    const dh_group *grp = job->grp;
+    size_t n = grp->n;
+    limb_t x[BN_MAX_LIMBS], e[BN_MAX_LIMBS];
+    unsigned char key[BN_MAX_LIMBS * sizeof(limb_t)];
+    unsigned char mac[SHA256_DIGEST_SIZE];
+
+    bn_set_word(e, n, begin);
+    mod_exp(&grp->ctx, x, job->h, e, n);
+    for (size_t k = begin; k < end; k++)
+    {
+        if ((k - begin) % RESIDUE_CANCEL_POLL == 0 && cancel_requested(&job->cancel))
+        {
+            return;
+        }
+        bn_to_bytes(key, grp->bytes, x, n);
+        hmac_sha256_fixed_mac(&job->mac, mac, key, grp->bytes);
+        if (memcmp(mac, job->tag, SHA256_DIGEST_SIZE) == 0)
+        {
+            atomic_store(&job->found, (long)k);
+            cancel_request(&job->cancel);
+            return;
+        }
+        mont_mul(&grp->ctx, x, x, job->h_mont);
+    }
+}
+
+// Finds k in [0, r) with MAC(h^k, msg) = tag, i.e. the victim's secret mod
+// r when h has order r. Returns -1 if no k matches.
+long dh_residue_search(const dh_group *grp, const limb_t *h, limb_t r, const unsigned char *tag,
+                       const unsigned char *msg, size_t len)
+{
+    residue_job job;
+    thread_pool *pool = thread_pool_shared();
+
+    job.grp = grp;
+    job.tag = tag;
+    if (!hmac_sha256_fixed_init(&job.mac, msg, len))
+    {
+        return -1;
+    }
+    bn_copy(job.h, h, grp->n);
+    mont_to(&grp->ctx, job.h_mont, h);
+    atomic_init(&job.found, -1);
+    cancel_token_init(&job.cancel);
+
+    size_t grain = r / (thread_pool_size(pool) * 8);
+    grain = grain > RESIDUE_MIN_GRAIN ? grain : RESIDUE_MIN_GRAIN;
+    parallel_for(pool, 0, r, grain, search_range, &job, &job.cancel);
+    return atomic_load(&job.found);
+}
@@ -0,0 +1,11 @@
+#ifndef SUBGROUP_ /* Include guard */
+#define SUBGROUP_
+
+#include "dh.h"
+
+int dh_subgroup_element(const dh_group *grp, limb_t *h, limb_t r);
+
+long dh_residue_search(const dh_group *grp, const limb_t *h, limb_t r, const unsigned char *tag,
+                       const unsigned char *msg, size_t len);
+
+#endif // SUBGROUP_
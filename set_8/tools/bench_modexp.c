@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../dh.h"
+#include "../modexp.h"
+
+// Modular exponentiation timings on challenge 57's group.
+//
+//     bench_modexp [iterations]
+//
+// Exponents are random and below q (128 bits), as in the subgroup
+// attacks. Plain left-to-right square-and-multiply is the baseline for
+// the sliding window, the fixed-base comb and the pooled batch, whose
+// results are checked against it on the way.
+
+#define BENCH_INPUTS 64
+
+static const char *p_str = "7199773997391911030609999317773941274322764333428698921736339643928346453700085358802973900485592910475480089726140708102474957429903531369589969318716771";
+static const char *g_str = "4565356397095740655436854503483826832136106141639563487732438195343690437606117828318042418238184896212352329118608100083187535033402010599512641674644143";
+static const char *q_str = "236234353446506858198510045061214171961";
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// One squaring per bit and one multiplication per set bit.
+static void square_multiply(const mont_ctx *ctx, limb_t *r, const limb_t *base, const limb_t *e, size_t en)
+{
+    bn_copy(r, ctx->one, ctx->n);
+    for (size_t i = bn_bits(e, en); i-- > 0;)
+    {
+        mont_sqr(ctx, r, r);
+        if (bn_bit(e, i))
+        {
+            mont_mul(ctx, r, r, base);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = argc > 1 ? strtoull(argv[1], NULL, 0) : 4096;
+    static limb_t exps[BENCH_INPUTS][BN_MAX_LIMBS], expected[BENCH_INPUTS][BN_MAX_LIMBS];
+    static limb_t batch[BENCH_INPUTS * BN_MAX_LIMBS];
+    limb_t r[BN_MAX_LIMBS];
+    dh_group grp;
+    fixed_base fb;
+
+    if (!dh_group_init(&grp, p_str, g_str, q_str))
+    {
+        printf("Bad group parameters\n");
+        return 1;
+    }
+    const mont_ctx *ctx = &grp.ctx;
+    size_t en = BN_LIMBS(bn_bits(grp.q, grp.n)), bits = bn_bits(grp.q, en);
+    fixed_base_init(&fb, ctx, grp.g, bits, COMB_DEFAULT_TEETH);
+    for (size_t i = 0; i < BENCH_INPUTS; i++)
+    {
+        bn_random_below(exps[i], grp.q, en);
+        square_multiply(ctx, expected[i], grp.g, exps[i], en);
+        mont_exp(ctx, r, grp.g, exps[i], en);
+        int ok = bn_cmp(r, expected[i], grp.n) == 0;
+        fixed_base_exp(&fb, r, exps[i], en);
+        if (!ok || bn_cmp(r, expected[i], grp.n) != 0)
+        {
+            printf("mismatch at input %zu\n", i);
+            return 1;
+        }
+    }
+
+    double start = seconds();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        square_multiply(ctx, r, grp.g, exps[i % BENCH_INPUTS], en);
+    }
+    double plain = (seconds() - start) / (double)iterations;
+    start = seconds();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        mont_exp(ctx, r, grp.g, exps[i % BENCH_INPUTS], en);
+    }
+    double window = (seconds() - start) / (double)iterations;
+    start = seconds();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        fixed_base_exp(&fb, r, exps[i % BENCH_INPUTS], en);
+    }
+    double comb = (seconds() - start) / (double)iterations;
+
+    // The batch wants its exponents packed en limbs apart.
+    limb_t *packed = malloc(sizeof(limb_t) * en * BENCH_INPUTS);
+    for (size_t i = 0; i < BENCH_INPUTS; i++)
+    {
+        bn_copy(packed + i * en, exps[i], en);
+    }
+    size_t rounds = (iterations + BENCH_INPUTS - 1) / BENCH_INPUTS;
+    start = seconds();
+    for (size_t i = 0; i < rounds; i++)
+    {
+        mont_exp_batch(ctx, batch, grp.g, packed, en, BENCH_INPUTS);
+    }
+    double pooled = (seconds() - start) / (double)(rounds * BENCH_INPUTS);
+    for (size_t i = 0; i < BENCH_INPUTS; i++)
+    {
+        if (bn_cmp(batch + i * grp.n, expected[i], grp.n) != 0)
+        {
+            printf("batch mismatch at input %zu\n", i);
+            return 1;
+        }
+    }
+
+    printf("%-24s %12s %9s\n", "method", "us/exp", "speedup");
+    printf("%-24s %12.2f %8.1fx\n", "square-and-multiply", plain * 1e6, 1.0);
+    printf("%-24s %12.2f %8.1fx\n", "sliding window", window * 1e6, plain / window);
+    printf("%-24s %12.2f %8.1fx\n", "fixed-base comb", comb * 1e6, plain / comb);
+    printf("%-24s %12.2f %8.1fx\n", "comb batch (pool)", pooled * 1e6, plain / pooled);
+    free(packed);
+    fixed_base_free(&fb);
+    return 0;
+}
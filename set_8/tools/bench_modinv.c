@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../modexp.h"
+#include "../modinv.h"
+
+// Field inversion timings, Fermat against safegcd.
+//
+//     bench_modinv [iterations]
+//
+// For each size from 128 to 2048 bits, a random odd modulus of exactly
+// that many bits and a batch of random residues below it. Fermat's cost
+// does not depend on the modulus being prime, so the timings stand for
+// any field of that size; the safegcd results are checked against
+// binary Euclid on the way.
+
+#define BENCH_INPUTS 64
+
+static const size_t sizes[] = {128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = argc > 1 ? strtoull(argv[1], NULL, 0) : 256;
+    static limb_t inputs[BENCH_INPUTS][BN_MAX_LIMBS];
+    limb_t m[BN_MAX_LIMBS], bound[BN_MAX_LIMBS], e[BN_MAX_LIMBS], r[BN_MAX_LIMBS], check[BN_MAX_LIMBS];
+    mont_ctx ctx;
+    mont_inv_ctx ic;
+
+    printf("%6s %12s %12s %12s %12s %9s\n", "bits", "fermat us", "binary us", "ct us", "vartime us", "speedup");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        size_t bits = sizes[s], n = BN_LIMBS(bits);
+        bn_zero(bound, n);
+        bound[(bits - 1) / BN_LIMB_BITS] = (limb_t)1 << ((bits - 1) % BN_LIMB_BITS);
+        bn_random_below(m, bound, n);
+        bn_add(m, m, bound, n);
+        m[0] |= 1;
+        mont_init(&ctx, m, n);
+        mont_inv_init(&ic, &ctx);
+        bn_sub_word(e, m, n, 2);
+
+        for (size_t i = 0; i < BENCH_INPUTS; i++)
+        {
+            bn_random_below(inputs[i], m, n);
+            int ok = bn_inv_mod_vartime(check, inputs[i], m, n);
+            bn_inv_safegcd(&ic, r, inputs[i]);
+            if ((ok && bn_cmp(r, check, n) != 0) || bn_inv_safegcd_vartime(&ic, r, inputs[i]) != ok ||
+                (ok && bn_cmp(r, check, n) != 0))
+            {
+                printf("mismatch at %zu bits\n", bits);
+                return 1;
+            }
+        }
+
+        double start = seconds();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            mont_exp(&ctx, r, inputs[i % BENCH_INPUTS], e, n);
+        }
+        double fermat = (seconds() - start) / (double)iterations;
+        start = seconds();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            bn_inv_mod_vartime(r, inputs[i % BENCH_INPUTS], m, n);
+        }
+        double binary = (seconds() - start) / (double)iterations;
+        start = seconds();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            bn_inv_safegcd(&ic, r, inputs[i % BENCH_INPUTS]);
+        }
+        double ct = (seconds() - start) / (double)iterations;
+        start = seconds();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            bn_inv_safegcd_vartime(&ic, r, inputs[i % BENCH_INPUTS]);
+        }
+        double vartime = (seconds() - start) / (double)iterations;
+
+        printf("%6zu %12.2f %12.2f %12.2f %12.2f %8.1fx\n", bits, fermat * 1e6, binary * 1e6, ct * 1e6, vartime * 1e6,
+               fermat / ct);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../msm.h"
+
+// Multi-scalar multiplication timings against one ec_mul per point.
+//
+//     bench_msm [max points]
+//
+// The points are P_i = (i + 1) G on challenge 59's curve, so every result
+// can be checked against a single multiplication by sum (i + 1) k_i mod
+// n. The per-point baseline stops at NAIVE_MAX points; sizes grow by 4x
+// up to the given maximum (default 2^16, memory is about 800 bytes per
+// point).
+
+#define NAIVE_MAX 4096
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max = argc > 1 ? strtoull(argv[1], NULL, 0) : (size_t)1 << 16;
+    ec_curve curve;
+    mont_ctx sc;
+    limb_t sum[BN_MAX_LIMBS], t[BN_MAX_LIMBS], w[BN_MAX_LIMBS];
+    ec_jacobian r, check, p;
+
+    if (!ec_curve_init(&curve, "233970423115425145524320034830162017933", "-95051", "11279326", "182",
+                       "85518893674295321206118380980485522083", "29246302889428143187362802287225875743"))
+    {
+        printf("Bad curve parameters\n");
+        return 1;
+    }
+    mont_init(&sc, curve.order, curve.order_n);
+    size_t kn = curve.order_n;
+
+    ec_affine *points = malloc(sizeof(ec_affine) * max);
+    ec_jacobian *multiples = malloc(sizeof(ec_jacobian) * max);
+    limb_t *k = malloc(sizeof(limb_t) * BN_MAX_LIMBS * max);
+    ec_from_affine(&curve, &p, &curve.base);
+    for (size_t i = 0; i < max; i++)
+    {
+        multiples[i] = p;
+        ec_add_mixed(&curve, &p, &p, &curve.base);
+        bn_random_below(k + i * BN_MAX_LIMBS, curve.order, kn);
+    }
+    ec_to_affine_batch(&curve, points, multiples, max);
+    free(multiples);
+
+    printf("%9s %7s %12s %12s %12s\n", "points", "window", "msm ms", "us/point", "naive us/pt");
+    for (size_t count = 16; count <= max; count *= 4)
+    {
+        bn_zero(sum, kn);
+        for (size_t i = 0; i < count; i++)
+        {
+            bn_set_word(w, kn, i + 1);
+            mont_to(&sc, t, k + i * BN_MAX_LIMBS);
+            mont_mul(&sc, t, t, w);
+            mont_add(&sc, sum, sum, t);
+        }
+        ec_mul(&curve, &check, &curve.base, sum, kn);
+
+        double start = seconds();
+        ec_msm(&curve, &r, points, k, kn, count);
+        double msm = seconds() - start;
+        if (!ec_equal(&curve, &r, &check))
+        {
+            printf("mismatch at %zu points\n", count);
+            return 1;
+        }
+
+        double naive = 0;
+        if (count <= NAIVE_MAX)
+        {
+            start = seconds();
+            ec_set_infinity(&curve, &r);
+            for (size_t i = 0; i < count; i++)
+            {
+                ec_mul(&curve, &p, &points[i], k + i * BN_MAX_LIMBS, kn);
+                ec_add(&curve, &r, &r, &p);
+            }
+            naive = seconds() - start;
+        }
+        printf("%9zu %7u %12.2f %12.2f", count, msm_window(count, bn_bits(curve.order, kn)), msm * 1e3,
+               msm * 1e6 / (double)count);
+        if (count <= NAIVE_MAX)
+        {
+            printf(" %12.2f", naive * 1e6 / (double)count);
+        }
+        printf("\n");
+    }
+    free(k);
+    free(points);
+    return 0;
+}
@@ -0,0 +1,389 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crt.h"
+#include "factor.h"
+#include "ladder_batch.h"
+#include "modexp.h"
+#include "modsqrt.h"
+#include "twist.h"
+#include "../common/thread_pool.h"
+
+typedef struct
+{
+    const mcurve *curve;
+    twist_oracle oracle;
+    void *oracle_ctx;
+    const unsigned char *msg;
+    size_t len;
+    twist_result *result;
+    atomic_int failed;
+} twist_job;
+
+// u plain. Zero and the other roots of u^3 + A u^2 + u lie on both
+// curves, so they do not count.
+int mcurve_on_twist(const mcurve *curve, const limb_t *u)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t um[BN_MAX_LIMBS], rhs[BN_MAX_LIMBS];
+
+    mont_to(ctx, um, u);
+    mont_add(ctx, rhs, um, curve->a);
+    mont_mul(ctx, rhs, rhs, um);
+    mont_add(ctx, rhs, rhs, ctx->one);
+    mont_mul(ctx, rhs, rhs, um);
+    return bn_jacobi(rhs, curve->p, curve->n) == -1;
+}
+
+// HMAC keyed with the shared u, big-endian and bytes long.
+void twist_mac(const mcurve *curve, unsigned char *tag, const limb_t *u, const unsigned char *msg, size_t len)
+{
+    unsigned char key[BN_MAX_LIMBS * sizeof(limb_t)];
+    bn_to_bytes(key, curve->bytes, u, curve->n);
+    hmac_sha256(tag, key, curve->bytes, msg, len);
+}
+
+// A twist point of exactly the given odd order, which must divide the
+// twist order; primes lists the primes dividing order. Candidates are cleared
+// of the cofactor a vector's worth at a time with the shared-scalar
+// batched ladder.
+int twist_point(const mcurve *curve, limb_t *u, limb_t order, const limb_t *primes, size_t prime_count)
+{
+    size_t n = curve->n, lanes = ladder_batch_lanes(curve);
+    limb_t cofactor[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+    if (bn_div_word(cofactor, curve->twist_order, curve->order_n, order) != 0)
+    {
+        return 0;
+    }
+    limb_t *candidates = malloc(sizeof(limb_t) * BN_MAX_LIMBS * lanes);
+    for (;;)
+    {
+        for (size_t i = 0; i < lanes; i++)
+        {
+            limb_t *c = candidates + i * BN_MAX_LIMBS;
+            do
+            {
+                bn_random_below(c, curve->p, n);
+            } while (!mcurve_on_twist(curve, c));
+        }
+        ladder_batch(curve, candidates, candidates, lanes, cofactor, curve->order_n);
+        for (size_t i = 0; i < lanes; i++)
+        {
+            limb_t *c = candidates + i * BN_MAX_LIMBS;
+            int exact = !bn_is_zero(c, n);
+            for (size_t j = 0; j < prime_count && exact; j++)
+            {
+                limb_t k = order / primes[j];
+                ladder(curve, t, c, &k, 1);
+                exact = !bn_is_zero(t, n);
+            }
+            if (exact)
+            {
+                bn_copy(u, c, n);
+                free(candidates);
+                return 1;
+            }
+        }
+    }
+}
+
+static void twist_double(const mcurve *curve, limb_t *x2, limb_t *z2, const limb_t *x, const limb_t *z)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t aa[BN_MAX_LIMBS], bb[BN_MAX_LIMBS], e[BN_MAX_LIMBS];
+    mont_add(ctx, aa, x, z);
+    mont_sqr(ctx, aa, aa);
+    mont_sub(ctx, bb, x, z);
+    mont_sqr(ctx, bb, bb);
+    mont_sub(ctx, e, aa, bb);
+    mont_mul(ctx, x2, aa, bb);
+    mont_mul(ctx, z2, curve->a24, e);
+    mont_add(ctx, z2, z2, bb);
+    mont_mul(ctx, z2, z2, e);
+}
+
+// (x : z) of P + Q from P, Q = (u : 1) and P - Q = (xd : zd).
+static void twist_add(const mcurve *curve, limb_t *x, limb_t *z, const limb_t *xp, const limb_t *zp,
+                      const limb_t *u, const limb_t *xd, const limb_t *zd)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    limb_t s[BN_MAX_LIMBS], t[BN_MAX_LIMBS], v[BN_MAX_LIMBS], w[BN_MAX_LIMBS];
+    mont_sub(ctx, s, xp, zp);
+    mont_add(ctx, t, u, ctx->one);
+    mont_mul(ctx, v, s, t);
+    mont_add(ctx, s, xp, zp);
+    mont_sub(ctx, t, u, ctx->one);
+    mont_mul(ctx, w, s, t);
+    mont_add(ctx, s, v, w);
+    mont_sqr(ctx, s, s);
+    mont_sub(ctx, t, v, w);
+    mont_sqr(ctx, t, t);
+    mont_mul(ctx, x, s, zd);
+    mont_mul(ctx, z, t, xd);
+}
+
+// Finds r in [0, order / 2] with MAC(u(r P)) = tag (the other root is
+// order - r), walking P, 2P, 3P, ... with differential additions and
+// normalizing TWIST_SEARCH multiples per inversion. Returns -1 if none.
+long twist_residue_search(const mcurve *curve, const limb_t *u, limb_t order, const unsigned char *tag,
+                          const unsigned char *msg, size_t len)
+{
+    const mont_ctx *ctx = &curve->ctx;
+    size_t n = curve->n;
+    hmac_sha256_fixed mac;
+    unsigned char key[BN_MAX_LIMBS * sizeof(limb_t)], candidate[SHA256_DIGEST_SIZE];
+    limb_t um[BN_MAX_LIMBS], x[2][BN_MAX_LIMBS], z[2][BN_MAX_LIMBS], xn[BN_MAX_LIMBS], zn[BN_MAX_LIMBS];
+    limb_t t[BN_MAX_LIMBS];
+    limb_t zero[BN_MAX_LIMBS] = {0};
+    long found = -1;
+
+    if (!hmac_sha256_fixed_init(&mac, msg, len))
+    {
+        return -1;
+    }
+    // k = 0 leaves the victim at the identity, which the ladder reports as 0.
+    bn_to_bytes(key, curve->bytes, zero, n);
+    hmac_sha256_fixed_mac(&mac, candidate, key, curve->bytes);
+    if (memcmp(candidate, tag, SHA256_DIGEST_SIZE) == 0)
+    {
+        return 0;
+    }
+
+    limb_t *xs = malloc(sizeof(limb_t) * BN_MAX_LIMBS * TWIST_SEARCH);
+    limb_t *zs = malloc(sizeof(limb_t) * BN_MAX_LIMBS * TWIST_SEARCH);
+    mont_to(ctx, um, u);
+    bn_copy(x[0], um, n);
+    bn_copy(z[0], ctx->one, n);
+    twist_double(curve, x[1], z[1], um, ctx->one);
+
+    limb_t half = order / 2;
+    for (limb_t base = 1; base <= half && found < 0; base += TWIST_SEARCH)
+    {
+        size_t count = half - base + 1 < TWIST_SEARCH ? (size_t)(half - base + 1) : TWIST_SEARCH;
+        for (size_t i = 0; i < count; i++)
+        {
+            bn_copy(xs + i * BN_MAX_LIMBS, x[0], n);
+            bn_copy(zs + i * BN_MAX_LIMBS, z[0], n);
+            // (k + 2) P = (k + 1) P + P, with difference k P.
+            twist_add(curve, xn, zn, x[1], z[1], um, x[0], z[0]);
+            bn_copy(x[0], x[1], n);
+            bn_copy(z[0], z[1], n);
+            bn_copy(x[1], xn, n);
+            bn_copy(z[1], zn, n);
+        }
+        mont_inv_batch(ctx, &curve->inv, zs, zs, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            mont_mul(ctx, t, xs + i * BN_MAX_LIMBS, zs + i * BN_MAX_LIMBS);
+            mont_from(ctx, t, t);
+            bn_to_bytes(key, curve->bytes, t, n);
+            hmac_sha256_fixed_mac(&mac, candidate, key, curve->bytes);
+            if (memcmp(candidate, tag, SHA256_DIGEST_SIZE) == 0)
+            {
+                found = (long)(base + i);
+                break;
+            }
+        }
+    }
+    free(zs);
+    free(xs);
+    return found;
+}
+
+static int by_modulus(const void *a, const void *b)
+{
+    limb_t x = ((const twist_pair *)a)->modulus, y = ((const twist_pair *)b)->modulus;
+    return (x > y) - (x < y);
+}
+
+static int ambiguous(const twist_pair *pair)
+{
+    return pair->residue != 0 && 2 * pair->residue != pair->modulus;
+}
+
+// x = a mod m and x = b mod r for coprime word-sized m, r with m r < 2^64.
+static limb_t crt_pair(limb_t a, limb_t m, limb_t b, limb_t r)
+{
+    limb_t diff = (b % r + r - a % r) % r;
+    limb_t step = (limb_t)((unsigned __int128)diff * inverse_mod_word(m % r, r) % r);
+    return a + m * step;
+}
+
+static void query_range(size_t begin, size_t end, void *ctx)
+{
+    twist_job *job = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        twist_pair *pair = &job->result->pairs[i];
+        unsigned char tag[SHA256_DIGEST_SIZE];
+        if (!twist_point(job->curve, pair->u, pair->modulus, &pair->prime, 1))
+        {
+            atomic_store(&job->failed, 1);
+            continue;
+        }
+        job->oracle(tag, pair->u, job->oracle_ctx);
+        long r = twist_residue_search(job->curve, pair->u, pair->modulus, tag, job->msg, job->len);
+        if (r < 0)
+        {
+            atomic_store(&job->failed, 1);
+            continue;
+        }
+        pair->residue = (limb_t)r;
+    }
+}
+
+// The link query for pair i: of the two residues mod m_a m_i that keep
+// the anchor's sign, the one whose ladder output MACs to the tag fixes
+// the sign of pair i.
+static void link_range(size_t begin, size_t end, void *ctx)
+{
+    twist_job *job = ctx;
+    const mcurve *curve = job->curve;
+    twist_result *result = job->result;
+    const twist_pair *anchor = &result->pairs[result->anchor];
+    for (size_t i = begin; i < end; i++)
+    {
+        twist_pair *pair = &result->pairs[i];
+        limb_t primes[2] = {anchor->prime, pair->prime}, out[BN_MAX_LIMBS];
+        unsigned char candidate[SHA256_DIGEST_SIZE];
+        if (i == result->anchor || !ambiguous(pair))
+        {
+            continue;
+        }
+        limb_t order = anchor->modulus * pair->modulus;
+        if (!twist_point(curve, pair->link_u, order, primes, 2))
+        {
+            atomic_store(&job->failed, 1);
+            continue;
+        }
+        job->oracle(pair->link_tag, pair->link_u, job->oracle_ctx);
+
+        pair->sign = 0;
+        for (int s = 1; s >= -1 && pair->sign == 0; s -= 2)
+        {
+            limb_t b = s > 0 ? pair->residue : pair->modulus - pair->residue;
+            limb_t k = crt_pair(anchor->residue, anchor->modulus, b, pair->modulus);
+            ladder(curve, out, pair->link_u, &k, 1);
+            twist_mac(curve, candidate, out, job->msg, job->len);
+            if (memcmp(candidate, pair->link_tag, SHA256_DIGEST_SIZE) == 0)
+            {
+                pair->sign = s;
+            }
+        }
+        if (pair->sign == 0)
+        {
+            atomic_store(&job->failed, 1);
+        }
+    }
+}
+
+// Replays every link query with the combined residue as the scalar; since
+// the scalar is shared, the whole set goes through ladder_batch.
+static int confirm(const mcurve *curve, const twist_result *result, const unsigned char *msg, size_t len)
+{
+    size_t links = 0;
+    limb_t *u = malloc(sizeof(limb_t) * BN_MAX_LIMBS * TWIST_MAX_PAIRS);
+    const unsigned char *tags[TWIST_MAX_PAIRS];
+    unsigned char candidate[SHA256_DIGEST_SIZE];
+    int ok = 1;
+
+    for (size_t i = 0; i < result->count; i++)
+    {
+        const twist_pair *pair = &result->pairs[i];
+        if (i != result->anchor && ambiguous(pair))
+        {
+            bn_copy(u + links * BN_MAX_LIMBS, pair->link_u, curve->n);
+            tags[links++] = pair->link_tag;
+        }
+    }
+    ladder_batch(curve, u, u, links, result->residue, curve->order_n);
+    for (size_t i = 0; i < links && ok; i++)
+    {
+        twist_mac(curve, candidate, u + i * BN_MAX_LIMBS, msg, len);
+        ok = memcmp(candidate, tags[i], SHA256_DIGEST_SIZE) == 0;
+    }
+    free(u);
+    return ok;
+}
+
+// Recovers k = +-residue mod modulus from every odd prime power below
+// bound that divides the twist order: one query per pair to learn it up to
+// sign, one more per ambiguous pair to tie its sign to the anchor's.
+// Returns 0 if a search or a sign test comes up empty, or the final
+// check disagrees with the oracle.
+int twist_attack(const mcurve *curve, limb_t bound, twist_oracle oracle, void *oracle_ctx, const unsigned char *msg,
+                 size_t len, twist_result *result)
+{
+    factor_params params;
+    factor_list factors;
+    crt_ctx crt;
+
+    factor_params_default(&params);
+    params.trial_bound = (uint32_t)bound;
+    params.smooth_bound = bound;
+    factor(&factors, curve->twist_order, curve->order_n, &params);
+
+    memset(result, 0, sizeof(*result));
+    for (size_t i = 0; i < factors.count && result->count < TWIST_MAX_PAIRS; i++)
+    {
+        // The 2-part ends in (0, 0), which the ladder reports as 0 just like
+        // the identity, so it would only ever answer k mod 2 ambiguously.
+        limb_t q = factors.factors[i].value[0], m = q;
+        if (q == 2 || q >= bound)
+        {
+            continue;
+        }
+        for (unsigned e = 1; e < factors.factors[i].multiplicity && m * q < bound; e++)
+        {
+            m *= q;
+        }
+        result->pairs[result->count].prime = q;
+        result->pairs[result->count].modulus = m;
+        result->count++;
+    }
+    qsort(result->pairs, result->count, sizeof(twist_pair), by_modulus);
+
+    twist_job job = {curve, oracle, oracle_ctx, msg, len, result, 0};
+    atomic_init(&job.failed, 0);
+    parallel_for(NULL, 0, result->count, 1, query_range, &job, NULL);
+    result->queries = result->count;
+    if (atomic_load(&job.failed))
+    {
+        return 0;
+    }
+
+    // The smallest ambiguous modulus anchors the signs; every other
+    // ambiguous pair costs one link query.
+    result->anchor = result->count;
+    for (size_t i = 0; i < result->count && result->anchor == result->count; i++)
+    {
+        if (ambiguous(&result->pairs[i]))
+        {
+            result->anchor = i;
+        }
+    }
+    if (result->anchor < result->count)
+    {
+        result->pairs[result->anchor].sign = 1;
+        parallel_for(NULL, 0, result->count, 1, link_range, &job, NULL);
+        for (size_t i = 0; i < result->count; i++)
+        {
+            result->queries += i != result->anchor && ambiguous(&result->pairs[i]);
+        }
+        if (atomic_load(&job.failed))
+        {
+            return 0;
+        }
+    }
+
+    crt_init(&crt, curve->order_n);
+    for (size_t i = 0; i < result->count; i++)
+    {
+        const twist_pair *pair = &result->pairs[i];
+        crt_add(&crt, pair->sign < 0 ? pair->modulus - pair->residue : pair->residue, pair->modulus);
+    }
+    crt_result(&crt, result->residue, result->modulus);
+    crt_free(&crt);
+    return confirm(curve, result, msg, len);
+}
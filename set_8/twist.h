@@ -0,0 +1,59 @@
+#ifndef TWIST_ /* Include guard */
+#define TWIST_
+
+#include "ladder.h"
+#include "sha256.h"
+
+// Twist attack on a u-only ladder. A u whose curve equation has no square
+// root names a point on the quadratic twist, which the ladder handles
+// without noticing; small factors of the twist order then leak the
+// secret k mod each factor, but only up to sign, since u(kP) = u(-kP).
+//
+// Each residue is kept as an unordered pair {r, -r}. Rather than feeding
+// every pair to the CRT and enumerating 2^(m-1) sign choices, one extra
+// query per pair, on a point whose order is the anchor's modulus times
+// its own, says whether its sign agrees with the anchor's: only two of
+// the four combinations mod the product can match the tag, and they are
+// negatives of each other. That leaves k mod N up to one global sign,
+// which is confirmed by replaying every extra query through one batched
+// ladder with the combined residue as the shared scalar.
+
+#define TWIST_MAX_PAIRS 32
+#define TWIST_SEARCH 256 // multiples normalized per inversion in the residue search
+
+typedef void (*twist_oracle)(unsigned char *tag, const limb_t *u, void *ctx);
+
+typedef struct
+{
+    limb_t modulus; // prime power dividing the twist order
+    limb_t prime;
+    limb_t residue; // k = +-residue mod modulus, residue <= modulus / 2
+    int sign;       // relative to the anchor; 0 when residue = -residue
+    limb_t u[BN_MAX_LIMBS];
+    limb_t link_u[BN_MAX_LIMBS]; // point of order anchor modulus * modulus
+    unsigned char link_tag[SHA256_DIGEST_SIZE];
+} twist_pair;
+
+typedef struct
+{
+    size_t count;
+    size_t anchor;
+    size_t queries;
+    twist_pair pairs[TWIST_MAX_PAIRS];
+    limb_t residue[BN_MAX_LIMBS]; // k = +-residue mod modulus
+    limb_t modulus[BN_MAX_LIMBS];
+} twist_result;
+
+int mcurve_on_twist(const mcurve *curve, const limb_t *u);
+
+void twist_mac(const mcurve *curve, unsigned char *tag, const limb_t *u, const unsigned char *msg, size_t len);
+
+int twist_point(const mcurve *curve, limb_t *u, limb_t order, const limb_t *primes, size_t prime_count);
+
+long twist_residue_search(const mcurve *curve, const limb_t *u, limb_t order, const unsigned char *tag,
+                          const unsigned char *msg, size_t len);
+
+int twist_attack(const mcurve *curve, limb_t bound, twist_oracle oracle, void *oracle_ctx, const unsigned char *msg,
+                 size_t len, twist_result *result);
+
+#endif // TWIST_